@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "batch_eval.h"
+#include "complex_kernels.h"
+#include "grammar_profile.h"
+#include "vec_math.h"
+
+typedef BatchBlock<std::complex<double>> ComplexBlock;
+
+/* Block operations. Binary operations store result in the left operand */
+
+template <typename RealT>
+static void Fill(BatchBlock<RealT> &out, double value, size_t n)
+{
+  std::fill(out.re, out.re + n, (RealT)value);
+}
+
+static void Fill(ComplexBlock &out, double value, size_t n)
+{
+  std::fill(out.re, out.re + n, value);
+  std::fill(out.im, out.im + n, 0.0);
+}
+
+template <typename RealT>
+static void FillImag(BatchBlock<RealT> &out, size_t n)
+{
+  std::fill(out.re, out.re + n, std::numeric_limits<RealT>::quiet_NaN());
+}
+
+static void FillImag(ComplexBlock &out, size_t n)
+{
+  std::fill(out.re, out.re + n, 0.0);
+  std::fill(out.im, out.im + n, 1.0);
+}
+
+template <typename RealT>
+static void Load(BatchBlock<RealT> &out, const RealT *re, const RealT *, size_t n)
+{
+  memcpy(out.re, re, n * sizeof(RealT));
+}
+
+static void Load(ComplexBlock &out, const double *re, const double *im, size_t n)
+{
+  memcpy(out.re, re, n * sizeof(double));
+  if (im != nullptr) { memcpy(out.im, im, n * sizeof(double)); }
+  else               { std::fill(out.im, out.im + n, 0.0); }
+}
+
+template <typename RealT>
+static void Store(const BatchBlock<RealT> &block, RealT *re, RealT *, size_t n)
+{
+  memcpy(re, block.re, n * sizeof(RealT));
+}
+
+static void Store(const ComplexBlock &block, double *re, double *im, size_t n)
+{
+  memcpy(re, block.re, n * sizeof(double));
+  if (im != nullptr) { memcpy(im, block.im, n * sizeof(double)); }
+}
+
+template <typename RealT>
+static void Copy(BatchBlock<RealT> &out, const BatchBlock<RealT> &in, size_t n)
+{
+  memcpy(out.re, in.re, n * sizeof(RealT));
+}
+
+static void Copy(ComplexBlock &out, const ComplexBlock &in, size_t n)
+{
+  memcpy(out.re, in.re, n * sizeof(double));
+  memcpy(out.im, in.im, n * sizeof(double));
+}
+
+template <typename RealT>
+static void Add(BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] += b.re[i]; }
+}
+
+static void Add(ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] += b.re[i]; a.im[i] += b.im[i]; }
+}
+
+template <typename RealT>
+static void Sub(BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] -= b.re[i]; }
+}
+
+static void Sub(ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] -= b.re[i]; a.im[i] -= b.im[i]; }
+}
+
+template <typename RealT>
+static void Mul(BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] *= b.re[i]; }
+}
+
+static void Mul(ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  CplxMul(a.re, a.im, b.re, b.im, a.re, a.im, n);
+}
+
+template <typename RealT>
+static void Div(BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] /= b.re[i]; }
+}
+
+static void Div(ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  CplxDiv(a.re, a.im, b.re, b.im, a.re, a.im, n);
+}
+
+template <typename RealT>
+static void Pow(BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) { a.re[i] = std::pow(a.re[i], b.re[i]); }
+}
+
+static void Pow(ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  CplxPow(a.re, a.im, b.re, b.im, a.re, a.im, n);
+}
+
+template <typename RealT>
+static void CalcOpId(ID_TYPE idType, BatchBlock<RealT> &a, size_t n)
+{
+  PROFILE_COUNT(op_calls[idType], n)
+
+  switch (idType)
+  {
+    case ID_SIN : VecSin (a.re, a.re, n); break;
+    case ID_COS : VecCos (a.re, a.re, n); break;
+    case ID_TAN : VecTan (a.re, a.re, n); break;
+    case ID_COT : VecCot (a.re, a.re, n); break;
+    case ID_SQRT: VecSqrt(a.re, a.re, n); break;
+    case ID_LN  : VecLog (a.re, a.re, n); break;
+    case ID_NORM: for (size_t i = 0; i < n; i++) { a.re[i] = std::fabs(a.re[i]); } break;
+    case NOT_ID : //fallthrough;
+    default     : Fill(a, 0, n); break;
+  }
+}
+
+static void CalcOpId(ID_TYPE idType, ComplexBlock &a, size_t n)
+{
+  PROFILE_COUNT(op_calls[idType], n)
+
+  switch (idType)
+  {
+    case ID_SIN : CplxSin (a.re, a.im, a.re, a.im, n); break;
+    case ID_COS : CplxCos (a.re, a.im, a.re, a.im, n); break;
+    case ID_TAN : CplxTan (a.re, a.im, a.re, a.im, n); break;
+    case ID_COT : CplxCot (a.re, a.im, a.re, a.im, n); break;
+    case ID_SQRT: CplxSqrt(a.re, a.im, a.re, a.im, n); break;
+    case ID_LN  : CplxLn  (a.re, a.im, a.re, a.im, n); break;
+    case ID_NORM:
+      for (size_t i = 0; i < n; i++) { a.re[i] = hypot(a.re[i], a.im[i]); a.im[i] = 0; }
+      break;
+    case NOT_ID : //fallthrough;
+    default     : Fill(a, 0, n); break;
+  }
+}
+
+/* Comparison, minimum and maximum. Complex numbers are compared by real parts */
+
+template <typename RealT>
+static void Compare(NODE_TYPE type, RealT *a, const RealT *b, size_t n)
+{
+  const RealT one = 1, zero = 0;
+  switch (type)
+  {
+    case NODE_LT: for (size_t i = 0; i < n; i++) { a[i] = a[i] <  b[i] ? one : zero; } break;
+    case NODE_LE: for (size_t i = 0; i < n; i++) { a[i] = a[i] <= b[i] ? one : zero; } break;
+    case NODE_GT: for (size_t i = 0; i < n; i++) { a[i] = a[i] >  b[i] ? one : zero; } break;
+    case NODE_GE: for (size_t i = 0; i < n; i++) { a[i] = a[i] >= b[i] ? one : zero; } break;
+    case NODE_EQ: for (size_t i = 0; i < n; i++) { a[i] = a[i] == b[i] ? one : zero; } break;
+    case NODE_NE: for (size_t i = 0; i < n; i++) { a[i] = a[i] != b[i] ? one : zero; } break;
+    default     : std::fill(a, a + n, zero); break;
+  }
+}
+
+template <typename RealT>
+static void Compare(NODE_TYPE type, BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  Compare(type, a.re, b.re, n);
+}
+
+static void Compare(NODE_TYPE type, ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  Compare(type, a.re, b.re, n);
+  std::fill(a.im, a.im + n, 0.0);
+}
+
+template <typename RealT>
+static void MinMax(ID_TYPE idType, BatchBlock<RealT> &a, const BatchBlock<RealT> &b, size_t n)
+{
+  if (idType == ID_MIN) { for (size_t i = 0; i < n; i++) { a.re[i] = b.re[i] < a.re[i] ? b.re[i] : a.re[i]; } }
+  else                  { for (size_t i = 0; i < n; i++) { a.re[i] = b.re[i] > a.re[i] ? b.re[i] : a.re[i]; } }
+}
+
+/* Blends arrays by mask: out = mask ? left : right. Both operands are loaded, so loop is if-converted
+ * to vector blend instead of branches. Output may be any of inputs */
+template <typename RealT>
+static void Blend(RealT *out, const RealT *mask, const RealT *left, const RealT *right, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    RealT left_value = left[i], right_value = right[i];
+    out[i] = mask[i] != 0 ? left_value : right_value;
+  }
+}
+
+static void MinMax(ID_TYPE idType, ComplexBlock &a, const ComplexBlock &b, size_t n)
+{
+  double is_right[BATCH_BLOCK];
+  if (idType == ID_MIN) { for (size_t i = 0; i < n; i++) { is_right[i] = b.re[i] < a.re[i] ? 1.0 : 0.0; } }
+  else                  { for (size_t i = 0; i < n; i++) { is_right[i] = b.re[i] > a.re[i] ? 1.0 : 0.0; } }
+
+  Blend(a.re, is_right, b.re, a.re, n);
+  Blend(a.im, is_right, b.im, a.im, n);
+}
+
+/* Blends operands by condition: out = cond ? left : right. Output may be any of operands */
+template <typename RealT>
+static void Select(BatchBlock<RealT> &out, const BatchBlock<RealT> &cond, const BatchBlock<RealT> &left,
+                   const BatchBlock<RealT> &right, size_t n)
+{
+  Blend(out.re, cond.re, left.re, right.re, n);
+}
+
+static void Select(ComplexBlock &out, const ComplexBlock &cond, const ComplexBlock &left, const ComplexBlock &right,
+                   size_t n)
+{
+  /* Imaginary parts are blended first, as output may be condition */
+  Blend(out.im, cond.re, left.im, right.im, n);
+  Blend(out.re, cond.re, left.re, right.re, n);
+}
+
+/* Checks if condition is 'value' for any point of block. Points are counted in floating point type of block
+ * to be vectorized, block size is exact in all of them */
+template <typename BlockT>
+static bool HasPoint(const BlockT &cond, bool value, size_t n)
+{
+  typedef typename BlockT::RealT RealT;
+  RealT true_count = 0;
+  for (size_t i = 0; i < n; i++) { true_count += cond.re[i] != 0 ? (RealT)1 : (RealT)0; }
+  return value ? true_count != 0 : true_count != (RealT)n;
+}
+
+/* Adds or multiplies reduction accumulator by body value. Sum rounding errors are collected in 'error' */
+template <typename RealT>
+static void Accumulate(NODE_TYPE type, BatchBlock<RealT> &acc, BatchBlock<RealT> &error, const BatchBlock<RealT> &term,
+                       size_t n)
+{
+  if (type == NODE_SUM) { VecSumStep(acc.re, error.re, term.re, n); }
+  else                  { Mul(acc, term, n); }
+}
+
+static void Accumulate(NODE_TYPE type, ComplexBlock &acc, ComplexBlock &error, const ComplexBlock &term, size_t n)
+{
+  if (type == NODE_SUM)
+  {
+    VecSumStep(acc.re, error.re, term.re, n);
+    VecSumStep(acc.im, error.im, term.im, n);
+  }
+  else
+  {
+    Mul(acc, term, n);
+  }
+}
+
+/* Calculates polynomial by Horner scheme. 'coeffs' holds 'degree + 1' coefficients, lowest power first */
+template <typename RealT>
+static void CalcPoly(const double *coeffs, size_t degree, BatchBlock<RealT> &x, size_t n)
+{
+  RealT result[BATCH_BLOCK];
+  std::fill(result, result + n, (RealT)coeffs[degree]);
+
+  for (size_t k = degree; k-- > 0;)
+  {
+    RealT coeff = (RealT)coeffs[k];
+    for (size_t i = 0; i < n; i++) { result[i] = result[i] * x.re[i] + coeff; }
+  }
+  memcpy(x.re, result, n * sizeof(RealT));
+}
+
+static void CalcPoly(const double *coeffs, size_t degree, ComplexBlock &x, size_t n)
+{
+  double result_re[BATCH_BLOCK], result_im[BATCH_BLOCK];
+  std::fill(result_re, result_re + n, coeffs[degree]);
+  std::fill(result_im, result_im + n, 0.0);
+
+  for (size_t k = degree; k-- > 0;)
+  {
+    double coeff = coeffs[k];
+    for (size_t i = 0; i < n; i++)
+    {
+      double re = result_re[i] * x.re[i] - result_im[i] * x.im[i] + coeff;
+      double im = result_re[i] * x.im[i] + result_im[i] * x.re[i];
+      result_re[i] = re;
+      result_im[i] = im;
+    }
+  }
+  memcpy(x.re, result_re, n * sizeof(double));
+  memcpy(x.im, result_im, n * sizeof(double));
+}
+
+/* Class constructor */
+template <typename ScalarT>
+BatchEvaluator<ScalarT>::BatchEvaluator(const ExprTree &init_tree, SELECT_MODE select_mode) :
+  program(init_tree, select_mode)
+{
+  registers.resize(program.register_count);
+  counters.resize(program.counter_count);
+}
+
+/* Evaluates expression for 'count' points */
+template <typename ScalarT>
+void BatchEvaluator<ScalarT>::Eval(const RealT *const *var_re, const RealT *const *var_im, size_t count,
+                                   RealT *out_re, RealT *out_im)
+{
+  PROFILE_SCOPE(PROF_EVAL)
+
+  for (size_t start = 0; start < count; start += BATCH_BLOCK)
+  {
+    size_t n = count - start < BATCH_BLOCK ? count - start : BATCH_BLOCK;
+
+    for (size_t pc = 0; pc < program.code.size(); pc++)
+    {
+      const Instruction &ins = program.code[pc];
+
+      switch (ins.control)
+      {
+        case CONTROL_NONE:
+          Execute(ins, var_re, var_im, start, n);
+          break;
+        case CONTROL_IF_TRUE: //fallthrough
+        case CONTROL_IF_FALSE:
+          if (!HasPoint(registers[ins.cond], ins.control == CONTROL_IF_TRUE, n)) /* operand is not chosen in block */
+          {
+            pc += ins.skip;
+          }
+          break;
+        case CONTROL_LOOP:
+          Fill(registers[ins.dst], ins.type == NODE_SUM ? 0.0 : 1.0, n);
+          Fill(registers[ins.cond], 0.0, n);
+          Fill(registers[ins.var], ins.value, n);
+          counters[ins.counter] = (long long)ins.value;
+          if (ins.value > program.code[pc + ins.skip].value) /* empty range */
+          {
+            pc += ins.skip;
+          }
+          break;
+        case CONTROL_NEXT:
+        {
+          Accumulate(ins.type, registers[ins.dst], registers[ins.cond], registers[ins.left], n);
+
+          long long index = ++counters[ins.counter];
+          if (index <= (long long)ins.value)
+          {
+            Fill(registers[ins.var], (double)index, n);
+            pc -= ins.skip;
+          }
+          else if (ins.type == NODE_SUM)
+          {
+            Add(registers[ins.dst], registers[ins.cond], n);
+          }
+          break;
+        }
+      }
+    }
+
+    Store(registers[program.result], out_re + start, out_im == nullptr ? nullptr : out_im + start, n);
+  }
+}
+
+/* Executes instruction for points [start, start + n). Operation result is calculated in place:
+ * left operand is copied to result register first unless it is already there */
+template <typename ScalarT>
+void BatchEvaluator<ScalarT>::Execute(const Instruction &ins, const RealT *const *var_re,
+                                      const RealT *const *var_im, size_t start, size_t n)
+{
+  BlockT &result = registers[ins.dst];
+
+  switch (ins.type)
+  {
+    case NODE_NUM : Fill(result, ins.value, n); return;
+    case NODE_IMAG: FillImag(result, n); return;
+    case NODE_VAR :
+      Load(result, var_re[ins.var] + start, var_im == nullptr ? nullptr : var_im[ins.var] + start, n);
+      return;
+    case NODE_POLY:
+      Load(result, var_re[ins.var] + start, var_im == nullptr ? nullptr : var_im[ins.var] + start, n);
+      CalcPoly(&program.coeffs[ins.left], ins.right, result, n);
+      return;
+    case NODE_SELECT:
+      Select(result, registers[ins.cond], registers[ins.left], registers[ins.right], n);
+      return;
+    default:
+      break;
+  }
+
+  if (ins.dst != ins.left)
+  {
+    Copy(result, registers[ins.left], n);
+  }
+
+  if (ins.type == NODE_FUNC && ExprTree::IdArity(ins.id) == 1)
+  {
+    CalcOpId(ins.id, result, n);
+    return;
+  }
+
+  const BlockT &right = registers[ins.right];
+
+  switch (ins.type)
+  {
+    case NODE_ADD: Add(result, right, n); break;
+    case NODE_SUB: Sub(result, right, n); break;
+    case NODE_MUL: Mul(result, right, n); break;
+    case NODE_DIV: Div(result, right, n); break;
+    case NODE_POW: Pow(result, right, n); break;
+    case NODE_FUNC:
+      PROFILE_COUNT(op_calls[ins.id], n)
+      if (ins.id == ID_MIN || ins.id == ID_MAX) { MinMax(ins.id, result, right, n); }
+      else                                      { Mul(result, right, n); } /* dot and matrix product of scalars */
+      break;
+    default      : Compare(ins.type, result, right, n); break;
+  }
+}
+
+template class BatchEvaluator<float>;
+template class BatchEvaluator<double>;
+template class BatchEvaluator<long double>;
+template class BatchEvaluator<std::complex<double>>;
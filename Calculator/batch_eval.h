@@ -0,0 +1,75 @@
+#ifndef CALCULATOR_BATCH_EVAL_H
+#define CALCULATOR_BATCH_EVAL_H
+
+#include <complex>
+#include <vector>
+
+#include "expr_tree.h"
+#include "program.h"
+
+/* Number of points evaluated by one pass over expression tree */
+#define BATCH_BLOCK 256
+
+/* Values of one register for a block of points. Complex values are split into real and imaginary arrays */
+template <typename ScalarT>
+struct BatchBlock
+{
+  typedef ScalarT RealT;
+  RealT re[BATCH_BLOCK];
+};
+
+template <>
+struct BatchBlock<std::complex<double>>
+{
+  typedef double RealT;
+  double re[BATCH_BLOCK];
+  double im[BATCH_BLOCK];
+};
+
+/***
+ * Evaluates one expression for many points at once.
+ *
+ * Expression is compiled to register 'Program' which is executed once per block of 'BATCH_BLOCK' points,
+ * every instruction is calculated for the whole block by elementwise kernels ('vec_math.h', 'complex_kernels.h').
+ * Working set is 'register_count' blocks however long the script is.
+ * Instantiated for 'float', 'double', 'long double' and 'std::complex<double>'. Single precision blocks
+ * hold twice as many values per vector register as double ones, extended precision ones are not vectorized.
+ */
+template <typename ScalarT>
+class BatchEvaluator
+{
+  typedef BatchBlock<ScalarT> BlockT;
+  typedef typename BlockT::RealT RealT; /* Type of real and imaginary parts of values */
+
+private:
+  Program program;               /* Compiled expression */
+  std::vector<BlockT> registers; /* Block of values for every program register */
+  std::vector<long long> counters; /* Current value of every loop counter */
+
+public:
+  /* Class constructor */
+  explicit BatchEvaluator(const ExprTree &init_tree, SELECT_MODE select_mode = SELECT_AUTO);
+
+  /* Evaluates expression for 'count' points. 'var_re[v]' and 'var_im[v]' hold real and imaginary parts
+   * of variable 'v' values in order of 'var_names'. Imaginary parts are not used by real evaluation and may be nullptr */
+  void Eval(const RealT *const *var_re, const RealT *const *var_im, size_t count, RealT *out_re, RealT *out_im);
+
+  /* Evaluates real expression for 'count' points */
+  void Eval(const RealT *const *var_values, size_t count, RealT *out)
+  {
+    Eval(var_values, nullptr, count, out, nullptr);
+  }
+
+  /* Returns compiled program */
+  const Program &GetProgram() const
+  {
+    return program;
+  }
+
+private:
+  /* Executes instruction for points [start, start + n) */
+  void Execute(const Instruction &ins, const RealT *const *var_re, const RealT *const *var_im,
+               size_t start, size_t n);
+};
+
+#endif //CALCULATOR_BATCH_EVAL_H
@@ -0,0 +1,137 @@
+#ifndef CALCULATOR_BOUNDED_QUEUE_H
+#define CALCULATOR_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/* Size of cache line, positions of producers and consumers are kept in separate lines */
+#define QUEUE_CACHE_LINE 64
+
+/***
+ * Bounded lock-free queue for many producers and many consumers (D. Vyukov's scheme).
+ *
+ * Every cell has sequence number telling whether it is free for the producer or filled for the consumer
+ * of given position, so producer and consumer claim position by one compare-and-swap and never
+ * wait for each other inside operation. Capacity is rounded up to power of two.
+ * Operations never block: 'TryPush' fails if queue is full, 'TryPop' fails if it is empty.
+ */
+template <typename T>
+class BoundedQueue
+{
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence; /* Position cell is free for (== position) or filled for (== position + 1) */
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+
+  char pad0[QUEUE_CACHE_LINE];
+  std::atomic<size_t> enqueue_pos; /* Position of the next pushed value */
+  char pad1[QUEUE_CACHE_LINE];
+  std::atomic<size_t> dequeue_pos; /* Position of the next popped value */
+  char pad2[QUEUE_CACHE_LINE];
+
+public:
+  /* Class constructor */
+  explicit BoundedQueue(size_t capacity) : enqueue_pos(0), dequeue_pos(0)
+  {
+    size_t size = 2;
+    while (size < capacity)
+    {
+      size *= 2;
+    }
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+    for (size_t pos = 0; pos < size; pos++)
+    {
+      cells[pos].sequence.store(pos, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  /* Moves 'value' to queue. Returns 'false' and leaves 'value' untouched if queue is full */
+  bool TryPush(T &value)
+  {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Cell &cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)pos;
+
+      if (diff == 0)
+      {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0) /* cell still holds value of previous lap */
+      {
+        return false;
+      }
+      else
+      {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /* Moves the oldest value to 'value'. Returns 'false' if queue is empty */
+  bool TryPop(T &value)
+  {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Cell &cell = cells[pos & mask];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)(pos + 1);
+
+      if (diff == 0)
+      {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          value = std::move(cell.value);
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0) /* cell is not filled yet */
+      {
+        return false;
+      }
+      else
+      {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /* Returns approximate number of values in queue */
+  size_t Size() const
+  {
+    size_t pushed = enqueue_pos.load(std::memory_order_relaxed);
+    size_t popped = dequeue_pos.load(std::memory_order_relaxed);
+    return pushed > popped ? pushed - popped : 0;
+  }
+
+  /* Returns maximal number of values in queue */
+  size_t Capacity() const
+  {
+    return mask + 1;
+  }
+};
+
+#endif //CALCULATOR_BOUNDED_QUEUE_H
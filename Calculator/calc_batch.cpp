@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "pipeline.h"
+
+/* Command line options of expression file tool */
+struct BatchParams
+{
+  std::string in = "-";     /* Input file, "-" is standard input */
+  std::string out = "-";    /* Output file, "-" is standard output */
+  std::string errors;       /* Side file of failed lines, empty puts errors to output */
+  bool print_stats = false; /* Print stage statistics to standard error */
+  PipelineParams pipeline;
+};
+
+/* Prints usage of tool */
+static void PrintUsage()
+{
+  printf("Usage: calc_batch [options]\n"
+         "  --in FILE          file of expressions, one per line, \"-\" is standard input\n"
+         "  --out FILE         file of results, one per line, \"-\" is standard output\n"
+         "  --errors FILE      file of failed lines \"<line>:<byte offset>: error <code>, expected <token>: <text>\",\n"
+         "                     their results are empty lines\n"
+         "  --var NAME=VALUE   value of variable in all expressions\n"
+         "  --parsers N        number of parsing threads\n"
+         "  --evaluators N     number of evaluating threads\n"
+         "  --batch N          number of lines handed between stages at once\n"
+         "  --queue N          number of batches every queue between stages holds\n"
+         "  --stats 1          print statistics of stages to standard error\n");
+}
+
+/* Reads command line options. Returns 'false' on unknown or malformed option */
+static bool ParseArgs(int argc, char **argv, BatchParams &params)
+{
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const char *key = argv[i], *value = argv[i + 1];
+
+    if      (strcmp(key, "--in") == 0)         { params.in = value; }
+    else if (strcmp(key, "--out") == 0)        { params.out = value; }
+    else if (strcmp(key, "--errors") == 0)     { params.errors = value; }
+    else if (strcmp(key, "--parsers") == 0)    { params.pipeline.parsers = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--evaluators") == 0) { params.pipeline.evaluators = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--batch") == 0)      { params.pipeline.batch_lines = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--queue") == 0)      { params.pipeline.queue_capacity = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--stats") == 0)      { params.print_stats = strcmp(value, "0") != 0; }
+    else if (strcmp(key, "--var") == 0)
+    {
+      const char *separator = strchr(value, '=');
+      if (separator == nullptr)
+      {
+        return false;
+      }
+      params.pipeline.vars[std::string(value, separator)] = strtod(separator + 1, nullptr);
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return argc % 2 == 1;
+}
+
+/* Prints statistics of stages. Stage with the largest busy time per thread limits throughput */
+static void PrintStats(const std::vector<StageStats> &stats, double total_ms)
+{
+  fprintf(stderr, "%-6s %7s %9s %10s %10s %10s %12s %14s\n", "stage", "threads", "lines", "busy ms", "wait in",
+          "wait out", "lines/s/thr", "queue mean/max");
+
+  const StageStats *bottleneck = &stats.front();
+  for (const StageStats &stage : stats)
+  {
+    double thread_ms = stage.busy_ms / (stage.workers != 0 ? stage.workers : 1);
+    fprintf(stderr, "%-6s %7u %9zu %10.1f %10.1f %10.1f %12.0f", stage.name.c_str(), stage.workers, stage.lines,
+            stage.busy_ms, stage.wait_in_ms, stage.wait_out_ms, stage.lines / (stage.busy_ms != 0 ? stage.busy_ms : 1) * 1e3);
+    if (stage.queue_capacity != 0) { fprintf(stderr, "   %5.1f/%zu of %zu\n", stage.mean_depth, stage.max_depth, stage.queue_capacity); }
+    else                           { fprintf(stderr, "\n"); }
+
+    if (thread_ms > bottleneck->busy_ms / (bottleneck->workers != 0 ? bottleneck->workers : 1))
+    {
+      bottleneck = &stage;
+    }
+  }
+
+  size_t lines = stats.back().lines;
+  fprintf(stderr, "total %.1f ms, %.0f lines/s, bottleneck: %s, reorder buffer max %zu batches\n", total_ms,
+          lines / (total_ms != 0 ? total_ms : 1) * 1e3, bottleneck->name.c_str(), stats.back().max_pending);
+}
+
+int main(int argc, char **argv)
+{
+  BatchParams params;
+  if (!ParseArgs(argc, argv, params))
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  FILE *in = params.in == "-" ? stdin : fopen(params.in.c_str(), "rb");
+  if (in == nullptr)
+  {
+    fprintf(stderr, "%s: ", params.in.c_str());
+    print_err(std::cerr, ERR_FILE_OPEN);
+    return 1;
+  }
+  FILE *out = params.out == "-" ? stdout : fopen(params.out.c_str(), "wb");
+  if (out == nullptr)
+  {
+    fprintf(stderr, "%s: ", params.out.c_str());
+    print_err(std::cerr, ERR_FILE_OPEN);
+    return 1;
+  }
+
+  if (!params.errors.empty() && (params.pipeline.errors = fopen(params.errors.c_str(), "wb")) == nullptr)
+  {
+    fprintf(stderr, "%s: ", params.errors.c_str());
+    print_err(std::cerr, ERR_FILE_OPEN);
+    return 1;
+  }
+
+  std::vector<StageStats> stats;
+  auto start = std::chrono::steady_clock::now();
+  ERR_CODE code = RunPipeline(in, out, params.pipeline, stats);
+  double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (in != stdin)   { fclose(in); }
+  if (out != stdout) { fclose(out); }
+  if (params.pipeline.errors != nullptr) { fclose(params.pipeline.errors); }
+
+  if (params.print_stats)
+  {
+    PrintStats(stats, total_ms);
+  }
+  if (code != SUCCESS)
+  {
+    print_err(std::cerr, code);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,664 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "grammar.h"
+#include "matrix.h"
+#include "batch_eval.h"
+#include "evaluator.h"
+#include "expr_generator.h"
+#include "grammar_profile.h"
+#include "interval.h"
+
+/* Benchmark settings which are not related to expression generation */
+struct BenchParams
+{
+  size_t count = 10000; /* Number of expressions in corpus */
+  unsigned reps = 10;   /* Number of repeated runs of every benchmark */
+  size_t points = 256;  /* Number of points every expression is evaluated at by batch benchmarks */
+  size_t vector_size = 10000; /* Number of elements of vectors in matrix benchmarks */
+  size_t matrix_size = 128;   /* Number of rows and columns of matrices in matrix benchmarks */
+};
+
+/* Statistics of repeated runs, nanoseconds per unit (expression or point) */
+struct BenchStats
+{
+  double min = 0;
+  double median = 0;
+  double mean = 0;
+  double stddev = 0;
+};
+
+/* Calculates statistics of run times */
+static BenchStats CalcStats(std::vector<double> samples)
+{
+  BenchStats stats;
+  std::sort(samples.begin(), samples.end());
+
+  stats.min = samples.front();
+  stats.median = samples[samples.size() / 2];
+
+  for (double sample : samples) { stats.mean += sample; }
+  stats.mean /= samples.size();
+
+  for (double sample : samples) { stats.stddev += (sample - stats.mean) * (sample - stats.mean); }
+  stats.stddev = sqrt(stats.stddev / samples.size());
+
+  return stats;
+}
+
+/* Maximal number of times script statement is generated again if it is not finite. Statement is skipped then */
+#define SCRIPT_MAX_RETRIES 64
+
+/* Maximal magnitude of values summed by checksums */
+#define CHECKSUM_LIMIT 1e15
+
+/* Returns 'value' if it is finite and not greater than CHECKSUM_LIMIT by magnitude, zero otherwise.
+ * Checksums sum such values only, so they neither become NaN nor depend on summation order of huge values,
+ * and paths computing the same points have the same checksums */
+template <typename RealT>
+static double ChecksumTerm(RealT value)
+{
+  return std::isfinite(value) && fabs((double)value) <= CHECKSUM_LIMIT ? (double)value : 0;
+}
+
+/* Returns checksum of 'count' values */
+template <typename RealT>
+static double ChecksumSum(const RealT *values, size_t count)
+{
+  double sum = 0;
+  for (size_t i = 0; i < count; i++) { sum += ChecksumTerm(values[i]); }
+  return sum;
+}
+
+/* Runs 'body' over the whole corpus 'reps' times and prints ns/unit and bytes/second.
+ * 'units' is number of expressions or points processed by one run, zero 'bytes' disables bytes/second */
+static void RunBench(const char *name, const BenchParams &bench, size_t units, const char *unit_name, size_t bytes,
+                     const std::function<double()> &body)
+{
+  std::vector<double> samples;
+  double checksum = body(); /* warm up */
+
+  for (unsigned rep = 0; rep < bench.reps; rep++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    checksum += body();
+    auto finish = std::chrono::steady_clock::now();
+
+    samples.push_back(std::chrono::duration<double, std::nano>(finish - start).count() / units);
+  }
+
+  BenchStats stats = CalcStats(samples);
+  printf("%-14s %10.2f ns/%-5s (min %.2f, mean %.2f, stddev %.2f)", name, stats.median, unit_name, stats.min, stats.mean,
+         stats.stddev);
+  if (bytes != 0) { printf("  %8.1f MB/s", bytes / (stats.median * units) * 1e3); }
+  printf("  [checksum %g]\n", checksum);
+}
+
+/* Runs piecewise expression benchmarks on points with random sign (condition is unpredictable)
+ * and sorted points (condition is the same for whole blocks) */
+static void RunSelectBenches(const BenchParams &bench)
+{
+  size_t n = bench.vector_size;
+  std::vector<double> random_x(n), sorted_x(n), y(n), out(n);
+  unsigned long long state = 1;
+  for (size_t i = 0; i < n; i++)
+  {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    random_x[i] = (double)(state >> 11) / (1ULL << 53) * 4 - 2;
+    y[i] = 0.5 + (double)i / n;
+  }
+  sorted_x = random_x;
+  std::sort(sorted_x.begin(), sorted_x.end());
+
+  Grammar grammar('=');
+  const std::pair<const char *, const char *> exprs[] = {
+    {"cheap", "x < 0 ? 0 - x : x * y="},
+    {"heavy", "x < 0 ? sin(x) * cos(y) * sqrt(y) : ln(y) * tan(x) * cos(x)="}};
+  const std::pair<const char *, const std::vector<double> *> inputs[] = {{"rand", &random_x}, {"sort", &sorted_x}};
+
+  printf("\nselect: %zu points\n", n);
+  for (auto &expr : exprs)
+  {
+    ExprTree tree = grammar.Compile(expr.second).first;
+    BatchEvaluator<double> eager(tree, SELECT_EAGER), lazy(tree, SELECT_LAZY);
+
+    for (auto &input : inputs)
+    {
+      std::vector<const double *> columns;
+      for (auto &name : tree.var_names) { columns.push_back(name == "x" ? input.second->data() : y.data()); }
+
+      std::string name = std::string(expr.first) + "-" + input.first;
+      RunBench((name + "-point").c_str(), bench, n, "point", 0, [&]()
+      {
+        double sum = 0, values[2];
+        for (size_t i = 0; i < n; i++)
+        {
+          for (size_t v = 0; v < columns.size(); v++) { values[v] = columns[v][i]; }
+          sum += ChecksumTerm(tree.Eval(values));
+        }
+        return sum;
+      });
+      RunBench((name + "-eager").c_str(), bench, n, "point", 0, [&]()
+      {
+        eager.Eval(columns.data(), n, out.data());
+        return ChecksumSum(out.data(), n);
+      });
+      RunBench((name + "-lazy").c_str(), bench, n, "point", 0, [&]()
+      {
+        lazy.Eval(columns.data(), n, out.data());
+        return ChecksumSum(out.data(), n);
+      });
+    }
+  }
+}
+
+/* Runs reduction benchmarks: series of literals folded at compile time against plain summation loop,
+ * and series of variable evaluated point by point and by batch loop */
+static void RunReduceBenches(const BenchParams &bench)
+{
+  long long terms = (long long)bench.vector_size * 100;
+  std::string series = "sum(k, 1, " + std::to_string(terms) + ", 1 / k^2)=";
+  Grammar grammar('=');
+
+  /* Reference value: pi^2 / 6 minus Euler-Maclaurin tail of the series */
+  long double n = (long double)terms;
+  long double reference = 3.14159265358979323846264338327950288L * 3.14159265358979323846264338327950288L / 6 -
+                          (1 / n - 1 / (2 * n * n) + 1 / (6 * n * n * n));
+  double folded = grammar.Compile(series.c_str()).first.Eval();
+  double naive = 0;
+  for (long long k = 1; k <= terms; k++) { naive += 1.0 / ((double)k * (double)k); }
+
+  printf("\nreduce: %lld terms, error of folded sum %.3g, of plain loop %.3g\n", terms,
+         (double)fabsl(folded - reference), (double)fabsl(naive - reference));
+
+  RunBench("series-fold", bench, (size_t)terms, "term", 0, [&]()
+  {
+    return grammar.Compile(series.c_str()).first.Eval();
+  });
+  RunBench("series-loop", bench, (size_t)terms, "term", 0, [&]()
+  {
+    double sum = 0;
+    for (long long k = 1; k <= terms; k++) { sum += 1.0 / ((double)k * (double)k); }
+    return sum;
+  });
+
+  size_t points = bench.vector_size;
+  std::vector<double> x(points), out(points);
+  for (size_t i = 0; i < points; i++) { x[i] = 0.001 * i; }
+  const double *columns[1] = {x.data()};
+
+  ExprTree tree = grammar.Compile("sum(k, 1, 32, sin(k * x) / k)=").first;
+  BatchEvaluator<double> batch(tree);
+  RunBench("fourier-point", bench, points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < points; i++) { sum += ChecksumTerm(tree.Eval(&x[i])); }
+    return sum;
+  });
+  RunBench("fourier-batch", bench, points, "point", 0, [&]()
+  {
+    batch.Eval(columns, points, out.data());
+    return ChecksumSum(out.data(), points);
+  });
+}
+
+/* Runs interval benchmarks: bounds of expression over box by sampling grid of points
+ * and by interval evaluation of sub-boxes. Sampled range is inside bounds, but is not guaranteed */
+static void RunIntervalBenches(const BenchParams &bench)
+{
+  Grammar grammar('=');
+  ExprTree tree = grammar.Compile("x * sin(y) + y^2 / (1 + x^2)=").first;
+  const Interval box[2] = {Interval(0, 1), Interval(0, 2)};
+  const size_t grid = 64;
+
+  double sampled_lo = HUGE_VAL, sampled_hi = -HUGE_VAL;
+  auto sample = [&]()
+  {
+    sampled_lo = HUGE_VAL, sampled_hi = -HUGE_VAL;
+    for (size_t i = 0; i <= grid; i++)
+    {
+      for (size_t j = 0; j <= grid; j++)
+      {
+        double point[2] = {box[0].lo + (box[0].hi - box[0].lo) * i / grid, box[1].lo + (box[1].hi - box[1].lo) * j / grid};
+        double value = tree.Eval(point);
+        sampled_lo = std::min(sampled_lo, value);
+        sampled_hi = std::max(sampled_hi, value);
+      }
+    }
+    return sampled_hi;
+  };
+  sample();
+  printf("\ninterval: sampled range of %zu points [%.6f, %.6f]\n", (grid + 1) * (grid + 1), sampled_lo, sampled_hi);
+
+  RunBench("interval-grid", bench, (grid + 1) * (grid + 1), "point", 0, sample);
+  for (size_t boxes : {(size_t)1, (size_t)64, (size_t)4096})
+  {
+    Interval bounds;
+    EvalIntervalBox(tree, box, bounds, boxes, 1);
+    printf("%zu boxes: [%.6f, %.6f]\n", boxes, bounds.lo, bounds.hi);
+
+    std::string name = "interval-" + std::to_string(boxes);
+    RunBench(name.c_str(), bench, boxes, "box", 0, [&]()
+    {
+      EvalIntervalBox(tree, box, bounds, boxes, 1);
+      return bounds.hi;
+    });
+  }
+}
+
+/* Runs batch benchmark of corpus in floating point type 'RealT' and returns results of all points.
+ * Columns are converted to the type beforehand, so memory traffic is the one of the type */
+template <typename RealT>
+static std::vector<long double> RunPrecisionBench(const char *name, const BenchParams &bench,
+                                                  const std::vector<ExprTree> &trees,
+                                                  const std::vector<std::string> &var_names,
+                                                  const std::vector<std::vector<double>> &columns)
+{
+  std::vector<std::vector<RealT>> typed_columns;
+  for (auto &column : columns) { typed_columns.emplace_back(column.begin(), column.end()); }
+
+  std::vector<BatchEvaluator<RealT>> batches;
+  std::vector<std::vector<const RealT *>> batch_vars(trees.size());
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    batches.emplace_back(trees[i]);
+    for (auto &var_name : trees[i].var_names)
+    {
+      size_t v = std::find(var_names.begin(), var_names.end(), var_name) - var_names.begin();
+      batch_vars[i].push_back(typed_columns[v].data());
+    }
+  }
+
+  std::vector<RealT> out(bench.points);
+  RunBench(name, bench, trees.size() * bench.points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      batches[i].Eval(batch_vars[i].data(), bench.points, out.data());
+      sum += ChecksumSum(out.data(), bench.points);
+    }
+    return sum;
+  });
+
+  std::vector<long double> results;
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    batches[i].Eval(batch_vars[i].data(), bench.points, out.data());
+    results.insert(results.end(), out.begin(), out.end());
+  }
+  return results;
+}
+
+/* Prints relative error of results against reference ones. Points with non-finite or zero reference are skipped */
+static void PrintAccuracy(const char *name, const std::vector<long double> &results,
+                          const std::vector<long double> &reference)
+{
+  std::vector<double> errors;
+  size_t mismatches = 0; /* finite reference, but non-finite result */
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    if (!std::isfinite(reference[i]) || reference[i] == 0)
+    {
+      continue;
+    }
+    if (!std::isfinite(results[i]))
+    {
+      mismatches++;
+      continue;
+    }
+    errors.push_back((double)fabsl((results[i] - reference[i]) / reference[i]));
+  }
+
+  if (errors.empty())
+  {
+    printf("%-14s no finite points\n", name);
+    return;
+  }
+  std::sort(errors.begin(), errors.end());
+  printf("%-14s relative error median %.3g, p99 %.3g, max %.3g over %zu points, %zu non-finite\n", name,
+         errors[errors.size() / 2], errors[errors.size() * 99 / 100], errors.back(), errors.size(), mismatches);
+}
+
+/* Returns name of 'let' binding number 'k' of script benchmark. Identifiers consist of letters only */
+static std::string BindingName(size_t k)
+{
+  std::string name = "tmp";
+  do
+  {
+    name.push_back((char)('a' + k % 26));
+    k /= 26;
+  } while (k != 0);
+  return name;
+}
+
+/* Checks if expression ended with '=' is finite at all 'points' points of variable columns */
+static bool IsFiniteOnColumns(Grammar &grammar, const std::string &expr, const std::vector<std::string> &var_names,
+                              const std::vector<std::vector<double>> &columns, size_t points)
+{
+  ExprTree tree = grammar.Compile(expr.c_str()).first;
+  BatchEvaluator<double> batch(tree);
+  std::vector<const double *> tree_columns;
+  for (auto &name : tree.var_names)
+  {
+    tree_columns.push_back(columns[std::find(var_names.begin(), var_names.end(), name) - var_names.begin()].data());
+  }
+
+  std::vector<double> out(points);
+  batch.Eval(tree_columns.data(), points, out.data());
+  return std::all_of(out.begin(), out.end(), [](double value) { return std::isfinite(value); });
+}
+
+/* Runs vector and matrix expression benchmarks, time is measured per element or per multiply-add */
+static void RunMatrixBenches(const BenchParams &bench)
+{
+  size_t n = bench.vector_size, size = bench.matrix_size;
+  std::map<std::string, Matrix> vars = {{"u", Matrix(n, 1)}, {"v", Matrix(n, 1)},
+                                        {"a", Matrix(size, size)}, {"b", Matrix(size, size)}};
+
+  for (auto &var : vars)
+  {
+    for (size_t i = 0; i < var.second.Size(); i++) { var.second.data[i] = sin(0.001 * i) + var.first[0]; }
+  }
+
+  Grammar grammar('=');
+  printf("\nvectors: %zu elements, matrices: %zu x %zu\n", n, size, size);
+
+  const std::pair<const char *, const char *> vector_exprs[] = {
+    {"dot", "dot(u, v)="}, {"norm", "norm(v)="}, {"elementwise", "sin(u) * v + u / 2="}};
+  for (auto &expr : vector_exprs)
+  {
+    RunBench(expr.first, bench, n, "elem", 0, [&]()
+    {
+      return grammar.CalcMatrixExpr(expr.second, vars).first.data[0];
+    });
+  }
+
+  RunBench("matmul", bench, size * size * size, "fma", 0, [&]()
+  {
+    return grammar.CalcMatrixExpr("matmul(a, b)=", vars).first.data[0];
+  });
+}
+
+/* Prints usage of benchmark */
+static void PrintUsage()
+{
+  printf("Usage: calc_bench [options]\n"
+         "  --count N        number of expressions in corpus\n"
+         "  --reps N         number of repeated runs\n"
+         "  --points N       number of points of batch evaluation\n"
+         "  --vector N       number of vector elements of matrix benchmarks\n"
+         "  --matrix N       matrix size of matrix benchmarks\n"
+         "  --seed N         random generator seed\n"
+         "  --depth N        maximal depth of expressions\n"
+         "  --ops W,W,W,W,W  relative frequencies of + - * / ^\n"
+         "  --funcs P        probability of function call\n"
+         "  --vars P         probability of leaf to be variable\n"
+         "  --literal-len N  maximal number of digits of literals\n");
+}
+
+/* Reads command line options. Returns 'false' on unknown option */
+static bool ParseArgs(int argc, char **argv, BenchParams &bench, GeneratorParams &gen)
+{
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const char *key = argv[i], *value = argv[i + 1];
+
+    if      (strcmp(key, "--count") == 0)       { bench.count = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--reps") == 0)        { bench.reps = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--points") == 0)      { bench.points = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--vector") == 0)      { bench.vector_size = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--matrix") == 0)      { bench.matrix_size = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--seed") == 0)        { gen.seed = strtoull(value, nullptr, 10); }
+    else if (strcmp(key, "--depth") == 0)       { gen.max_depth = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--funcs") == 0)       { gen.func_prob = strtod(value, nullptr); }
+    else if (strcmp(key, "--vars") == 0)        { gen.var_prob = strtod(value, nullptr); }
+    else if (strcmp(key, "--literal-len") == 0) { gen.literal_len = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--ops") == 0)
+    {
+      char *end = const_cast<char *>(value);
+      for (double &weight : gen.op_weights)
+      {
+        weight = strtod(end, &end);
+        if (*end == ',') { end++; }
+      }
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return argc % 2 == 1 && bench.count != 0 && bench.reps != 0 && bench.points != 0 &&
+         bench.vector_size != 0 && bench.matrix_size != 0;
+}
+
+int main(int argc, char **argv)
+{
+  BenchParams bench;
+  GeneratorParams gen;
+
+  if (!ParseArgs(argc, argv, bench, gen))
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  ExprGenerator generator(gen);
+  std::vector<std::string> corpus = generator.GenerateCorpus(bench.count);
+
+  size_t bytes = 0;
+  for (auto &expr : corpus) { bytes += expr.size(); }
+
+  printf("corpus: %zu expressions, %zu bytes, seed %llu, depth %u\n", corpus.size(), bytes, gen.seed, gen.max_depth);
+
+  Grammar grammar('=');
+  std::map<std::string, double> vars;
+  for (size_t i = 0; i < gen.vars.size(); i++) { vars[gen.vars[i]] = 0.5 + 0.25 * i; }
+
+  std::vector<ExprTree> trees;
+  std::vector<std::vector<double>> tree_vars;
+  for (auto &expr : corpus)
+  {
+    trees.push_back(grammar.Compile(expr.c_str()).first);
+
+    tree_vars.emplace_back();
+    for (auto &name : trees.back().var_names) { tree_vars.back().push_back(vars[name]); }
+  }
+
+  size_t excluded = 0; /* expressions with results excluded from checksums */
+  for (size_t i = 0; i < trees.size(); i++) { excluded += ChecksumTerm(trees[i].Eval(tree_vars[i].data())) == 0; }
+  printf("checksums: %zu of %zu expressions are zero, non-finite or greater than %g by magnitude\n\n", excluded,
+         trees.size(), CHECKSUM_LIMIT);
+
+  RunBench("parse", bench, bench.count, "expr", bytes, [&]()
+  {
+    double sum = 0;
+    for (auto &expr : corpus) { sum += grammar.Compile(expr.c_str()).first.nodes.size(); }
+    return sum;
+  });
+
+  RunBench("eval", bench, bench.count, "expr", bytes, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++) { sum += ChecksumTerm(trees[i].Eval(tree_vars[i].data())); }
+    return sum;
+  });
+
+  RunBench("end-to-end", bench, bench.count, "expr", bytes, [&]()
+  {
+    double sum = 0;
+    for (auto &expr : corpus) { sum += ChecksumTerm(grammar.CalcExpr(expr.c_str(), vars).first); }
+    return sum;
+  });
+
+  /* Variable columns of batch benchmarks. Complex points have the same real parts and nonzero imaginary ones */
+  std::vector<std::vector<double>> columns_re(gen.vars.size()), columns_im(gen.vars.size());
+  for (size_t v = 0; v < gen.vars.size(); v++)
+  {
+    for (size_t i = 0; i < bench.points; i++)
+    {
+      columns_re[v].push_back(vars[gen.vars[v]] + (double)i / bench.points);
+      columns_im[v].push_back(0.25 - 0.5 * i / bench.points);
+    }
+  }
+
+  std::vector<BatchEvaluator<double>> real_batches;
+  std::vector<BatchEvaluator<std::complex<double>>> complex_batches;
+  std::vector<std::vector<const double *>> batch_re(trees.size()), batch_im(trees.size());
+  for (size_t i = 0; i < trees.size(); i++)
+  {
+    real_batches.emplace_back(trees[i]);
+    complex_batches.emplace_back(trees[i]);
+
+    for (auto &name : trees[i].var_names)
+    {
+      size_t v = std::find(gen.vars.begin(), gen.vars.end(), name) - gen.vars.begin();
+      batch_re[i].push_back(columns_re[v].data());
+      batch_im[i].push_back(columns_im[v].data());
+    }
+  }
+
+  std::vector<double> out_re(bench.points), out_im(bench.points);
+  size_t points = bench.count * bench.points;
+
+  RunBench("point-real", bench, points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      std::vector<double> values(batch_re[i].size());
+      for (size_t p = 0; p < bench.points; p++)
+      {
+        for (size_t v = 0; v < values.size(); v++) { values[v] = batch_re[i][v][p]; }
+        sum += ChecksumTerm(trees[i].Eval(values.data()));
+      }
+    }
+    return sum;
+  });
+
+  RunBench("batch-real", bench, points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      real_batches[i].Eval(batch_re[i].data(), bench.points, out_re.data());
+      sum += ChecksumSum(out_re.data(), bench.points);
+    }
+    return sum;
+  });
+
+  RunBench("point-complex", bench, points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      std::vector<std::complex<double>> values(batch_re[i].size());
+      for (size_t p = 0; p < bench.points; p++)
+      {
+        for (size_t v = 0; v < values.size(); v++) { values[v] = {batch_re[i][v][p], batch_im[i][v][p]}; }
+        sum += ChecksumTerm(Evaluator<std::complex<double>>::Eval(trees[i], values.data()).real());
+      }
+    }
+    return sum;
+  });
+
+  RunBench("batch-complex", bench, points, "point", 0, [&]()
+  {
+    double sum = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      complex_batches[i].Eval(batch_re[i].data(), batch_im[i].data(), bench.points, out_re.data(), out_im.data());
+      sum += ChecksumSum(out_re.data(), bench.points);
+    }
+    return sum;
+  });
+
+  /* The same corpus in every precision. Accuracy is measured against extended precision results */
+  printf("\nprecision: corpus batches in float, double and long double\n");
+  std::vector<long double> float_results = RunPrecisionBench<float>("batch-float", bench, trees, gen.vars, columns_re);
+  std::vector<long double> double_results = RunPrecisionBench<double>("batch-double", bench, trees, gen.vars, columns_re);
+  std::vector<long double> long_results =
+    RunPrecisionBench<long double>("batch-long", bench, trees, gen.vars, columns_re);
+  PrintAccuracy("float", float_results, long_results);
+  PrintAccuracy("double", double_results, long_results);
+
+  /* Script of chained 'let' statements, each binding is read by the next statement. Statements which are
+   * not finite at some point are generated again, otherwise all the following bindings are not finite too.
+   * Statements which are not finite after SCRIPT_MAX_RETRIES attempts are skipped */
+  size_t statements = 0, regenerated = 0, skipped = 0;
+  std::string script;
+  for (size_t k = 0; k < std::min<size_t>(bench.count, 256); k++)
+  {
+    std::string statement = generator.Generate('=');
+    size_t retries = 0;
+    while (retries < SCRIPT_MAX_RETRIES && !IsFiniteOnColumns(grammar, statement, gen.vars, columns_re, bench.points))
+    {
+      statement = generator.Generate('=');
+      retries++;
+    }
+    regenerated += retries;
+    if (retries == SCRIPT_MAX_RETRIES)
+    {
+      skipped++;
+      continue;
+    }
+    statement.back() = ';';
+
+    script += "let " + BindingName(statements) + " = ";
+    script += (statements == 0 ? "" : BindingName(statements - 1) + " / 2 + ") + statement + " ";
+    statements++;
+  }
+  script += statements == 0 ? "0=" : BindingName(statements - 1) + "=";
+
+  ExprTree script_tree = grammar.Compile(script.c_str()).first;
+  BatchEvaluator<double> script_batch(script_tree);
+  std::vector<const double *> script_vars;
+  for (auto &name : script_tree.var_names)
+  {
+    size_t v = std::find(gen.vars.begin(), gen.vars.end(), name) - gen.vars.begin();
+    script_vars.push_back(columns_re[v].data());
+  }
+
+  const Program &program = script_batch.GetProgram();
+  printf("\nscript: %zu statements, %zu regenerated as non-finite, %zu skipped, %zu instructions, %zu registers\n",
+         statements, regenerated, skipped, program.code.size(), program.register_count);
+
+  RunBench("script-point", bench, bench.points, "point", 0, [&]()
+  {
+    double sum = 0;
+    std::vector<double> values(script_vars.size());
+    for (size_t p = 0; p < bench.points; p++)
+    {
+      for (size_t v = 0; v < values.size(); v++) { values[v] = script_vars[v][p]; }
+      sum += ChecksumTerm(script_tree.Eval(values.data()));
+    }
+    return sum;
+  });
+
+  RunBench("script-batch", bench, bench.points, "point", 0, [&]()
+  {
+    script_batch.Eval(script_vars.data(), bench.points, out_re.data());
+    return ChecksumSum(out_re.data(), bench.points);
+  });
+
+  RunSelectBenches(bench);
+  RunReduceBenches(bench);
+  RunIntervalBenches(bench);
+  RunMatrixBenches(bench);
+
+  ON_GRAMMAR_PROFILING(
+    printf("\n");
+    GrammarProfile::Total().DumpJSON(std::cout);
+  )
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "grammar.h"
+#include "column_table.h"
+
+/* Command line options of column evaluation tool */
+struct ColumnsParams
+{
+  std::string expr;                     /* Evaluated formula */
+  std::vector<std::string> csv_files;   /* CSV files whose columns are loaded */
+  std::vector<std::string> raw_columns; /* Raw columns in "name=file" form */
+  std::string out;                      /* Output column file */
+  std::string out_name = "result";      /* Output column name */
+  unsigned threads = 0;                 /* Number of threads, 0 means all hardware threads */
+  PRECISION precision = PRECISION_DOUBLE; /* Floating point type of calculation */
+};
+
+/* Prints usage of tool */
+static void PrintUsage()
+{
+  printf("Usage: calc_columns --expr EXPR [--csv FILE]... [--column NAME=FILE]... --out FILE [options]\n"
+         "  --expr EXPR        formula, variables are bound to columns by name\n"
+         "  --csv FILE         CSV file with header line of column names\n"
+         "  --column NAME=FILE raw file of native doubles\n"
+         "  --out FILE         result column, raw doubles or CSV if FILE ends with \".csv\"\n"
+         "  --name NAME        result column name in CSV output\n"
+         "  --threads N        number of threads, 0 uses all hardware threads\n"
+         "  --precision P      calculation type: float, double or long\n");
+}
+
+/* Reads command line options. Returns 'false' on unknown option */
+static bool ParseArgs(int argc, char **argv, ColumnsParams &params)
+{
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const char *key = argv[i], *value = argv[i + 1];
+
+    if      (strcmp(key, "--expr") == 0)    { params.expr = value; }
+    else if (strcmp(key, "--csv") == 0)     { params.csv_files.push_back(value); }
+    else if (strcmp(key, "--column") == 0)  { params.raw_columns.push_back(value); }
+    else if (strcmp(key, "--out") == 0)     { params.out = value; }
+    else if (strcmp(key, "--name") == 0)    { params.out_name = value; }
+    else if (strcmp(key, "--threads") == 0) { params.threads = (unsigned)strtoul(value, nullptr, 10); }
+    else if (strcmp(key, "--precision") == 0)
+    {
+      if      (strcmp(value, "float") == 0)  { params.precision = PRECISION_FLOAT; }
+      else if (strcmp(value, "double") == 0) { params.precision = PRECISION_DOUBLE; }
+      else if (strcmp(value, "long") == 0)   { params.precision = PRECISION_LONG_DOUBLE; }
+      else                                   { return false; }
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return argc % 2 == 1 && !params.expr.empty() && !params.out.empty();
+}
+
+/* Returns milliseconds since 'start' and restarts it */
+static double Lap(std::chrono::steady_clock::time_point &start)
+{
+  auto finish = std::chrono::steady_clock::now();
+  double result = std::chrono::duration<double, std::milli>(finish - start).count();
+  start = finish;
+  return result;
+}
+
+/* Reports error and returns exit status */
+static int Fail(const char *what, ERR_CODE code)
+{
+  fprintf(stderr, "%s: ", what);
+  print_err(std::cerr, code);
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  ColumnsParams params;
+  if (!ParseArgs(argc, argv, params))
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  ColumnTable table;
+  ERR_CODE code = SUCCESS;
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto &file : params.csv_files)
+  {
+    if ((code = table.ReadCsv(file.c_str(), params.threads)) != SUCCESS) { return Fail(file.c_str(), code); }
+  }
+  for (auto &column : params.raw_columns)
+  {
+    size_t separator = column.find('=');
+    if (separator == std::string::npos) { return Fail(column.c_str(), ERR_WRONG_INPUT); }
+
+    std::string name = column.substr(0, separator), file = column.substr(separator + 1);
+    if ((code = table.MapRawColumn(file.c_str(), name)) != SUCCESS) { return Fail(file.c_str(), code); }
+  }
+  double load_ms = Lap(start);
+
+  std::string expr = params.expr + "=";
+  std::pair<ExprTree, ERR_CODE> compiled = Grammar('=').Compile(expr.c_str());
+  if (compiled.second != SUCCESS) { return Fail(params.expr.c_str(), compiled.second); }
+
+  std::vector<double> result(table.Rows());
+  if ((code = EvalColumns(compiled.first, table, result.data(), params.threads, params.precision)) != SUCCESS)
+  {
+    return Fail(params.expr.c_str(), code);
+  }
+  double eval_ms = Lap(start);
+
+  if ((code = WriteColumn(params.out.c_str(), params.out_name, result.data(), result.size())) != SUCCESS)
+  {
+    return Fail(params.out.c_str(), code);
+  }
+  double write_ms = Lap(start);
+
+  size_t rows = table.Rows();
+  double input_mb = rows * compiled.first.var_names.size() * sizeof(double) / 1e6;
+  printf("rows %zu: load %.1f ms, eval %.1f ms (%.2f ns/row, %.0f MB/s of columns), write %.1f ms\n",
+         rows, load_ms, eval_ms, eval_ms * 1e6 / (rows != 0 ? rows : 1),
+         input_mb / (eval_ms != 0 ? eval_ms : 1) * 1e3, write_ms);
+  return 0;
+}
@@ -0,0 +1,301 @@
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "batch_eval.h"
+#include "grammar.h"
+#include "interval.h"
+#include "pipeline.h"
+
+/* Number of failed checks */
+static int failures = 0;
+
+/* Reports failed check of 'condition' described by 'what' */
+#define CHECK(condition, what)                                              \
+        {                                                                   \
+          if (!(condition))                                                 \
+          {                                                                 \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, what);         \
+            failures++;                                                     \
+          }                                                                 \
+        }
+
+/* Calculates expression ended with '=' at 'x' and returns result, NaN if there was an error */
+static double CalcAt(const char *expr, double x)
+{
+  Grammar grammar('=');
+  std::pair<double, ERR_CODE> result = grammar.CalcExpr(expr, {{"x", x}});
+  return result.second == SUCCESS ? result.first : NAN;
+}
+
+/* Checks if 'value' differs from 'expected' by at most 'rel_error' of 'expected' */
+static bool IsNear(double value, double expected, double rel_error)
+{
+  return fabs(value - expected) <= rel_error * fabs(expected);
+}
+
+/* Polynomial rewriting must not lose accuracy of factored forms and special values */
+static void TestPolynomials()
+{
+  double x = 1.001;
+
+  CHECK(IsNear(CalcAt("(x-1)^20=", x), pow(x - 1, 20), 1e-12),       "(x-1)^20 near 1")
+  CHECK(IsNear(CalcAt("(x-1)^5=", x), pow(x - 1, 5), 1e-12),         "(x-1)^5 near 1")
+  CHECK(CalcAt("(x-1.001)^3=", x) == 0,                               "(x-1.001)^3 at its root")
+  CHECK(IsNear(CalcAt("x*(x-1)=", x), x * (x - 1), 1e-12),           "x*(x-1) near 1")
+  CHECK(std::isnan(CalcAt("x*x-x*x=", 1e300)),                        "x*x-x*x overflows to NaN")
+  CHECK(IsNear(CalcAt("sum(i, 1, 2, (x-1)^5)=", x), 2 * pow(x - 1, 5), 1e-12), "(x-1)^5 in reduction body")
+
+  CHECK(CalcAt("3*x^2+2*x+1=", 2) == 17,                              "polynomial written term by term")
+  CHECK(CalcAt("2*x*x*x-x+5=", 3) == 56,                              "products of monomials")
+  CHECK(CalcAt("x/0=", 1) == HUGE_VAL,                                "variable over zero")
+  CHECK(CalcAt("x^2/0=", 2) == HUGE_VAL,                              "power of variable over zero")
+}
+
+/* Calculates interval of expression ended with '=' over 'x', Empty if there was an error */
+static Interval CalcOver(const char *expr, const Interval &x, size_t boxes = 1)
+{
+  Grammar grammar('=');
+  std::pair<Interval, ERR_CODE> result = grammar.CalcIntervalExpr(expr, {{"x", x}}, boxes);
+  return result.second == SUCCESS ? result.first : Interval::Empty();
+}
+
+/* Checks if 'value' contains 'expected' and exceeds it by at most 'error' at finite bounds */
+static bool IsTight(const Interval &value, const Interval &expected, double error)
+{
+  return value.lo <= expected.lo && value.hi >= expected.hi &&
+         (std::isinf(expected.lo) ? value.lo == expected.lo : expected.lo - value.lo <= error) &&
+         (std::isinf(expected.hi) ? value.hi == expected.hi : value.hi - expected.hi <= error);
+}
+
+/* Division by intervals with zero at a bound gives half-lines */
+static void TestIntervals()
+{
+  CHECK(IsTight(Interval(1) / Interval(0, 1), Interval(1, HUGE_VAL), 1e-15),      "1/[0,1]")
+  CHECK(IsTight(Interval(1) / Interval(-1, 0), Interval(-HUGE_VAL, -1), 1e-15),   "1/[-1,0]")
+  CHECK(IsTight(Interval(-2, -1) / Interval(0, 2), Interval(-HUGE_VAL, -0.5), 1e-15), "[-2,-1]/[0,2]")
+  CHECK(IsTight(Interval(-2, -1) / Interval(-2, 0), Interval(0.5, HUGE_VAL), 1e-15),  "[-2,-1]/[-2,0]")
+  CHECK(IsTight(Interval(1) / Interval(-1, 1), Interval::Entire(), 0),            "1/[-1,1]")
+  CHECK(IsTight(Interval(-1, 1) / Interval(0, 1), Interval::Entire(), 0),         "[-1,1]/[0,1]")
+  CHECK((Interval(1) / Interval(0)).IsEmpty(),                                    "1/[0,0]")
+
+  Interval unit(0, 1);
+  CHECK(IsTight(CalcOver("1/x=", unit), Interval(1, HUGE_VAL), 1e-12),            "1/x over [0,1]")
+  CHECK(IsTight(CalcOver("cot(x)=", unit), Interval(1 / tan(1), HUGE_VAL), 1e-12),  "cot(x) over [0,1]")
+  CHECK(IsTight(CalcOver("cot(x)=", Interval(-1, 0)), Interval(-HUGE_VAL, -1 / tan(1)), 1e-12), "cot(x) over [-1,0]")
+  CHECK(IsTight(CalcOver("1/x+x=", unit, 4096), Interval(2, HUGE_VAL), 1e-3),      "1/x+x over [0,1] split")
+  CHECK(IsTight(CalcOver("1/x=", Interval(-1, 1), 4096), Interval::Entire(), 0),   "1/x over [-1,1] split")
+
+  Interval negative = IntervalPow(Interval(-2, -1.9999999), Interval(1.5, 2.5));
+  CHECK(negative.Contains(4) && negative.hi - negative.lo < 1e-5,                 "negative base, integer 2 in exponent")
+  Interval straddling = IntervalPow(Interval(-1, 2), Interval(1.5, 3.5));
+  CHECK(straddling.Contains(-1) && straddling.Contains(pow(2, 3.5)),              "base straddling 0")
+  CHECK(IntervalPow(Interval(-2, -1), Interval(0.2, 0.8)).IsEmpty(),              "negative base, no integer exponent")
+  Interval many = IntervalPow(Interval(-2, -0.5), Interval(0, 100));
+  CHECK(many.Contains(pow(-2, 99)) && many.Contains(pow(-2, 100)),                "negative base, many integer exponents")
+  Interval folded = CalcOver("sum(k, 1, 10, 1/3) - 10/3=", unit);
+  CHECK(folded.Contains(0) && folded.hi - folded.lo < 1e-13,                     "reduction is not folded in double")
+  Interval poly = CalcOver("x^2 + 2*x + 1=", unit);
+  CHECK(poly.Contains(1) && poly.Contains(4) && poly.hi - poly.lo < 3 + 1e-13,   "polynomial is not folded in double")
+}
+
+/* Recursive calls, exceeded inline limit and errors in function bodies are reported with their own codes */
+static void TestFunctions()
+{
+  Grammar grammar('=');
+
+  CHECK(grammar.Define("f(x) = f(x) + 1=") == ERR_RECURSION,                       "direct recursion")
+  CHECK(strcmp(grammar.GetLastError().expected, "non-recursive call") == 0,        "direct recursion hint")
+
+  CHECK(grammar.Define("g(x) = x + 1=") == SUCCESS,                                "definition of g")
+  CHECK(grammar.Define("f(x) = g(x) * 2=") == SUCCESS,                             "definition of f")
+  CHECK(grammar.Define("g(x) = f(x)=") == ERR_RECURSION,                           "mutual recursion")
+  CHECK(strcmp(grammar.GetLastError().expected, "non-recursive call") == 0,        "mutual recursion hint")
+
+  CHECK(grammar.Define("h(x) = g(x, 1)=") == FAILURE,                              "call with extra argument")
+  CHECK(grammar.Define("h(x) = x * x + x=") == SUCCESS,                            "definition of h")
+  CHECK(grammar.Define("k(x) = h(h(x))=") == SUCCESS,                              "definition of k")
+  CHECK(grammar.Define("h(x, y) = x * y=") == SUCCESS,                             "redefinition of h")
+  CHECK(grammar.Compile("k(1)=").second == FAILURE,                                "call of outdated body")
+  CHECK(strcmp(grammar.GetLastError().expected, "','") == 0,                       "innermost expected token")
+
+  grammar.SetInlineLimit(10);
+  CHECK(grammar.Define("h(x) = x * x + x * x + x=") == SUCCESS,                    "definition of long h")
+  CHECK(grammar.Compile("k(1)=").second == ERR_INLINE_LIMIT,                       "inline limit")
+  CHECK(strcmp(grammar.GetLastError().expected, "fewer inlined calls") == 0,       "inline limit hint")
+}
+
+/* Evaluates expression ended with '=' of variable x by batch evaluator at one point */
+template <typename RealT>
+static RealT BatchAt(const char *expr, RealT x)
+{
+  Grammar grammar('=');
+  BatchEvaluator<RealT> batch(grammar.Compile(expr).first);
+  const RealT *columns[1] = {&x};
+  RealT result = 0;
+  batch.Eval(columns, 1, &result);
+  return result;
+}
+
+/* Reductions of variables are loops of batch program, whose counter must not depend on precision of index */
+static void TestReductions()
+{
+  CHECK(BatchAt<float>("sum(k, 16777200, 16777300, x)=", 1.0f) == 101,            "float loop past 2^24")
+  CHECK(BatchAt<double>("sum(k, 9007199254740990, 9007199254740992, x)=", 1.0) == 3, "double loop up to 2^53")
+  CHECK(BatchAt<double>("sum(k, 1, 4, k * x)=", 2.0) == 20,                         "index values in loop")
+
+  CHECK(CalcAt("sum(k, 1, 10, 0.1)=", 0) == 1,                                     "compensated folded sum")
+  CHECK(CalcAt("sum(k, 1, 10, x)=", 0.1) == 1,                                     "compensated sum of variable")
+  CHECK(BatchAt<double>("sum(k, 1, 10, x)=", 0.1) == 1,                             "compensated batch sum")
+  CHECK(CalcAt("prod(k, 1, 5, k + x)=", 1) == 720,                                 "product of variable")
+  CHECK(CalcAt("sum(k, 3, 2, x) + prod(k, 3, 2, x)=", 5) == 1,                     "empty ranges")
+
+  CHECK(CalcAt("1/prod(k, 1, 1, -0.0/k)=", 0) == -HUGE_VAL,                        "folded product of -0")
+  CHECK(CalcAt("1/prod(k, 1, 3, x)=", -0.0) == -HUGE_VAL,                          "product of -0")
+  CHECK(BatchAt<double>("1/prod(k, 1, 3, x)=", -0.0) == -HUGE_VAL,                  "batch product of -0")
+}
+
+/* Exactly representable literals are folded in 64-bit rational arithmetic, overflowing ones in 'double' */
+static void TestLiterals()
+{
+  CHECK(CalcAt("0.1 + 0.2 - 0.3=", 0) == 0,                                        "exact decimal fractions")
+  CHECK(CalcAt("(1/3 + 1/6) * 6=", 0) == 3,                                        "exact common fractions")
+  CHECK(CalcAt("2^62 * 2 - 2^63=", 0) == 0,                                        "integer overflow fallback")
+  CHECK(CalcAt("3^40=", 0) == pow(3.0, 40),                                        "power overflow fallback")
+  CHECK(CalcAt("1/3^40=", 0) == 1 / pow(3.0, 40),                                  "denominator overflow fallback")
+
+  CHECK(CalcAt("1/-0=", 0) == -HUGE_VAL,                                           "negative zero literal")
+  CHECK(CalcAt("x/-0=", 1) == -HUGE_VAL,                                           "division by negative zero")
+  CHECK(std::signbit(CalcAt("-0.0=", 0)),                                          "sign of zero literal")
+}
+
+/* Evaluates complex expression ended with '=' of variable x by batch evaluator at one point */
+static std::complex<double> ComplexBatchAt(const char *expr, std::complex<double> x)
+{
+  Grammar grammar('=', MODE_COMPLEX);
+  BatchEvaluator<std::complex<double>> batch(grammar.Compile(expr).first);
+  double x_re = x.real(), x_im = x.imag(), re = 0, im = 0;
+  const double *columns_re[1] = {&x_re};
+  const double *columns_im[1] = {&x_im};
+  batch.Eval(columns_re, columns_im, 1, &re, &im);
+  return std::complex<double>(re, im);
+}
+
+/* Batch kernels must agree with scalar functions at zero: sign of zero argument of odd functions is kept,
+ * power of zero base depends on real part of exponent */
+static void TestZeros()
+{
+  CHECK(std::signbit(BatchAt<double>("sin(x)=", -0.0)),                             "sine of -0")
+  CHECK(std::signbit(BatchAt<double>("tan(x)=", -0.0)),                             "tangent of -0")
+  CHECK(BatchAt<double>("cot(x)=", -0.0) == -HUGE_VAL,                              "cotangent of -0")
+  CHECK(std::signbit(BatchAt<float>("sin(x)=", -0.0f)),                             "float sine of -0")
+  CHECK(!std::signbit(BatchAt<double>("sin(x)=", 0.0)),                             "sine of +0")
+
+  CHECK(ComplexBatchAt("x^2=", 0.0) == std::complex<double>(0, 0),                  "zero base, positive exponent")
+  CHECK(ComplexBatchAt("x^(1+i)=", 0.0) == std::complex<double>(0, 0),              "zero base, complex exponent")
+  CHECK(ComplexBatchAt("x^(0-1)=", 0.0).real() == HUGE_VAL,                         "zero base, negative exponent")
+  CHECK(ComplexBatchAt("x^(0-0.5+i)=", 0.0).real() == HUGE_VAL,                     "zero base, negative real part")
+  CHECK(ComplexBatchAt("x^(x-x)=", 0.0) == std::complex<double>(1, 0),              "zero base, zero exponent")
+}
+
+/* Reads the whole file from its beginning */
+static std::string ReadAll(FILE *file)
+{
+  std::string text;
+  char chunk[4096];
+  size_t size = 0;
+
+  rewind(file);
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) != 0)
+  {
+    text.append(chunk, size);
+  }
+  return text;
+}
+
+/* Runs pipeline on 'text' and returns its output, "pipeline failed" on error */
+static std::string RunLines(const std::string &text, const PipelineParams &params, std::vector<StageStats> &stats)
+{
+  FILE *in = tmpfile(), *out = tmpfile();
+  fwrite(text.data(), 1, text.size(), in);
+  rewind(in);
+
+  ERR_CODE code = RunPipeline(in, out, params, stats);
+  std::string output = code == SUCCESS ? ReadAll(out) : "pipeline failed";
+  fclose(in);
+  fclose(out);
+  return output;
+}
+
+/* Pipeline writes results in input order whatever threads calculate them, reader waits for writer when
+ * one batch is slow, and failed lines are described in side file */
+static void TestPipeline()
+{
+  PipelineParams params;
+  params.parsers = 3;
+  params.evaluators = 3;
+  params.batch_lines = 3;
+  params.queue_capacity = 2;
+  params.vars["x"] = 0.5;
+  std::vector<StageStats> stats;
+
+  std::string text, expected;
+  char line[64];
+  for (int k = 1; k <= 30000; k++)
+  {
+    snprintf(line, sizeof(line), "%d * 2 + x\n", k);
+    text += line;
+    snprintf(line, sizeof(line), "%.17g\n", k * 2 + 0.5);
+    expected += line;
+  }
+  CHECK(RunLines(text, params, stats) == expected,                                  "order of results")
+  CHECK(stats[0].lines == 30000 && stats[3].lines == 30000,                         "all lines are read and written")
+
+  CHECK(RunLines("", params, stats).empty(),                                         "empty input")
+  CHECK(RunLines("1+1\n2+2\n3+3", params, stats) == "2\n4\n6\n",                  "last line without line feed")
+  CHECK(RunLines("1+1\r\n2+2\n", params, stats) == "2\n4\n",                        "carriage return")
+
+  /* The first line takes much longer than the rest. Reader must not run more than PIPELINE_WINDOW (4) queue
+   * capacities ahead of writer, so the rest of lines do not pile up in reorder buffer */
+  params.batch_lines = 1;
+  text = "sum(k, 1, 50000000, x) * 0\n";
+  for (int k = 0; k < 20000; k++)
+  {
+    text += "x\n";
+  }
+  std::string output = RunLines(text, params, stats);
+  CHECK(output.compare(0, 4, "0\n0.") == 0 && stats[3].lines == 20001,             "slow first line")
+  CHECK(stats[3].max_pending <= 4 * 2,                                              "reader waits for writer")
+
+  params.batch_lines = 2;
+  CHECK(RunLines("1+1\n2*(3\ny\n", params, stats) == "2\nerror 1\nerror 16\n",   "errors in output")
+
+  params.errors = tmpfile();
+  CHECK(RunLines("1+1\n2*(3\ny\n", params, stats) == "2\n\n\n",                    "failed lines are empty")
+  CHECK(ReadAll(params.errors) == "2:4: error 1, expected ')': 2*(3\n"
+                                  "3:0: error 16, expected value of every variable: y\n", "side file records")
+  fclose(params.errors);
+}
+
+int main()
+{
+  TestPolynomials();
+  TestIntervals();
+  TestFunctions();
+  TestReductions();
+  TestLiterals();
+  TestZeros();
+  TestPipeline();
+
+  if (failures != 0)
+  {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+
+  printf("All checks passed\n");
+  return 0;
+}
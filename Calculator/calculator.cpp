@@ -1,20 +1,79 @@
+#include <cmath>
+#include <sstream>
+
 #include "calculator.h"
 #include "text_colors.h"
+#include "grammar_profile.h"
+
+/* File to write grammar profiling counters to */
+#define PROFILE_FILE_NAME "grammar_profile.json"
+
+/* Maximal number of printed rows and columns of matrix */
+#define MATRIX_PRINT_MAX 8
+
+/* Number of sub-boxes expressions over variable ranges are split into */
+#define RANGE_BOXES 4096
 
 /* Prints menu of calculator */
 void Calculator::PrintMenu()
 {
   auto &os = std::cout;
 
-  os << "Enter \"baranka\" to exit or\n";
+  os << "Enter \"baranka\" to exit, \"complex\" or \"real\" to switch number field,\n";
+  os << "\"precision float\", \"precision double\" or \"precision long\" to switch type of real calculation,\n";
+  os << "\"load <name> <file>\" to bind binary vector or matrix file to variable,\n";
+  os << "\"range <name> <lo> <hi>\" to bind interval to variable and calculate bounds of expressions,\n";
+  os << "\"def <name>(<params>) = <expression>\" to define function or\n";
   os << "enter expression to calculate:\n";
 }
 
+/* Prints position and expected token of expression error */
+void Calculator::PrintError(const ParseError &error)
+{
+  std::cout << RED << "Entered expression has wrong format";
+  if (error.code != ERR_WRONG_INPUT) /* errors found after parsing have no position */
+  {
+    std::cout << " at position " << error.offset + 1;
+  }
+  if (*error.expected != '\0')
+  {
+    std::cout << ", expected " << error.expected;
+  }
+  std::cout << ". Try again.";
+}
+
+/* Prints matrix, shows only its corner if it is big */
+void Calculator::PrintMatrix(const Matrix &value)
+{
+  if (value.IsScalar())
+  {
+    std::cout << value.data[0];
+    return;
+  }
+
+  std::cout << value.rows << " x " << value.cols;
+  for (size_t row = 0; row < value.rows && row < MATRIX_PRINT_MAX; row++)
+  {
+    std::cout << std::endl;
+    for (size_t col = 0; col < value.cols && col < MATRIX_PRINT_MAX; col++)
+    {
+      std::cout << value.data[row * value.cols + col] << " ";
+    }
+    if (value.cols > MATRIX_PRINT_MAX) { std::cout << "..."; }
+  }
+  if (value.rows > MATRIX_PRINT_MAX) { std::cout << std::endl << "..."; }
+}
+
 /* Initiates the work of calculator */
 void Calculator::Start()
 {
   auto &is = std::cin;
   std::string input;
+  CALC_MODE mode = MODE_REAL;
+  PRECISION precision = PRECISION_DOUBLE;
+  std::map<std::string, Matrix> matrices; /* Variables bound to vector and matrix files */
+  FunctionTable functions;                /* User-defined functions */
+  std::map<std::string, Interval> ranges; /* Variables bound to intervals */
 
   while (true)
   {
@@ -23,16 +82,177 @@ void Calculator::Start()
 
     if (input == "baranka")
     {
+      ON_GRAMMAR_PROFILING(
+        std::ofstream profile_file(PROFILE_FILE_NAME);
+        GrammarProfile::Total().DumpJSON(profile_file);
+      )
       return;
     }
 
+    if (input == "complex" || input == "real")
+    {
+      mode = input == "complex" ? MODE_COMPLEX : MODE_REAL;
+      std::cout << std::endl;
+      continue;
+    }
+
+    if (input == "precision float" || input == "precision double" || input == "precision long")
+    {
+      precision = input == "precision float" ? PRECISION_FLOAT :
+                  (input == "precision long" ? PRECISION_LONG_DOUBLE : PRECISION_DOUBLE);
+      std::cout << std::endl;
+      continue;
+    }
+
+    if (input.compare(0, 5, "load ") == 0)
+    {
+      std::istringstream command(input.substr(5));
+      std::string name, file_name;
+      command >> name >> file_name;
+      for (char &symbol : name) { symbol = (char)tolower(symbol); } /* identifiers are case insensitive */
+
+      Matrix value;
+      ERR_CODE code = LoadMatrix(file_name.c_str(), value);
+      if (code == SUCCESS)
+      {
+        matrices[name] = std::move(value);
+        std::cout << MAGENTA << name << ": " << matrices[name].rows << " x " << matrices[name].cols;
+      }
+      else
+      {
+        std::cout << RED << "Cannot load \"" << file_name << "\": ";
+        print_err(std::cout, code);
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
+
+    if (input.compare(0, 6, "range ") == 0)
+    {
+      std::istringstream command(input.substr(6));
+      std::string name;
+      Interval value;
+      command >> name >> value.lo >> value.hi;
+      for (char &symbol : name) { symbol = (char)tolower(symbol); } /* identifiers are case insensitive */
+
+      if (command && value.lo <= value.hi)
+      {
+        ranges[name] = value;
+        std::cout << MAGENTA << name << ": [" << value.lo << ", " << value.hi << "]";
+      }
+      else
+      {
+        std::cout << RED << "Range must be \"range <name> <lo> <hi>\" with lo <= hi";
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
+
     if (input.back() != '=') { input.push_back('='); }
 
-    Grammar grammar('=');
-    std::pair<double, ERR_CODE> result = grammar.CalcExpr(input.c_str());
+    if (input.compare(0, 4, "def ") == 0)
+    {
+      Grammar grammar('=', mode);
+      grammar.SetFunctions(functions);
+
+      ERR_CODE code = grammar.Define(input.c_str() + 4);
+      if (code == SUCCESS)
+      {
+        functions = grammar.GetFunctions();
+        std::cout << MAGENTA << "Function is defined";
+      }
+      else
+      {
+        std::cout << RED << "Cannot define function: ";
+        print_err(std::cout, code);
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
+
+    Grammar grammar('=', mode);
+    grammar.SetFunctions(functions);
+
+    if (mode == MODE_REAL && !matrices.empty())
+    {
+      std::pair<Matrix, ERR_CODE> matrix_result = grammar.CalcMatrixExpr(input.c_str(), matrices);
+
+      if (matrix_result.second != SUCCESS)
+      {
+        PrintError(grammar.GetLastError());
+      }
+      else
+      {
+        std::cout << MAGENTA;
+        PrintMatrix(matrix_result.first);
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
+
+    if (mode == MODE_REAL && !ranges.empty())
+    {
+      std::pair<Interval, ERR_CODE> range_result = grammar.CalcIntervalExpr(input.c_str(), ranges, RANGE_BOXES);
+
+      if (range_result.second != SUCCESS)
+      {
+        PrintError(grammar.GetLastError());
+      }
+      else if (range_result.first.IsEmpty())
+      {
+        std::cout << MAGENTA << "Expression is not defined over given ranges";
+      }
+      else
+      {
+        std::cout << MAGENTA << "[" << range_result.first.lo << ", " << range_result.first.hi << "]";
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
 
-    result.second != SUCCESS ? std::cout << RED << "Entered expression has wrong format. Try again."
-                             : std::cout << MAGENTA << result.first;
+    if (mode == MODE_REAL && precision != PRECISION_DOUBLE)
+    {
+      std::pair<long double, ERR_CODE> real_result = grammar.CalcExpr(input.c_str(), {}, precision);
+
+      if (real_result.second != SUCCESS)
+      {
+        PrintError(grammar.GetLastError());
+      }
+      else
+      {
+        std::streamsize digits = std::cout.precision(precision == PRECISION_FLOAT ? 7 : 19);
+        std::cout << MAGENTA << real_result.first;
+        std::cout.precision(digits);
+      }
+      std::cout << RESET << std::endl << std::endl;
+      continue;
+    }
+
+    std::pair<std::complex<double>, ERR_CODE> result(0, SUCCESS);
+
+    if (mode == MODE_REAL)
+    {
+      std::pair<double, ERR_CODE> real_result = grammar.CalcExpr(input.c_str());
+      result = {real_result.first, real_result.second};
+    }
+    else
+    {
+      result = grammar.CalcComplexExpr(input.c_str());
+    }
+
+    if (result.second != SUCCESS)
+    {
+      PrintError(grammar.GetLastError());
+    }
+    else if (mode == MODE_REAL)
+    {
+      std::cout << MAGENTA << result.first.real();
+    }
+    else
+    {
+      std::cout << MAGENTA << result.first.real() << (std::signbit(result.first.imag()) ? " - " : " + ")
+                << fabs(result.first.imag()) << "i";
+    }
     std::cout << RESET << std::endl << std::endl;
   }
 }
@@ -6,7 +6,9 @@
 class Calculator
 {
 private:
-  static void PrintMenu(); /* Prints menu of calculator */
+  static void PrintMenu();                     /* Prints menu of calculator */
+  static void PrintMatrix(const Matrix &value); /* Prints matrix, shows only its corner if it is big */
+  static void PrintError(const ParseError &error); /* Prints position and expected token of expression error */
 
 public:
   /* Class constructor */
@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "column_table.h"
+#include "batch_eval.h"
+#include "parallel.h"
+
+/* Minimal size of CSV chunk given to separate thread */
+#define CSV_MIN_CHUNK (1 << 16)
+
+/* Maximal length of number which is copied for 'strtod' */
+#define NUMBER_MAX_LEN 64
+
+/* Number parsing is exact by one multiplication or division while both mantissa and power of ten
+ * are exactly representable as 'double' */
+#define FAST_MAX_DIGITS   19                   /* Digits accumulated into 64-bit mantissa */
+#define FAST_MAX_MANTISSA (1ULL << 53)
+#define FAST_MAX_POWER    22
+
+/* Exactly representable powers of ten */
+static const double POW10[FAST_MAX_POWER + 1] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Maps whole file into memory for reading. Returns nullptr on error */
+static void *MapFile(const char *file_name, size_t &size, ERR_CODE &code)
+{
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0)
+  {
+    code = ERR_FILE_OPEN;
+    return nullptr;
+  }
+
+  struct stat file_stat = {};
+  if (fstat(fd, &file_stat) != 0)
+  {
+    close(fd);
+    code = ERR_STAT;
+    return nullptr;
+  }
+
+  size = (size_t)file_stat.st_size;
+  if (size == 0)
+  {
+    close(fd);
+    code = ERR_UNEXP_EOF;
+    return nullptr;
+  }
+
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED)
+  {
+    code = ERR_FILE_OPERATE;
+    return nullptr;
+  }
+
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  code = SUCCESS;
+  return mapping;
+}
+
+/* Parses number occupying whole [begin, end). Decimal numbers with mantissa up to 2^53 and small power
+ * are calculated exactly by one multiplication or division, others are given to 'strtod'. Empty field is NaN */
+static bool ParseNumber(const char *begin, const char *end, double &value)
+{
+  while (begin < end && *begin == ' ') { begin++; }
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\r')) { end--; }
+
+  if (begin == end)
+  {
+    value = std::numeric_limits<double>::quiet_NaN();
+    return true;
+  }
+
+  const char *ptr = begin;
+  bool is_negative = *ptr == '-';
+  if (*ptr == '-' || *ptr == '+') { ptr++; }
+
+  uint64_t mantissa = 0;
+  int digits = 0, power = 0;
+  bool has_digits = false;
+
+  for (; ptr < end && '0' <= *ptr && *ptr <= '9'; ptr++, has_digits = true)
+  {
+    if (mantissa != 0 || *ptr != '0') { digits++; }
+    if (digits <= FAST_MAX_DIGITS)    { mantissa = mantissa * 10 + (*ptr - '0'); }
+    else                              { power++; }
+  }
+
+  if (ptr < end && *ptr == '.')
+  {
+    for (ptr++; ptr < end && '0' <= *ptr && *ptr <= '9'; ptr++, has_digits = true)
+    {
+      if (mantissa != 0 || *ptr != '0') { digits++; }
+      if (digits <= FAST_MAX_DIGITS)    { mantissa = mantissa * 10 + (*ptr - '0'); power--; }
+    }
+  }
+
+  if (has_digits && ptr < end && (*ptr == 'e' || *ptr == 'E'))
+  {
+    const char *exp_ptr = ptr + 1;
+    bool is_exp_negative = exp_ptr < end && *exp_ptr == '-';
+    if (exp_ptr < end && (*exp_ptr == '-' || *exp_ptr == '+')) { exp_ptr++; }
+
+    int exponent = 0;
+    const char *exp_digits = exp_ptr;
+    for (; exp_ptr < end && '0' <= *exp_ptr && *exp_ptr <= '9' && exponent < 100000; exp_ptr++)
+    {
+      exponent = exponent * 10 + (*exp_ptr - '0');
+    }
+
+    if (exp_ptr != exp_digits)
+    {
+      power += is_exp_negative ? -exponent : exponent;
+      ptr = exp_ptr;
+    }
+  }
+
+  if (has_digits && ptr == end && digits <= FAST_MAX_DIGITS && mantissa <= FAST_MAX_MANTISSA &&
+      -FAST_MAX_POWER <= power && power <= FAST_MAX_POWER)
+  {
+    value = power < 0 ? (double)mantissa / POW10[-power] : (double)mantissa * POW10[power];
+    value = is_negative ? -value : value;
+    return true;
+  }
+
+  /* long, 'nan', 'inf' and other rare forms */
+  char number[NUMBER_MAX_LEN + 1];
+  size_t length = end - begin;
+  if (length > NUMBER_MAX_LEN)
+  {
+    return false;
+  }
+
+  memcpy(number, begin, length);
+  number[length] = '\0';
+
+  char *number_end = nullptr;
+  value = strtod(number, &number_end);
+  return number_end == number + length;
+}
+
+/* Returns end of line starting at 'line', which is '\n' position or 'end' */
+static const char *LineEnd(const char *line, const char *end)
+{
+  const char *line_end = (const char *)memchr(line, '\n', end - line);
+  return line_end == nullptr ? end : line_end;
+}
+
+/* Checks if line contains nothing but '\r' and spaces */
+static bool IsBlankLine(const char *line, const char *line_end)
+{
+  for (; line < line_end; line++)
+  {
+    if (*line != ' ' && *line != '\r') { return false; }
+  }
+  return true;
+}
+
+/* Counts not blank lines of chunk */
+static size_t CountRows(const char *chunk, const char *chunk_end)
+{
+  size_t count = 0;
+  while (chunk < chunk_end)
+  {
+    const char *line_end = LineEnd(chunk, chunk_end);
+    count += IsBlankLine(chunk, line_end) ? 0 : 1;
+    chunk = line_end + 1;
+  }
+  return count;
+}
+
+/* Parses not blank lines of chunk into 'columns' starting from row 'row' */
+static ERR_CODE ParseRows(const char *chunk, const char *chunk_end, double *const *columns, size_t column_count,
+                          size_t row)
+{
+  while (chunk < chunk_end)
+  {
+    const char *line_end = LineEnd(chunk, chunk_end);
+    if (IsBlankLine(chunk, line_end))
+    {
+      chunk = line_end + 1;
+      continue;
+    }
+
+    const char *field = chunk;
+    for (size_t col = 0; col < column_count; col++)
+    {
+      if (field > line_end) /* missing fields */
+      {
+        return ERR_WRONG_INPUT;
+      }
+
+      const char *field_end = (const char *)memchr(field, ',', line_end - field);
+      if (field_end == nullptr) { field_end = line_end; }
+
+      if (!ParseNumber(field, field_end, columns[col][row]))
+      {
+        return ERR_WRONG_INPUT;
+      }
+      field = field_end + 1;
+    }
+
+    if (field <= line_end) /* extra fields */
+    {
+      return ERR_WRONG_INPUT;
+    }
+
+    row++;
+    chunk = line_end + 1;
+  }
+
+  return SUCCESS;
+}
+
+/* Column names are case insensitive as variable names */
+static std::string ColumnName(const char *begin, const char *end)
+{
+  while (begin < end && *begin == ' ') { begin++; }
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\r')) { end--; }
+
+  std::string name(begin, end);
+  for (char &symbol : name) { symbol = (char)tolower(symbol); }
+  return name;
+}
+
+/* Class destructor, unmaps mapped columns */
+ColumnTable::~ColumnTable()
+{
+  for (auto &column : columns)
+  {
+    if (column.mapping != nullptr)
+    {
+      munmap(column.mapping, column.mapping_size);
+    }
+  }
+}
+
+/* Adds column checking number of rows */
+ERR_CODE ColumnTable::AddColumn(Column &&column, size_t column_rows)
+{
+  if (!columns.empty() && column_rows != rows)
+  {
+    if (column.mapping != nullptr) { munmap(column.mapping, column.mapping_size); }
+    return ERR_WRONG_INPUT;
+  }
+
+  rows = column_rows;
+  columns.push_back(std::move(column));
+  return SUCCESS;
+}
+
+/* Maps raw column file into memory and adds it as column 'name' */
+ERR_CODE ColumnTable::MapRawColumn(const char *file_name, const std::string &name)
+{
+  Column column;
+  ERR_CODE code = SUCCESS;
+
+  column.name = ColumnName(name.data(), name.data() + name.size());
+  column.mapping = MapFile(file_name, column.mapping_size, code);
+  if (code != SUCCESS)
+  {
+    return code;
+  }
+
+  if (column.mapping_size % sizeof(double) != 0)
+  {
+    munmap(column.mapping, column.mapping_size);
+    return ERR_UNEXP_EOF;
+  }
+
+  column.data = (const double *)column.mapping;
+  return AddColumn(std::move(column), column.mapping_size / sizeof(double));
+}
+
+/* Reads all columns of CSV file with header line of column names */
+ERR_CODE ColumnTable::ReadCsv(const char *file_name, unsigned threads)
+{
+  size_t size = 0;
+  ERR_CODE code = SUCCESS;
+  const char *text = (const char *)MapFile(file_name, size, code);
+  if (code != SUCCESS)
+  {
+    return code;
+  }
+  const char *text_end = text + size;
+
+  /* header */
+  std::vector<Column> new_columns;
+  const char *header_end = LineEnd(text, text_end);
+  for (const char *field = text; field <= header_end;)
+  {
+    const char *field_end = (const char *)memchr(field, ',', header_end - field);
+    if (field_end == nullptr) { field_end = header_end; }
+
+    new_columns.emplace_back();
+    new_columns.back().name = ColumnName(field, field_end);
+    field = field_end + 1;
+  }
+
+  /* chunks start after line ends, so every line belongs to one chunk */
+  const char *data = std::min(header_end + 1, text_end);
+  size_t data_size = text_end - data;
+  unsigned chunk_count = (unsigned)std::max((size_t)1, std::min((size_t)ThreadCount(threads), data_size / CSV_MIN_CHUNK));
+
+  std::vector<const char *> bounds(chunk_count + 1, text_end);
+  bounds[0] = data;
+  for (unsigned chunk = 1; chunk < chunk_count; chunk++)
+  {
+    const char *bound = std::max(bounds[chunk - 1], data + data_size * chunk / chunk_count);
+    bounds[chunk] = bound == data ? data : std::min(LineEnd(bound - 1, text_end) + 1, text_end);
+  }
+
+  /* first pass counts rows of every chunk, second one parses them into their final place */
+  std::vector<size_t> first_rows(chunk_count + 1, 0);
+  RunParallel(chunk_count, [&](unsigned chunk)
+  {
+    first_rows[chunk + 1] = CountRows(bounds[chunk], bounds[chunk + 1]);
+  });
+  for (unsigned chunk = 0; chunk < chunk_count; chunk++)
+  {
+    first_rows[chunk + 1] += first_rows[chunk];
+  }
+
+  std::vector<double *> buffers;
+  for (auto &column : new_columns)
+  {
+    column.storage.resize(first_rows[chunk_count]);
+    column.data = column.storage.data();
+    buffers.push_back(column.storage.data());
+  }
+
+  std::vector<ERR_CODE> codes(chunk_count, SUCCESS);
+  RunParallel(chunk_count, [&](unsigned chunk)
+  {
+    codes[chunk] = ParseRows(bounds[chunk], bounds[chunk + 1], buffers.data(), buffers.size(), first_rows[chunk]);
+  });
+  munmap(const_cast<char *>(text), size);
+
+  for (ERR_CODE chunk_code : codes)
+  {
+    if (chunk_code != SUCCESS)
+    {
+      return chunk_code;
+    }
+  }
+
+  for (auto &column : new_columns)
+  {
+    if ((code = AddColumn(std::move(column), first_rows[chunk_count])) != SUCCESS)
+    {
+      return code;
+    }
+  }
+  return SUCCESS;
+}
+
+/* Returns column with given name or nullptr if there is no such column */
+const double *ColumnTable::Find(const std::string &name) const
+{
+  for (auto &column : columns)
+  {
+    if (column.name == name)
+    {
+      return column.data;
+    }
+  }
+  return nullptr;
+}
+
+/* Evaluates expression for 'count' rows in floating point type 'RealT'. Columns are converted by whole blocks */
+template <typename RealT>
+static void EvalRows(BatchEvaluator<RealT> &evaluator, const std::vector<const double *> &columns, size_t count,
+                     double *out)
+{
+  std::vector<RealT> values(columns.size() * BATCH_BLOCK);
+  std::vector<const RealT *> block_columns;
+  for (size_t var = 0; var < columns.size(); var++)
+  {
+    block_columns.push_back(values.data() + var * BATCH_BLOCK);
+  }
+  RealT result[BATCH_BLOCK];
+
+  for (size_t start = 0; start < count; start += BATCH_BLOCK)
+  {
+    size_t n = std::min((size_t)BATCH_BLOCK, count - start);
+    for (size_t var = 0; var < columns.size(); var++)
+    {
+      std::copy(columns[var] + start, columns[var] + start + n, values.begin() + var * BATCH_BLOCK);
+    }
+    evaluator.Eval(block_columns.data(), n, result);
+    std::copy(result, result + n, out + start);
+  }
+}
+
+/* Evaluates real expression for every row of table. Rows are split between threads by whole blocks */
+ERR_CODE EvalColumns(const ExprTree &tree, const ColumnTable &table, double *out, unsigned threads,
+                     PRECISION precision)
+{
+  if (tree.has_imag)
+  {
+    return ERR_WRONG_INPUT;
+  }
+
+  std::vector<const double *> columns;
+  for (auto &name : tree.var_names)
+  {
+    const double *column = table.Find(name);
+    if (column == nullptr)
+    {
+      return ERR_WRONG_INPUT;
+    }
+    columns.push_back(column);
+  }
+
+  size_t rows = table.Rows();
+  size_t blocks = (rows + BATCH_BLOCK - 1) / BATCH_BLOCK;
+  unsigned parts = (unsigned)std::max((size_t)1, std::min((size_t)ThreadCount(threads), blocks));
+
+  RunParallel(parts, [&](unsigned part)
+  {
+    size_t start = std::min(rows, blocks * part / parts * BATCH_BLOCK);
+    size_t finish = std::min(rows, blocks * (part + 1) / parts * BATCH_BLOCK);
+
+    std::vector<const double *> part_columns;
+    for (const double *column : columns)
+    {
+      part_columns.push_back(column + start);
+    }
+
+    switch (precision)
+    {
+      case PRECISION_FLOAT:
+      {
+        BatchEvaluator<float> evaluator(tree);
+        EvalRows(evaluator, part_columns, finish - start, out + start);
+        break;
+      }
+      case PRECISION_LONG_DOUBLE:
+      {
+        BatchEvaluator<long double> evaluator(tree);
+        EvalRows(evaluator, part_columns, finish - start, out + start);
+        break;
+      }
+      case PRECISION_DOUBLE: //fallthrough
+      default:
+      {
+        BatchEvaluator<double> evaluator(tree);
+        evaluator.Eval(part_columns.data(), finish - start, out + start);
+        break;
+      }
+    }
+  });
+
+  return SUCCESS;
+}
+
+/* Writes column to raw or CSV file */
+ERR_CODE WriteColumn(const char *file_name, const std::string &name, const double *data, size_t rows)
+{
+  FILE *file = fopen(file_name, "wb");
+  if (file == nullptr)
+  {
+    return ERR_FILE_OPEN;
+  }
+
+  size_t name_length = strlen(file_name);
+  bool is_csv = name_length >= 4 && strcmp(file_name + name_length - 4, ".csv") == 0;
+  bool is_written = true;
+
+  if (is_csv)
+  {
+    is_written = fprintf(file, "%s\n", name.c_str()) >= 0;
+    for (size_t row = 0; row < rows && is_written; row++)
+    {
+      is_written = fprintf(file, "%.17g\n", data[row]) >= 0;
+    }
+  }
+  else
+  {
+    is_written = fwrite(data, sizeof(double), rows, file) == rows;
+  }
+
+  is_written = fclose(file) == 0 && is_written;
+  return is_written ? SUCCESS : ERR_FILE_OPERATE;
+}
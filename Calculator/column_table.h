@@ -0,0 +1,82 @@
+#ifndef CALCULATOR_COLUMN_TABLE_H
+#define CALCULATOR_COLUMN_TABLE_H
+
+#include <string>
+#include <vector>
+
+#include "error_functions.h"
+#include "expr_tree.h"
+
+/***
+ * Table of named 'double' columns (structure of arrays) for evaluating one formula per row.
+ *
+ * Raw column files (native 'double' array without header) are mapped into memory without copying.
+ * CSV files are split into chunks at line boundaries and parsed by several threads straight
+ * into column buffers. All columns of table must have the same number of rows.
+ */
+class ColumnTable
+{
+private:
+  /* Column of table. Data points either to 'storage' or to file mapping */
+  struct Column
+  {
+    std::string name;
+    const double *data = nullptr;
+    std::vector<double> storage; /* Parsed values, empty for mapped columns */
+    void *mapping = nullptr;     /* Start of file mapping, nullptr for parsed columns */
+    size_t mapping_size = 0;
+  };
+
+  std::vector<Column> columns; /* Table columns */
+  size_t rows = 0;             /* Number of rows of every column */
+
+public:
+  /* Class constructor */
+  ColumnTable() = default;
+
+  ColumnTable(const ColumnTable &) = delete;
+  ColumnTable &operator=(const ColumnTable &) = delete;
+
+  /* Class destructor, unmaps mapped columns */
+  ~ColumnTable();
+
+  /* Maps raw column file into memory and adds it as column 'name' */
+  ERR_CODE MapRawColumn(const char *file_name, const std::string &name);
+
+  /* Reads all columns of CSV file with header line of column names. 'threads' = 0 uses all hardware threads */
+  ERR_CODE ReadCsv(const char *file_name, unsigned threads = 0);
+
+  /* Returns column with given name or nullptr if there is no such column */
+  const double *Find(const std::string &name) const;
+
+  /* Returns number of rows of every column */
+  size_t Rows() const
+  {
+    return rows;
+  }
+
+private:
+  ERR_CODE AddColumn(Column &&column, size_t column_rows); /* Adds column checking number of rows */
+};
+
+/***
+ * Evaluates real expression for every row of table. Variables are bound to columns by name.
+ *
+ * @param out - array of 'table.Rows()' results
+ * @param threads - number of evaluating threads, 0 uses all hardware threads
+ * @param precision - floating point type of calculation. Columns are converted to it block by block
+ *
+ * @return error code. ERR_WRONG_INPUT if table has no column for some variable or expression contains imaginary unit.
+ */
+ERR_CODE EvalColumns(const ExprTree &tree, const ColumnTable &table, double *out, unsigned threads = 0,
+                     PRECISION precision = PRECISION_DOUBLE);
+
+/***
+ * Writes column to file. Files ending with ".csv" get text column with header 'name',
+ * other files get raw 'double' array readable by 'ColumnTable::MapRawColumn'.
+ *
+ * @return error code. It can occur because of problems with opening/writing file.
+ */
+ERR_CODE WriteColumn(const char *file_name, const std::string &name, const double *data, size_t rows);
+
+#endif //CALCULATOR_COLUMN_TABLE_H
@@ -0,0 +1,223 @@
+#include <cmath>
+
+#include "complex_kernels.h"
+#include "vec_math.h"
+
+/* Number of elements processed at once. Intermediate arrays of this size are kept on the stack */
+#define CPLX_CHUNK 256
+
+/* Greater imaginary parts make tangent equal to +-i in double precision */
+#define TAN_MAX_IM 20.0
+
+/* Hyperbolic sine arguments less than this are calculated by series to avoid cancellation */
+#define SINH_SERIES_MAX 0.5
+
+/* Calculates hyperbolic cosine and sine */
+static void VecCoshSinh(const double *x, double *out_cosh, double *out_sinh, size_t count)
+{
+  double exp_x[CPLX_CHUNK];
+  VecExp(x, exp_x, count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    double arg = x[i];
+    double arg2 = arg * arg;
+    double series = arg * (1 + arg2 / 6 * (1 + arg2 / 20 * (1 + arg2 / 42 * (1 + arg2 / 72 *
+                          (1 + arg2 / 110 * (1 + arg2 / 156))))));
+    double inverse = 1.0 / exp_x[i];
+
+    out_cosh[i] = 0.5 * (exp_x[i] + inverse);
+    out_sinh[i] = fabs(arg) < SINH_SERIES_MAX ? series : 0.5 * (exp_x[i] - inverse);
+  }
+}
+
+void CplxMul(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    double ar = a_re[i], ai = a_im[i], br = b_re[i], bi = b_im[i];
+    out_re[i] = ar * br - ai * bi;
+    out_im[i] = ar * bi + ai * br;
+  }
+}
+
+void CplxDiv(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    double ar = a_re[i], ai = a_im[i], br = b_re[i], bi = b_im[i];
+
+    /* divisor is scaled to avoid overflow of its squared absolute value */
+    double scale = fmax(fabs(br), fabs(bi));
+    double cr = br / scale, ci = bi / scale;
+    double den = (cr * cr + ci * ci) * scale;
+
+    out_re[i] = (ar * cr + ai * ci) / den;
+    out_im[i] = (ai * cr - ar * ci) / den;
+  }
+}
+
+void CplxSin(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  double s[CPLX_CHUNK], c[CPLX_CHUNK], ch[CPLX_CHUNK], sh[CPLX_CHUNK];
+
+  for (size_t start = 0; start < count; start += CPLX_CHUNK)
+  {
+    size_t n = count - start < CPLX_CHUNK ? count - start : CPLX_CHUNK;
+    VecSinCos(re + start, s, c, n);
+    VecCoshSinh(im + start, ch, sh, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      out_re[start + i] = s[i] * ch[i];
+      out_im[start + i] = c[i] * sh[i] + 0.0;
+    }
+  }
+}
+
+void CplxCos(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  double s[CPLX_CHUNK], c[CPLX_CHUNK], ch[CPLX_CHUNK], sh[CPLX_CHUNK];
+
+  for (size_t start = 0; start < count; start += CPLX_CHUNK)
+  {
+    size_t n = count - start < CPLX_CHUNK ? count - start : CPLX_CHUNK;
+    VecSinCos(re + start, s, c, n);
+    VecCoshSinh(im + start, ch, sh, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      out_re[start + i] = c[i] * ch[i];
+      out_im[start + i] = -s[i] * sh[i] + 0.0;
+    }
+  }
+}
+
+/* Calculates tangent (sign = 1) or cotangent (sign = -1):
+ * tan(a + bi) = (sin 2a + i sinh 2b) / (cos 2a + cosh 2b), cot(a + bi) = (sin 2a - i sinh 2b) / (cosh 2b - cos 2a) */
+static void CplxTanCot(const double *re, const double *im, double *out_re, double *out_im, size_t count, double sign)
+{
+  double re2[CPLX_CHUNK], im2[CPLX_CHUNK];
+  double s[CPLX_CHUNK], c[CPLX_CHUNK], ch[CPLX_CHUNK], sh[CPLX_CHUNK];
+
+  for (size_t start = 0; start < count; start += CPLX_CHUNK)
+  {
+    size_t n = count - start < CPLX_CHUNK ? count - start : CPLX_CHUNK;
+    for (size_t i = 0; i < n; i++)
+    {
+      re2[i] = 2 * re[start + i];
+      im2[i] = 2 * im[start + i];
+    }
+
+    VecSinCos(re2, s, c, n);
+    VecCoshSinh(im2, ch, sh, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      double den = ch[i] + sign * c[i];
+      double imag = sign * sh[i] / den + 0.0;
+
+      out_re[start + i] = s[i] / den;
+      out_im[start + i] = fabs(im2[i]) > 2 * TAN_MAX_IM ? sign * copysign(1.0, im2[i]) : imag;
+    }
+  }
+}
+
+void CplxTan(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  CplxTanCot(re, im, out_re, out_im, count, 1);
+}
+
+void CplxCot(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  CplxTanCot(re, im, out_re, out_im, count, -1);
+}
+
+void CplxSqrt(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    double a = re[i], b = im[i];
+
+    /* absolute value is scaled to avoid overflow */
+    double scale = fmax(fabs(a), fabs(b));
+    double ratio = fmin(fabs(a), fabs(b)) / (scale != 0 ? scale : 1.0);
+    double abs_value = scale * sqrt(1 + ratio * ratio);
+
+    double t = sqrt(0.5 * (abs_value + fabs(a)));
+    double other = t != 0 ? 0.5 * fabs(b) / t : 0.0;
+
+    out_re[i] = a >= 0 ? t : other;
+    out_im[i] = a >= 0 ? copysign(other, b) : copysign(t, b);
+  }
+}
+
+void CplxLn(const double *re, const double *im, double *out_re, double *out_im, size_t count)
+{
+  double abs_value[CPLX_CHUNK], angle[CPLX_CHUNK];
+
+  for (size_t start = 0; start < count; start += CPLX_CHUNK)
+  {
+    size_t n = count - start < CPLX_CHUNK ? count - start : CPLX_CHUNK;
+    for (size_t i = 0; i < n; i++)
+    {
+      double a = re[start + i], b = im[start + i];
+      double scale = fmax(fabs(a), fabs(b));
+      double ratio = fmin(fabs(a), fabs(b)) / (scale != 0 ? scale : 1.0);
+      abs_value[i] = scale * sqrt(1 + ratio * ratio);
+    }
+
+    VecAtan2(im + start, re + start, angle, n);
+    VecLog(abs_value, out_re + start, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      out_im[start + i] = angle[i];
+    }
+  }
+}
+
+/* a ^ b = exp(b * ln(a)). Zero base gives zero for exponent with positive real part, infinity with undefined
+ * argument for negative real part (as 'std::pow') and one for zero exponent */
+void CplxPow(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count)
+{
+  double log_re[CPLX_CHUNK], log_im[CPLX_CHUNK], exp_re[CPLX_CHUNK], s[CPLX_CHUNK], c[CPLX_CHUNK];
+
+  for (size_t start = 0; start < count; start += CPLX_CHUNK)
+  {
+    size_t n = count - start < CPLX_CHUNK ? count - start : CPLX_CHUNK;
+    CplxLn(a_re + start, a_im + start, log_re, log_im, n);
+    CplxMul(log_re, log_im, b_re + start, b_im + start, log_re, log_im, n);
+
+    VecExp(log_re, exp_re, n);
+    VecSinCos(log_im, s, c, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      bool is_zero = a_re[start + i] == 0 && a_im[start + i] == 0;
+      if (is_zero && b_re[start + i] > 0)
+      {
+        out_re[start + i] = 0.0;
+        out_im[start + i] = 0.0;
+      }
+      else if (is_zero && b_re[start + i] < 0)
+      {
+        out_re[start + i] = HUGE_VAL;
+        out_im[start + i] = NAN;
+      }
+      else if (is_zero && b_re[start + i] == 0 && b_im[start + i] == 0)
+      {
+        out_re[start + i] = 1.0;
+        out_im[start + i] = 0.0;
+      }
+      else
+      {
+        out_re[start + i] = exp_re[i] * c[i];
+        out_im[start + i] = exp_re[i] * s[i];
+      }
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef CALCULATOR_COMPLEX_KERNELS_H
+#define CALCULATOR_COMPLEX_KERNELS_H
+
+#include <cstddef>
+
+/***
+ * Elementwise complex number kernels over split real/imaginary arrays (structure of arrays).
+ *
+ * Every complex function is reduced to real 'vec_math.h' kernels, so whole arrays of real
+ * and imaginary parts are processed by vector instructions instead of per element 'std::complex' calls.
+ * Output arrays may coincide with input arrays of the same part (out_re with a_re and so on).
+ * Trigonometric functions return +0 imaginary part for real arguments, so a following 'sqrt' or 'ln'
+ * of negative real value gives principal value as in real-valued formula (ln(-1) = pi * i).
+ */
+
+void CplxMul(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count);
+void CplxDiv(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count);
+void CplxPow(const double *a_re, const double *a_im, const double *b_re, const double *b_im,
+             double *out_re, double *out_im, size_t count);
+
+void CplxSin (const double *re, const double *im, double *out_re, double *out_im, size_t count);
+void CplxCos (const double *re, const double *im, double *out_re, double *out_im, size_t count);
+void CplxTan (const double *re, const double *im, double *out_re, double *out_im, size_t count);
+void CplxCot (const double *re, const double *im, double *out_re, double *out_im, size_t count);
+void CplxSqrt(const double *re, const double *im, double *out_re, double *out_im, size_t count);
+void CplxLn  (const double *re, const double *im, double *out_re, double *out_im, size_t count);
+
+#endif //CALCULATOR_COMPLEX_KERNELS_H
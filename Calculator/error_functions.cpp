@@ -116,6 +116,14 @@ enum ERR_CODE add_log( const char * log_file_name, enum ERR_CODE code, const cha
       fprintf(log_file, "Wrong input format\n\n");
       break;
 
+    case ERR_RECURSION:
+      fprintf(log_file, "recursive function call\n\n");
+      break;
+
+    case ERR_INLINE_LIMIT:
+      fprintf(log_file, "inline limit of function calls exceeded\n\n");
+      break;
+
     default:
       fprintf(log_file, "Unknown error code\n\n");
       break;
@@ -205,6 +213,14 @@ void print_err(std::ostream &os, const ERR_CODE &code)
       os << "Wrong input format\n";
       break;
 
+    case ERR_RECURSION:
+      os << "Recursive function call\n";
+      break;
+
+    case ERR_INLINE_LIMIT:
+      os << "Inline limit of function calls exceeded\n";
+      break;
+
     default:
       os << "Unknown error code\n";
       break;
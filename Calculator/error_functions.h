@@ -1,5 +1,5 @@
 #ifndef ONEGIN_ERROR_FUNCITONS_H
-#define ONEGIN_ERROR_FUNCTIONS_H
+#define ONEGIN_ERROR_FUNCITONS_H
 
 #include <iostream>
 #include <fstream>
@@ -68,6 +68,8 @@ enum ERR_CODE
   ERR_BACK_CANARY,    // structure back canary defect
   ERR_HASH_BREAK,     // hash function value defect
   ERR_WRONG_INPUT,    // wrong input format
+  ERR_RECURSION,      // recursive call of user function
+  ERR_INLINE_LIMIT,   // inlined calls of user functions exceed node limit
   ERR_LAST            // used to mark the end of error list
 };
 
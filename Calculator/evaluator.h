@@ -0,0 +1,167 @@
+#ifndef CALCULATOR_EVALUATOR_H
+#define CALCULATOR_EVALUATOR_H
+
+#include <vector>
+
+#include "expr_tree.h"
+#include "scalar_ops.h"
+#include "grammar_profile.h"
+
+/* Degree starting from which polynomials are calculated by Estrin scheme instead of Horner one.
+ * Estrin scheme has shorter dependency chain, but does more multiplications */
+#define ESTRIN_MIN_DEGREE 8
+
+/* Expression tree evaluator templated on scalar type. Scalar type must have 'ScalarOps' specialization */
+template <typename ScalarT>
+class Evaluator
+{
+  typedef ScalarOps<ScalarT> Ops;
+
+public:
+  /* Evaluates expression. 'var_values' holds values of variables in order of 'tree.var_names' */
+  static ScalarT Eval(const ExprTree &tree, const ScalarT *var_values)
+  {
+    PROFILE_SCOPE(PROF_EVAL)
+
+    if (tree.nodes.empty())
+    {
+      return Ops::Literal(0);
+    }
+
+    /* Values of bindings are followed by current values of reduction indices */
+    std::vector<ScalarT> locals(tree.let_roots.size() + tree.index_count);
+    for (size_t i = 0; i < tree.let_roots.size(); i++)
+    {
+      locals[i] = EvalNode(tree, tree.let_roots[i], var_values, locals.data());
+    }
+    return EvalNode(tree, tree.root, var_values, locals.data());
+  }
+
+  /* Calculates polynomial value. 'coeffs' holds 'degree + 1' coefficients, lowest power first */
+  static ScalarT CalcPoly(const double *coeffs, size_t degree, ScalarT value)
+  {
+    if (degree < ESTRIN_MIN_DEGREE || degree > POLY_MAX_DEGREE)
+    {
+      ScalarT result = Ops::Literal(coeffs[degree]);
+      for (size_t i = degree; i-- > 0;)
+      {
+        result = Ops::MulAdd(result, value, Ops::Literal(coeffs[i]));
+      }
+      return result;
+    }
+
+    /* Estrin scheme: pairs of coefficients are joined into the polynomial in 'value^2' until one is left */
+    ScalarT buffer[POLY_MAX_DEGREE / 2 + 1];
+    size_t count = degree + 1;
+
+    for (size_t i = 0; i < count / 2; i++)
+    {
+      buffer[i] = Ops::MulAdd(Ops::Literal(coeffs[2 * i + 1]), value, Ops::Literal(coeffs[2 * i]));
+    }
+    if (count % 2 != 0)
+    {
+      buffer[count / 2] = Ops::Literal(coeffs[count - 1]);
+    }
+    count = (count + 1) / 2;
+
+    while (count > 1)
+    {
+      value *= value;
+      for (size_t i = 0; i < count / 2; i++)
+      {
+        buffer[i] = Ops::MulAdd(buffer[2 * i + 1], value, buffer[2 * i]);
+      }
+      if (count % 2 != 0)
+      {
+        buffer[count / 2] = buffer[count - 1];
+      }
+      count = (count + 1) / 2;
+    }
+
+    return buffer[0];
+  }
+
+private:
+  /* Evaluates subtree with root 'idx'. 'locals' holds values of already calculated 'let' bindings
+   * and of reduction indices */
+  static ScalarT EvalNode(const ExprTree &tree, size_t idx, const ScalarT *var_values, ScalarT *locals)
+  {
+    const ExprNode &node = tree.nodes[idx];
+
+    switch (node.type)
+    {
+      case NODE_NUM  : return Ops::Literal(node);
+      case NODE_IMAG : return Ops::ImagUnit();
+      case NODE_VAR  : return var_values[node.var];
+      case NODE_LOCAL: return locals[node.var];
+      case NODE_POLY : return CalcPoly(&tree.coeffs[node.left], node.right, var_values[node.var]);
+      case NODE_FUNC :
+        if (ExprTree::IdArity(node.id) == 1)
+        {
+          return Ops::CalcOpId(node.id, EvalNode(tree, node.left, var_values, locals));
+        }
+        break;
+      case NODE_SELECT: /* only chosen operand is evaluated, both are joined if condition is undecided */
+      {
+        ScalarT cond = EvalNode(tree, node.cond, var_values, locals);
+        if (Ops::IsTrue(cond))
+        {
+          return EvalNode(tree, node.left, var_values, locals);
+        }
+        if (Ops::IsFalse(cond))
+        {
+          return EvalNode(tree, node.right, var_values, locals);
+        }
+        return Ops::Join(EvalNode(tree, node.left, var_values, locals), EvalNode(tree, node.right, var_values, locals));
+      }
+      case NODE_INDEX: return locals[tree.let_roots.size() + node.var];
+      case NODE_SUM  : //fallthrough
+      case NODE_PROD : return Reduce(tree, node, var_values, locals);
+      default: break;
+    }
+
+    ScalarT left = EvalNode(tree, node.left, var_values, locals);
+    ScalarT right = EvalNode(tree, node.right, var_values, locals);
+
+    switch (node.type)
+    {
+      case NODE_ADD : return left + right;
+      case NODE_SUB : return left - right;
+      case NODE_MUL : return left * right;
+      case NODE_DIV : return left / right;
+      case NODE_POW : return Ops::Pow(left, right);
+      case NODE_FUNC: return Ops::CalcOpId(node.id, left, right);
+      default       : return ExprTree::IsCompare(node.type) ? Ops::Compare(node.type, left, right) : Ops::Literal(0);
+    }
+  }
+
+  /* Calculates NODE_SUM or NODE_PROD. Sum is compensated by Neumaier scheme */
+  static ScalarT Reduce(const ExprTree &tree, const ExprNode &node, const ScalarT *var_values, ScalarT *locals)
+  {
+    long long first = (long long)tree.nodes[node.left].value;
+    long long last = (long long)tree.nodes[node.right].value;
+    ScalarT &index = locals[tree.let_roots.size() + node.var];
+
+    ScalarT result = Ops::Literal(node.type == NODE_SUM ? 0 : 1);
+    ScalarT error = Ops::Literal(0);
+    for (long long k = first; k <= last; k++)
+    {
+      index = Ops::Literal((double)k);
+      ScalarT term = EvalNode(tree, node.cond, var_values, locals);
+
+      if (node.type == NODE_SUM)
+      {
+        ScalarT sum = result + term;
+        error += Ops::SumError(result, term, sum);
+        result = sum;
+      }
+      else
+      {
+        result *= term;
+      }
+    }
+    return node.type == NODE_SUM ? result + error : result; /* adding zero error would lose sign of zero product */
+  }
+};
+
+#endif //CALCULATOR_EVALUATOR_H
@@ -0,0 +1,261 @@
+#include <climits>
+
+#include "exact.h"
+
+/* Calculates greatest common divisor of absolute values */
+static unsigned long long Gcd(unsigned long long a, unsigned long long b)
+{
+  while (b != 0)
+  {
+    unsigned long long tmp = a % b;
+    a = b;
+    b = tmp;
+  }
+  return a;
+}
+
+/* Makes fraction irreducible with positive denominator */
+static bool Normalize(long long num, long long den, Rational &result)
+{
+  if (den == 0 || num == LLONG_MIN || den == LLONG_MIN)
+  {
+    return false;
+  }
+
+  if (den < 0)
+  {
+    num = -num;
+    den = -den;
+  }
+
+  long long divisor = (long long)Gcd(num < 0 ? -num : num, den);
+  result.num = num / divisor;
+  result.den = den / divisor;
+  return true;
+}
+
+/* Calculates a + b */
+bool RationalAdd(const Rational &a, const Rational &b, Rational &result)
+{
+  if (a.den == 1 && b.den == 1) /* integer fast path */
+  {
+    result.den = 1;
+    return !__builtin_add_overflow(a.num, b.num, &result.num) && result.num != LLONG_MIN;
+  }
+
+  long long divisor = (long long)Gcd(a.den, b.den);
+  long long left = 0, right = 0, num = 0, den = 0;
+
+  if (__builtin_mul_overflow(a.num, b.den / divisor, &left)  ||
+      __builtin_mul_overflow(b.num, a.den / divisor, &right) ||
+      __builtin_add_overflow(left, right, &num)              ||
+      __builtin_mul_overflow(a.den / divisor, b.den, &den))
+  {
+    return false;
+  }
+  return Normalize(num, den, result);
+}
+
+/* Calculates a - b */
+bool RationalSub(const Rational &a, const Rational &b, Rational &result)
+{
+  if (b.num == LLONG_MIN)
+  {
+    return false;
+  }
+
+  Rational negative = b;
+  negative.num = -b.num;
+  return RationalAdd(a, negative, result);
+}
+
+/* Calculates a * b */
+bool RationalMul(const Rational &a, const Rational &b, Rational &result)
+{
+  if (a.den == 1 && b.den == 1) /* integer fast path */
+  {
+    result.den = 1;
+    return !__builtin_mul_overflow(a.num, b.num, &result.num) && result.num != LLONG_MIN;
+  }
+
+  /* cross reduction keeps intermediate values small */
+  long long divisor1 = (long long)Gcd(a.num < 0 ? -a.num : a.num, b.den);
+  long long divisor2 = (long long)Gcd(b.num < 0 ? -b.num : b.num, a.den);
+  long long num = 0, den = 0;
+  if (__builtin_mul_overflow(a.num / divisor1, b.num / divisor2, &num) ||
+      __builtin_mul_overflow(a.den / divisor2, b.den / divisor1, &den))
+  {
+    return false;
+  }
+  return Normalize(num, den, result);
+}
+
+/* Calculates a / b */
+bool RationalDiv(const Rational &a, const Rational &b, Rational &result)
+{
+  if (b.num == 0)
+  {
+    return false;
+  }
+
+  Rational inverse;
+  if (!Normalize(b.den, b.num, inverse))
+  {
+    return false;
+  }
+  return RationalMul(a, inverse, result);
+}
+
+/* Calculates a ^ b by repeated squaring. 'b' must be integer */
+bool RationalPow(const Rational &a, const Rational &b, Rational &result)
+{
+  if (b.den != 1 || b.num == LLONG_MIN)
+  {
+    return false;
+  }
+
+  Rational base = a;
+  if (b.num < 0 && !RationalDiv(Rational{1, 1}, a, base))
+  {
+    return false;
+  }
+
+  unsigned long long power = b.num < 0 ? -b.num : b.num;
+  Rational value{1, 1};
+
+  while (power != 0)
+  {
+    if ((power & 1u) != 0 && !RationalMul(value, base, value))
+    {
+      return false;
+    }
+    power >>= 1u;
+    if (power != 0 && !RationalMul(base, base, base))
+    {
+      return false;
+    }
+  }
+
+  result = value;
+  return true;
+}
+
+/* Checks if subtree with root 'idx' can be calculated exactly and writes its value to 'value'.
+ * If it can not, its maximal exact subtrees are replaced with literals */
+static bool CollectExact(ExprTree &tree, size_t idx, Rational &value);
+
+/* Replaces tree node 'idx' with exact literal */
+static void EmitExact(ExprTree &tree, size_t idx, const Rational &value)
+{
+  ExprNode &node = tree.nodes[idx];
+
+  node.type = NODE_NUM;
+  node.value = (double)value.num / (double)value.den;
+  node.is_exact = true;
+  node.exact_num = value.num;
+  node.exact_den = value.den;
+}
+
+static bool CollectExact(ExprTree &tree, size_t idx, Rational &value)
+{
+  const ExprNode node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_NUM:
+      return node.is_exact && Normalize(node.exact_num, node.exact_den, value);
+
+    case NODE_ADD:
+    case NODE_SUB:
+    case NODE_MUL:
+    case NODE_DIV:
+    case NODE_POW:
+    {
+      Rational left, right;
+      bool is_left_exact  = CollectExact(tree, node.left, left);
+      bool is_right_exact = CollectExact(tree, node.right, right);
+
+      if (is_left_exact && is_right_exact)
+      {
+        bool is_calculated = false;
+        switch (node.type)
+        {
+          case NODE_ADD: is_calculated = RationalAdd(left, right, value); break;
+          case NODE_SUB: is_calculated = RationalSub(left, right, value); break;
+          case NODE_MUL: is_calculated = RationalMul(left, right, value); break;
+          case NODE_DIV: is_calculated = RationalDiv(left, right, value); break;
+          case NODE_POW: is_calculated = RationalPow(left, right, value); break;
+          default      : break;
+        }
+
+        if (is_calculated)
+        {
+          return true;
+        }
+      }
+
+      if (is_left_exact)  { EmitExact(tree, node.left, left); }
+      if (is_right_exact) { EmitExact(tree, node.right, right); }
+      return false;
+    }
+
+    case NODE_FUNC:
+    {
+      Rational arg;
+      if (CollectExact(tree, node.left, arg))
+      {
+        EmitExact(tree, node.left, arg);
+      }
+      if (ExprTree::IdArity(node.id) == 2 && CollectExact(tree, node.right, arg))
+      {
+        EmitExact(tree, node.right, arg);
+      }
+      return false;
+    }
+
+    case NODE_SELECT: //fallthrough
+    case NODE_SUM   : //fallthrough
+    case NODE_PROD  :
+    {
+      Rational arg;
+      if (CollectExact(tree, node.cond, arg))  { EmitExact(tree, node.cond, arg); }
+      if (CollectExact(tree, node.left, arg))  { EmitExact(tree, node.left, arg); }
+      if (CollectExact(tree, node.right, arg)) { EmitExact(tree, node.right, arg); }
+      return false;
+    }
+
+    case NODE_VAR : //fallthrough;
+    case NODE_POLY: //fallthrough;
+    default:
+      if (ExprTree::IsCompare(node.type)) /* comparisons are folded by polynomial rewriting */
+      {
+        Rational arg;
+        if (CollectExact(tree, node.left, arg))  { EmitExact(tree, node.left, arg); }
+        if (CollectExact(tree, node.right, arg)) { EmitExact(tree, node.right, arg); }
+      }
+      return false;
+  }
+}
+
+/* Calculates maximal subexpressions which consist of exact literals and [+,-,*,/,^] operations
+ * in 64-bit rational arithmetic and replaces them with NODE_NUM nodes.
+ * Subexpressions causing overflow are left to be calculated in 'double' */
+void FoldExact(ExprTree &tree)
+{
+  if (tree.nodes.empty())
+  {
+    return;
+  }
+
+  std::vector<size_t> roots = tree.let_roots;
+  roots.push_back(tree.root);
+
+  for (size_t root : roots)
+  {
+    Rational value;
+    if (CollectExact(tree, root, value))
+    {
+      EmitExact(tree, root, value);
+    }
+  }
+}
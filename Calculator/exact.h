@@ -0,0 +1,26 @@
+#ifndef CALCULATOR_EXACT_H
+#define CALCULATOR_EXACT_H
+
+#include "expr_tree.h"
+
+/* Exact rational number. Denominator is always positive and fraction is irreducible */
+struct Rational
+{
+  long long num = 0;
+  long long den = 1;
+};
+
+/* Operations on rational numbers. Return 'false' on 64-bit overflow or division by zero,
+ * in this case 'result' is not defined */
+bool RationalAdd(const Rational &a, const Rational &b, Rational &result);
+bool RationalSub(const Rational &a, const Rational &b, Rational &result);
+bool RationalMul(const Rational &a, const Rational &b, Rational &result);
+bool RationalDiv(const Rational &a, const Rational &b, Rational &result);
+bool RationalPow(const Rational &a, const Rational &b, Rational &result); /* 'b' must be integer */
+
+/* Calculates maximal subexpressions which consist of exact literals and [+,-,*,/,^] operations
+ * in 64-bit rational arithmetic and replaces them with NODE_NUM nodes.
+ * Subexpressions causing overflow are left to be calculated in 'double' */
+void FoldExact(ExprTree &tree);
+
+#endif //CALCULATOR_EXACT_H
@@ -0,0 +1,99 @@
+#include "expr_generator.h"
+
+/* Characters of generated operations */
+static const char GEN_OP_CHARS[GEN_OP_LAST] = {'+', '-', '*', '/', '^'};
+
+/* Generates one expression ending with 'terminator' */
+std::string ExprGenerator::Generate(char terminator)
+{
+  std::string out;
+  GenExpr(out, params.max_depth);
+  out.push_back(terminator);
+  return out;
+}
+
+/* Generates 'count' expressions ending with 'terminator' */
+std::vector<std::string> ExprGenerator::GenerateCorpus(size_t count, char terminator)
+{
+  std::vector<std::string> corpus;
+  corpus.reserve(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    corpus.push_back(Generate(terminator));
+  }
+  return corpus;
+}
+
+/* Appends subexpression of given depth to 'out' */
+void ExprGenerator::GenExpr(std::string &out, unsigned depth)
+{
+  if (depth == 0 || Chance(params.leaf_prob))
+  {
+    if (!params.vars.empty() && Chance(params.var_prob))
+    {
+      out += params.vars[random() % params.vars.size()];
+    }
+    else
+    {
+      GenLiteral(out);
+    }
+    return;
+  }
+
+  if (!params.funcs.empty() && Chance(params.func_prob))
+  {
+    out += params.funcs[random() % params.funcs.size()];
+    out.push_back('(');
+    GenExpr(out, depth - 1);
+    out.push_back(')');
+    return;
+  }
+
+  std::discrete_distribution<int> op_dist(params.op_weights, params.op_weights + GEN_OP_LAST);
+  int op = op_dist(random);
+
+  out.push_back('(');
+  GenExpr(out, depth - 1);
+
+  if (Chance(params.space_prob)) { out.push_back(' '); }
+  out.push_back(GEN_OP_CHARS[op]);
+  if (Chance(params.space_prob)) { out.push_back(' '); }
+
+  if (op == GEN_POW) /* small exponent keeps values finite */
+  {
+    out.push_back((char)('0' + random() % 4));
+  }
+  else
+  {
+    GenExpr(out, depth - 1);
+  }
+  out.push_back(')');
+}
+
+/* Appends random literal to 'out' */
+void ExprGenerator::GenLiteral(std::string &out)
+{
+  unsigned len = 1 + (params.literal_len > 1 ? random() % params.literal_len : 0);
+
+  out.push_back((char)('1' + random() % 9));
+  for (unsigned i = 1; i < len; i++)
+  {
+    out.push_back((char)('0' + random() % 10));
+  }
+
+  if (Chance(params.fraction_prob))
+  {
+    out.push_back('.');
+    for (unsigned i = 0; i < len; i++)
+    {
+      out.push_back((char)('0' + random() % 10));
+    }
+  }
+}
+
+/* Returns 'true' with given probability */
+bool ExprGenerator::Chance(double prob)
+{
+  return std::uniform_real_distribution<double>(0, 1)(random) < prob;
+}
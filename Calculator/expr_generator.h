@@ -0,0 +1,60 @@
+#ifndef CALCULATOR_EXPR_GENERATOR_H
+#define CALCULATOR_EXPR_GENERATOR_H
+
+#include <random>
+#include <string>
+#include <vector>
+
+/* Operations which can be generated */
+enum GEN_OP
+{
+  GEN_ADD,
+  GEN_SUB,
+  GEN_MUL,
+  GEN_DIV,
+  GEN_POW,
+  GEN_OP_LAST /* used to mark the end of operation list */
+};
+
+/* Parameters of random expression generation */
+struct GeneratorParams
+{
+  unsigned long long seed = 1;     /* Random generator seed. Same seed gives same corpus */
+  unsigned max_depth = 4;          /* Maximal depth of operation tree */
+  double leaf_prob = 0.2;          /* Probability to stop at a leaf before reaching maximal depth */
+  double op_weights[GEN_OP_LAST] = {4, 3, 3, 2, 1}; /* Relative frequencies of [+,-,*,/,^] */
+  double func_prob = 0.1;          /* Probability to wrap subexpression into function call */
+  std::vector<std::string> funcs = {"sin", "cos", "tan", "cot", "sqrt", "ln"}; /* Functions to choose from */
+  double var_prob = 0.3;           /* Probability of leaf to be variable instead of literal */
+  std::vector<std::string> vars = {"x", "y", "z"}; /* Variables to choose from */
+  unsigned literal_len = 3;        /* Maximal number of digits of integer part of literal */
+  double fraction_prob = 0.3;      /* Probability of literal to have fraction part */
+  double space_prob = 0.0;         /* Probability to put space around operation */
+};
+
+/* Seeded random expression generator */
+class ExprGenerator
+{
+private:
+  GeneratorParams params;
+  std::mt19937_64 random;
+
+public:
+  /* Class constructor */
+  explicit ExprGenerator(GeneratorParams init_params = {}) : params(std::move(init_params)), random(params.seed)
+  {
+  }
+
+  /* Generates one expression ending with 'terminator' */
+  std::string Generate(char terminator = '=');
+
+  /* Generates 'count' expressions ending with 'terminator' */
+  std::vector<std::string> GenerateCorpus(size_t count, char terminator = '=');
+
+private:
+  void GenExpr(std::string &out, unsigned depth);  /* Appends subexpression of given depth to 'out' */
+  void GenLiteral(std::string &out);               /* Appends random literal to 'out' */
+  bool Chance(double prob);                        /* Returns 'true' with given probability */
+};
+
+#endif //CALCULATOR_EXPR_GENERATOR_H
@@ -0,0 +1,317 @@
+#include <cmath>
+
+#include "expr_tree.h"
+#include "evaluator.h"
+#include "grammar_profile.h"
+
+/* Adds numeric literal node */
+size_t ExprTree::AddNum(double value)
+{
+  ExprNode node;
+  node.type = NODE_NUM;
+  node.value = value;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds numeric literal node which value is exactly num / den */
+size_t ExprTree::AddExactNum(long long num, long long den)
+{
+  size_t idx = AddNum((double)num / (double)den);
+
+  nodes[idx].is_exact = true;
+  nodes[idx].exact_num = num;
+  nodes[idx].exact_den = den;
+  return idx;
+}
+
+/* Adds imaginary unit node */
+size_t ExprTree::AddImag()
+{
+  ExprNode node;
+  node.type = NODE_IMAG;
+  has_imag = true;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds variable node. Registers variable if it is met for the first time */
+size_t ExprTree::AddVar(const std::string &name)
+{
+  ExprNode node;
+  node.type = NODE_VAR;
+  node.var = VarIndex(name);
+
+  if (node.var == var_names.size())
+  {
+    var_names.push_back(name);
+  }
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds reference to value of 'let' binding */
+size_t ExprTree::AddLocal(size_t binding)
+{
+  ExprNode node;
+  node.type = NODE_LOCAL;
+  node.var = binding;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds binary operation node */
+size_t ExprTree::AddOp(NODE_TYPE type, size_t left, size_t right)
+{
+  ExprNode node;
+  node.type = type;
+  node.left = left;
+  node.right = right;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds identifier operation node */
+size_t ExprTree::AddFunc(ID_TYPE id, size_t arg)
+{
+  ExprNode node;
+  node.type = NODE_FUNC;
+  node.id = id;
+  node.left = arg;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds two-argument identifier operation node */
+size_t ExprTree::AddFunc(ID_TYPE id, size_t arg, size_t second_arg)
+{
+  size_t idx = AddFunc(id, arg);
+  nodes[idx].right = second_arg;
+  return idx;
+}
+
+/* Adds selection node 'cond ? left : right' */
+size_t ExprTree::AddSelect(size_t cond, size_t left, size_t right)
+{
+  size_t idx = AddOp(NODE_SELECT, left, right);
+  nodes[idx].cond = cond;
+  return idx;
+}
+
+/* Adds reference to index of enclosing reduction */
+size_t ExprTree::AddIndex(size_t index)
+{
+  ExprNode node;
+  node.type = NODE_INDEX;
+  node.var = index;
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Adds NODE_SUM or NODE_PROD node of 'body' over 'index' from 'first' to 'last' */
+size_t ExprTree::AddReduce(NODE_TYPE type, size_t index, size_t first, size_t last, size_t body)
+{
+  size_t idx = AddSelect(body, first, last);
+  nodes[idx].type = type;
+  nodes[idx].var = index;
+  return idx;
+}
+
+/* Copies subtree with root 'idx' and returns index of the copy root. Polynomial coefficients are shared */
+size_t ExprTree::CopySubtree(size_t idx)
+{
+  ExprNode node = nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_ADD: //fallthrough
+    case NODE_SUB: //fallthrough
+    case NODE_MUL: //fallthrough
+    case NODE_DIV: //fallthrough
+    case NODE_POW:
+      node.left = CopySubtree(node.left);
+      node.right = CopySubtree(node.right);
+      break;
+    case NODE_SELECT: //fallthrough
+    case NODE_SUM   : //fallthrough
+    case NODE_PROD  :
+      node.cond = CopySubtree(node.cond);
+      node.left = CopySubtree(node.left);
+      node.right = CopySubtree(node.right);
+      break;
+    case NODE_FUNC:
+      node.left = CopySubtree(node.left);
+      if (IdArity(node.id) == 2)
+      {
+        node.right = CopySubtree(node.right);
+      }
+      break;
+    default:
+      if (IsCompare(node.type))
+      {
+        node.left = CopySubtree(node.left);
+        node.right = CopySubtree(node.right);
+      }
+      break;
+  }
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+/* Checks if subtree with root 'idx' consists of literals only */
+bool ExprTree::IsConstant(size_t idx) const
+{
+  const ExprNode &node = nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_NUM : //fallthrough
+    case NODE_IMAG: return true;
+    case NODE_ADD : //fallthrough
+    case NODE_SUB : //fallthrough
+    case NODE_MUL : //fallthrough
+    case NODE_DIV : //fallthrough
+    case NODE_POW : return IsConstant(node.left) && IsConstant(node.right);
+    case NODE_FUNC: return IsConstant(node.left) && (IdArity(node.id) == 1 || IsConstant(node.right));
+    case NODE_SELECT: return IsConstant(node.cond) && IsConstant(node.left) && IsConstant(node.right);
+    default       : return IsCompare(node.type) && IsConstant(node.left) && IsConstant(node.right);
+  }
+}
+
+/* Checks if subtree with root 'idx' refers to index of NODE_SUM or NODE_PROD */
+bool ExprTree::HasIndex(size_t idx) const
+{
+  const ExprNode &node = nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_INDEX : return true;
+    case NODE_SELECT: //fallthrough
+    case NODE_SUM   : //fallthrough
+    case NODE_PROD  : return HasIndex(node.cond) || HasIndex(node.left) || HasIndex(node.right);
+    case NODE_FUNC  : return HasIndex(node.left) || (IdArity(node.id) == 2 && HasIndex(node.right));
+    case NODE_ADD   : //fallthrough
+    case NODE_SUB   : //fallthrough
+    case NODE_MUL   : //fallthrough
+    case NODE_DIV   : //fallthrough
+    case NODE_POW   : return HasIndex(node.left) || HasIndex(node.right);
+    default         : return IsCompare(node.type) && (HasIndex(node.left) || HasIndex(node.right));
+  }
+}
+
+/* Returns index of variable with given name or 'var_names.size()' if there is no such variable */
+size_t ExprTree::VarIndex(const std::string &name) const
+{
+  PROFILE_COUNT(var_lookups, 1)
+
+  size_t idx = 0;
+  while (idx < var_names.size() && var_names[idx] != name)
+  {
+    idx++;
+  }
+  return idx;
+}
+
+/* Returns index of the latest binding with given name or 'let_names.size()' if there is no such binding */
+size_t ExprTree::LetIndex(const std::string &name) const
+{
+  for (size_t idx = let_names.size(); idx-- > 0;)
+  {
+    if (let_names[idx] == name)
+    {
+      return idx;
+    }
+  }
+  return let_names.size();
+}
+
+/* Adds 'let' binding of subtree 'value' and returns its index */
+size_t ExprTree::AddLet(const std::string &name, size_t value)
+{
+  let_names.push_back(name);
+  let_roots.push_back(value);
+  return let_names.size() - 1;
+}
+
+/* Evaluates expression in real numbers. 'var_values' holds values of variables in order of 'var_names' */
+double ExprTree::Eval(const double *var_values) const
+{
+  return Evaluator<double>::Eval(*this, var_values);
+}
+
+/* Calculates identifier operation */
+double ExprTree::CalcOpId(ID_TYPE idType, double value)
+{
+  PROFILE_COUNT(op_calls[idType], 1)
+
+  switch (idType)
+  {
+    case ID_SIN : return sin(value);
+    case ID_COS : return cos(value);
+    case ID_TAN : return tan(value);
+    case ID_COT : return 1.0 / tan(value);
+    case ID_SQRT: return sqrt(value);
+    case ID_LN  : return log(value);
+    case ID_NORM: return fabs(value);
+    case NOT_ID : //fallthrough;
+    default     : return 0;
+  }
+}
+
+/* Calculates two-argument identifier operation. Scalars are treated as 1 x 1 matrices */
+double ExprTree::CalcOpId(ID_TYPE idType, double left, double right)
+{
+  PROFILE_COUNT(op_calls[idType], 1)
+
+  switch (idType)
+  {
+    case ID_DOT   : //fallthrough;
+    case ID_MATMUL: return left * right;
+    case ID_MIN   : return right < left ? right : left;
+    case ID_MAX   : return right > left ? right : left;
+    default       : return 0;
+  }
+}
+
+/* Returns number of identifier arguments */
+size_t ExprTree::IdArity(ID_TYPE idType)
+{
+  switch (idType)
+  {
+    case ID_DOT   : //fallthrough
+    case ID_MATMUL: //fallthrough
+    case ID_MIN   : //fallthrough
+    case ID_MAX   : return 2;
+    case ID_CLAMP : return 3;
+    default       : return 1;
+  }
+}
+
+/* Checks if node type is comparison */
+bool ExprTree::IsCompare(NODE_TYPE type)
+{
+  return NODE_LT <= type && type <= NODE_NE;
+}
+
+/* Calculates comparison, returns 1 or 0 */
+double ExprTree::Compare(NODE_TYPE type, double left, double right)
+{
+  switch (type)
+  {
+    case NODE_LT: return left <  right ? 1 : 0;
+    case NODE_LE: return left <= right ? 1 : 0;
+    case NODE_GT: return left >  right ? 1 : 0;
+    case NODE_GE: return left >= right ? 1 : 0;
+    case NODE_EQ: return left == right ? 1 : 0;
+    case NODE_NE: return left != right ? 1 : 0;
+    default     : return 0;
+  }
+}
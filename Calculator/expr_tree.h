@@ -0,0 +1,138 @@
+#ifndef CALCULATOR_EXPR_TREE_H
+#define CALCULATOR_EXPR_TREE_H
+
+#include <string>
+#include <vector>
+
+/* Maximal degree of NODE_POLY polynomial */
+#define POLY_MAX_DEGREE 64
+
+/* Identifier types */
+enum ID_TYPE
+{
+  NOT_ID,
+  ID_SIN,
+  ID_COS,
+  ID_TAN,
+  ID_COT,
+  ID_SQRT,
+  ID_LN,
+  ID_NORM,   /* Euclidean (Frobenius) norm of vector or matrix, absolute value of scalar */
+  ID_DOT,    /* Dot product of two vectors or matrices of the same shape */
+  ID_MATMUL, /* Matrix product */
+  ID_MIN,    /* Lesser of two arguments, elementwise */
+  ID_MAX,    /* Greater of two arguments, elementwise */
+  ID_CLAMP,  /* First argument limited to range of the others, is replaced with 'min' and 'max' by grammar */
+  ID_SUM,    /* Sum over index range, is replaced with NODE_SUM by grammar */
+  ID_PROD,   /* Product over index range, is replaced with NODE_PROD by grammar */
+  ID_LAST    /* Used to mark the end of identifier list */
+};
+
+/* Expression tree node types */
+enum NODE_TYPE
+{
+  NODE_NUM,  /* Numeric literal */
+  NODE_IMAG, /* Imaginary unit 'i' */
+  NODE_VAR,  /* Variable */
+  NODE_LOCAL,/* Value of 'let' binding with index 'var' */
+  NODE_ADD,  /* left + right */
+  NODE_SUB,  /* left - right */
+  NODE_MUL,  /* left * right */
+  NODE_DIV,  /* left / right */
+  NODE_POW,  /* left ^ right */
+  NODE_LT,   /* left < right. Comparisons are 1 if true and 0 if false, complex numbers are compared by real parts */
+  NODE_LE,   /* left <= right */
+  NODE_GT,   /* left > right */
+  NODE_GE,   /* left >= right */
+  NODE_EQ,   /* left == right */
+  NODE_NE,   /* left != right */
+  NODE_SELECT, /* cond ? left : right, condition is true if its real part is not 0 */
+  NODE_SUM,  /* Sum of body 'cond' over integer index 'var' from literal 'left' to literal 'right' inclusive */
+  NODE_PROD, /* Product of body 'cond' over integer index 'var' from literal 'left' to literal 'right' inclusive */
+  NODE_INDEX,/* Value of index 'var' of enclosing NODE_SUM or NODE_PROD */
+  NODE_FUNC, /* Identifier operation applied to left (and right for two-argument identifiers) */
+  NODE_POLY  /* Polynomial in one variable, coefficients are stored in tree coefficient pool */
+};
+
+/* Floating point type real expressions are calculated in */
+enum PRECISION
+{
+  PRECISION_FLOAT,      /* 'float', about 7 digits, vector registers hold twice as many values as of 'double' */
+  PRECISION_DOUBLE,     /* 'double', about 16 digits */
+  PRECISION_LONG_DOUBLE /* 'long double', extended precision for validation of 'double' results, not vectorized */
+};
+
+/* Expression tree node */
+struct ExprNode
+{
+  NODE_TYPE type = NODE_NUM;
+  double value = 0;       /* Literal value of NODE_NUM */
+  bool is_exact = false;  /* 'true' if NODE_NUM value is exactly 'exact_num / exact_den' */
+  long long exact_num = 0;
+  long long exact_den = 1;
+  size_t left = 0;        /* Left operand, function argument or offset of NODE_POLY coefficients */
+  size_t right = 0;       /* Right operand or degree of NODE_POLY */
+  size_t var = 0;         /* Variable index of NODE_VAR and NODE_POLY, binding index of NODE_LOCAL,
+                           * index number of NODE_SUM, NODE_PROD and NODE_INDEX */
+  size_t cond = 0;        /* Condition of NODE_SELECT, body of NODE_SUM and NODE_PROD */
+  ID_TYPE id = NOT_ID;    /* Identifier type of NODE_FUNC */
+};
+
+/* Compiled expression. Nodes are stored in one array and refer to each other by index.
+ * Script 'let a = E1; let b = E2; E' has roots of E1 and E2 in 'let_roots' and root of E in 'root'.
+ * Binding is calculated before all statements after it, NODE_LOCAL nodes refer to its value */
+class ExprTree
+{
+public:
+  std::vector<ExprNode> nodes;        /* Node storage */
+  std::vector<double> coeffs;         /* Coefficient pool of NODE_POLY nodes, lowest power first */
+  std::vector<std::string> var_names; /* Variable names, variable index is position in this array */
+  std::vector<size_t> let_roots;      /* Roots of 'let' bindings in order of statements */
+  std::vector<std::string> let_names; /* Names of 'let' bindings, binding index is position in this array */
+  size_t index_count = 0;             /* Number of NODE_SUM and NODE_PROD indices */
+  size_t root = 0;                    /* Index of expression root node */
+  bool has_imag = false;              /* 'true' if expression contains imaginary unit */
+
+  /* Node constructors. Return index of created node */
+  size_t AddNum(double value);
+  size_t AddExactNum(long long num, long long den);
+  size_t AddImag();
+  size_t AddVar(const std::string &name);
+  size_t AddLocal(size_t binding);
+  size_t AddOp(NODE_TYPE type, size_t left, size_t right);
+  size_t AddFunc(ID_TYPE id, size_t arg);
+  size_t AddFunc(ID_TYPE id, size_t arg, size_t second_arg);
+  size_t AddSelect(size_t cond, size_t left, size_t right);
+  size_t AddIndex(size_t index);
+  size_t AddReduce(NODE_TYPE type, size_t index, size_t first, size_t last, size_t body);
+
+  /* Copies subtree with root 'idx' and returns index of the copy root */
+  size_t CopySubtree(size_t idx);
+
+  /* Checks if subtree with root 'idx' consists of literals only */
+  bool IsConstant(size_t idx) const;
+
+  /* Checks if subtree with root 'idx' refers to index of NODE_SUM or NODE_PROD */
+  bool HasIndex(size_t idx) const;
+
+  /* Returns index of variable with given name or 'var_names.size()' if there is no such variable */
+  size_t VarIndex(const std::string &name) const;
+
+  /* Returns index of the latest binding with given name or 'let_names.size()' if there is no such binding */
+  size_t LetIndex(const std::string &name) const;
+
+  /* Adds 'let' binding of subtree 'value' and returns its index */
+  size_t AddLet(const std::string &name, size_t value);
+
+  /* Evaluates expression in real numbers. 'var_values' holds values of variables in order of 'var_names'.
+   * Other scalar types are evaluated by 'Evaluator' template */
+  double Eval(const double *var_values = nullptr) const;
+
+  static double CalcOpId(ID_TYPE idType, double value);              /* Calculates identifier operation */
+  static double CalcOpId(ID_TYPE idType, double left, double right); /* Calculates two-argument identifier operation */
+  static size_t IdArity(ID_TYPE idType);                             /* Returns number of identifier arguments */
+  static bool IsCompare(NODE_TYPE type);                              /* Checks if node type is comparison */
+  static double Compare(NODE_TYPE type, double left, double right);   /* Calculates comparison, returns 1 or 0 */
+};
+
+#endif //CALCULATOR_EXPR_TREE_H
@@ -1,102 +1,477 @@
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <cctype>
+#include <cstring>
+#include <type_traits>
 
 #include "grammar.h"
+#include "evaluator.h"
+#include "exact.h"
+#include "grammar_profile.h"
+#include "matrix_eval.h"
+#include "polynomial.h"
+#include "reduce.h"
+
+/* Builds expression tree of given expression using grammar rules and returns it and error code */
+std::pair<ExprTree, ERR_CODE> Grammar::Compile(const char *buffer)
+{
+  return Compile(buffer, true);
+}
+
+/* Builds expression tree. If 'is_rounding_folded' is false, polynomials and reductions are not folded
+ * in round-to-nearest 'double', so interval calculation of the tree gives guaranteed bounds */
+std::pair<ExprTree, ERR_CODE> Grammar::Compile(const char *buffer, bool is_rounding_folded)
+{
+  PROFILE_SCOPE(PROF_COMPILE)
+
+  InputBuffer inputBuffer(const_cast<char *>(buffer));
+  std::pair<ExprTree, ERR_CODE> result;
+
+  tree = ExprTree();
+  arg_depth = 0;
+  inline_stack.clear();
+  inlined_nodes = 0;
+  indices.clear();
+  tree.root = GetG(inputBuffer);
+  result.second = inputBuffer.ShowErr();
+  last_error = inputBuffer.ShowErrInfo();
+  PROFILE_COUNT(bytes, inputBuffer.GetOffset())
+
+  if (result.second == SUCCESS)
+  {
+    {
+      PROFILE_SCOPE(PROF_FOLD_EXACT)
+      FoldExact(tree);
+    }
+    if (is_rounding_folded)
+    {
+      PROFILE_SCOPE(PROF_REWRITE_POLY)
+      RewritePolynomials(tree);
+    }
+    if (tree.index_count != 0)
+    {
+      PROFILE_SCOPE(PROF_FOLD_REDUCE)
+      result.second = is_rounding_folded ? FoldReductions(tree) : CheckReductions(tree);
+      if (result.second != SUCCESS)
+      {
+        SetEvalError(result.second, "literal reduction bounds");
+      }
+      if (is_rounding_folded)
+      {
+        RewritePolynomials(tree); /* folded reductions may make enclosing expressions constant */
+      }
+    }
+  }
+
+  result.first = std::move(tree);
+  return result;
+}
+
+/* Defines user function 'name(p1, ..., pn) = E' ended with terminator and returns error code.
+ * Body is checked by compiling call with literal arguments. Recursive definitions are rejected */
+ERR_CODE Grammar::Define(const char *buffer)
+{
+  InputBuffer inputBuffer(const_cast<char *>(buffer));
+  std::string name{};
+  UserFunction function;
+
+  SkipSpace(inputBuffer);
+  if (!IsNewName(name, GetId(inputBuffer, name)))
+  {
+    return FAILURE;
+  }
+
+  SkipSpace(inputBuffer);
+  REQUIRE('(', inputBuffer)
+  SkipSpace(inputBuffer);
+
+  std::string call = name + "(";
+  while (inputBuffer.ShowErr() == SUCCESS && inputBuffer.ShowCurr() != ')')
+  {
+    if (!function.params.empty())
+    {
+      REQUIRE(',', inputBuffer)
+      SkipSpace(inputBuffer);
+      call += ",";
+    }
+
+    std::string param{};
+    if (!IsNewName(param, GetId(inputBuffer, param)) ||
+        std::find(function.params.begin(), function.params.end(), param) != function.params.end())
+    {
+      return FAILURE;
+    }
+    function.params.push_back(param);
+    call += "1";
+    SkipSpace(inputBuffer);
+  }
+
+  REQUIRE(')', inputBuffer)
+  SkipSpace(inputBuffer);
+  REQUIRE('=', inputBuffer)
+
+  const char *body_end = strrchr(buffer + inputBuffer.GetOffset(), terminator);
+  if (inputBuffer.ShowErr() != SUCCESS || body_end == nullptr)
+  {
+    return FAILURE;
+  }
+  function.body.assign(buffer + inputBuffer.GetOffset(), body_end);
+  call += ")";
+  call.push_back(terminator);
+
+  FunctionTable old_functions = functions;
+  functions[name] = function;
+
+  ERR_CODE code = Compile(call.c_str()).second;
+  if (code != SUCCESS)
+  {
+    functions = std::move(old_functions);
+  }
+  return code;
+}
 
 /* Calculates given expression using grammar rules and returns result and error code */
 std::pair<double, ERR_CODE> Grammar::CalcExpr(const char *buffer)
 {
-  InputBuffer inputBuffer(const_cast<char *>(buffer));
-  std::pair<double, ERR_CODE> result;
+  return CalcExprT<double>(buffer, {});
+}
 
-  result.first = GetG(inputBuffer);
-  result.second = inputBuffer.ShowErr();
+/* Calculates given expression with variables and returns result and error code */
+std::pair<double, ERR_CODE> Grammar::CalcExpr(const char *buffer, const std::map<std::string, double> &vars)
+{
+  return CalcExprT<double>(buffer, vars);
+}
+
+/* Calculates given real expression with variables in floating point type 'precision' */
+std::pair<long double, ERR_CODE> Grammar::CalcExpr(const char *buffer, const std::map<std::string, double> &vars,
+                                                   PRECISION precision)
+{
+  switch (precision)
+  {
+    case PRECISION_FLOAT:
+    {
+      std::pair<float, ERR_CODE> result = CalcExprT<float>(buffer, std::map<std::string, float>(vars.begin(), vars.end()));
+      return {result.first, result.second};
+    }
+    case PRECISION_LONG_DOUBLE:
+    {
+      std::pair<long double, ERR_CODE> result =
+        CalcExprT<long double>(buffer, std::map<std::string, long double>(vars.begin(), vars.end()));
+      return {result.first, result.second};
+    }
+    case PRECISION_DOUBLE: //fallthrough
+    default:
+    {
+      std::pair<double, ERR_CODE> result = CalcExprT<double>(buffer, vars);
+      return {result.first, result.second};
+    }
+  }
+}
+
+/* Calculates given expression with variables in complex numbers and returns result and error code */
+std::pair<std::complex<double>, ERR_CODE> Grammar::CalcComplexExpr(const char *buffer,
+                                                                   const std::map<std::string, std::complex<double>> &vars)
+{
+  return CalcExprT<std::complex<double>>(buffer, vars);
+}
 
+/* Calculates given expression with vector and matrix variables and returns result and error code */
+std::pair<Matrix, ERR_CODE> Grammar::CalcMatrixExpr(const char *buffer, const std::map<std::string, Matrix> &vars)
+{
+  std::pair<ExprTree, ERR_CODE> compiled = Compile(buffer);
+  std::pair<Matrix, ERR_CODE> result(Matrix(), compiled.second);
+
+  if (result.second != SUCCESS)
+  {
+    return result;
+  }
+
+  std::vector<const Matrix *> var_values;
+  for (auto &name : compiled.first.var_names)
+  {
+    auto var_ptr = vars.find(name);
+    if (var_ptr == vars.end())
+    {
+      result.second = ERR_WRONG_INPUT;
+      SetEvalError(result.second, "value of every variable");
+      return result;
+    }
+    var_values.push_back(&var_ptr->second);
+  }
+
+  result.second = EvalMatrixExpr(compiled.first, var_values.data(), result.first);
+  if (result.second != SUCCESS)
+  {
+    SetEvalError(result.second, "operands of conforming sizes");
+  }
   return result;
 }
 
-/* Implies axiom rule of grammar. G->E$ */
-double Grammar::GetG(InputBuffer &inputBuffer)
+/* Calculates bounds of given expression over intervals of variables and returns them and error code */
+std::pair<Interval, ERR_CODE> Grammar::CalcIntervalExpr(const char *buffer, const std::map<std::string, Interval> &vars,
+                                                        size_t boxes, unsigned threads)
 {
-  double result = 0;
-  GET_AND_CHECK_WITH_RETURN(result, GetE(inputBuffer), inputBuffer)
+  std::pair<ExprTree, ERR_CODE> compiled = Compile(buffer, false);
+  std::pair<Interval, ERR_CODE> result(Interval(), compiled.second);
 
-  if (inputBuffer.Get() != terminator) { SyntaxError(inputBuffer); }
+  if (result.second != SUCCESS)
+  {
+    return result;
+  }
+
+  std::vector<Interval> box;
+  for (auto &name : compiled.first.var_names)
+  {
+    auto var_ptr = vars.find(name);
+    if (var_ptr == vars.end())
+    {
+      result.second = ERR_WRONG_INPUT;
+      SetEvalError(result.second, "value of every variable");
+      return result;
+    }
+    box.push_back(var_ptr->second);
+  }
 
+  result.second = EvalIntervalBox(compiled.first, box.data(), result.first, boxes, threads);
+  if (result.second != SUCCESS)
+  {
+    SetEvalError(result.second, "real expression");
+  }
   return result;
 }
 
+/* Calculates expression in given scalar type. Real expression must not contain imaginary unit */
+template <typename ScalarT>
+std::pair<ScalarT, ERR_CODE> Grammar::CalcExprT(const char *buffer, const std::map<std::string, ScalarT> &vars)
+{
+  std::pair<ExprTree, ERR_CODE> compiled = Compile(buffer);
+  std::pair<ScalarT, ERR_CODE> result(0, compiled.second);
+
+  if (result.second != SUCCESS)
+  {
+    return result;
+  }
+
+  if (compiled.first.has_imag && std::is_floating_point<ScalarT>::value)
+  {
+    result.second = ERR_WRONG_INPUT;
+    SetEvalError(result.second, "real expression");
+    return result;
+  }
+
+  std::vector<ScalarT> var_values;
+  for (auto &name : compiled.first.var_names)
+  {
+    auto var_ptr = vars.find(name);
+    if (var_ptr == vars.end())
+    {
+      result.second = ERR_WRONG_INPUT;
+      SetEvalError(result.second, "value of every variable");
+      return result;
+    }
+    var_values.push_back(var_ptr->second);
+  }
+
+  result.first = Evaluator<ScalarT>::Eval(compiled.first, var_values.data());
+  return result;
+}
+
+/* Implies axiom rule of grammar. G->{L}*S$ */
+size_t Grammar::GetG(InputBuffer &inputBuffer)
+{
+  PROFILE_SCOPE(PROF_GET_G)
+
+  size_t result = 0;
+
+  SkipSpace(inputBuffer);
+  while (IsLet(inputBuffer))
+  {
+    GET_AND_CHECK_WITH_RETURN(result, GetL(inputBuffer), inputBuffer)
+    SkipSpace(inputBuffer);
+  }
+
+  GET_AND_CHECK_WITH_RETURN(result, GetS(inputBuffer), inputBuffer)
+
+  if (inputBuffer.ShowCurr() == terminator) { inputBuffer.IncOffset(); }
+  else                                      { SyntaxError(inputBuffer, FAILURE, "operator or end of expression"); }
+
+  return result;
+}
+
+/* Implies binding rule of grammar. L->'let' Id '=' S ';'
+ * Binding is visible in all following statements and hides variable or earlier binding with the same name */
+size_t Grammar::GetL(InputBuffer &inputBuffer)
+{
+  PROFILE_SCOPE(PROF_GET_L)
+
+  for (size_t i = 0; i < sizeof("let") - 1; i++)
+  {
+    inputBuffer.IncOffset();
+  }
+  SkipSpace(inputBuffer);
+
+  std::string name{};
+  ID_TYPE idType = NOT_ID;
+  GET_AND_CHECK_WITH_RETURN(idType, GetId(inputBuffer, name), inputBuffer)
+
+  if (!IsNewName(name, idType))
+  {
+    SyntaxError(inputBuffer, FAILURE, "new binding name");
+    return 0;
+  }
+
+  SkipSpace(inputBuffer);
+  REQUIRE('=', inputBuffer)
+
+  size_t value = 0;
+  GET_AND_CHECK_WITH_RETURN(value, GetS(inputBuffer), inputBuffer)
+  REQUIRE(';', inputBuffer)
+
+  return tree.AddLet(name, value);
+}
+
+/* Implies selection rule of grammar. S->C{'?'S':'S}
+ * Both operands are parsed, batch evaluation decides if they are blended or calculated lazily */
+size_t Grammar::GetS(InputBuffer &inputBuffer)
+{
+  PROFILE_SCOPE(PROF_GET_S)
+
+  size_t result = 0;
+  GET_AND_CHECK_WITH_RETURN(result, GetC(inputBuffer), inputBuffer)
+
+  if (inputBuffer.ShowCurr() == '?')
+  {
+    inputBuffer.IncOffset();
+
+    size_t left = 0, right = 0;
+    GET_AND_CHECK_WITH_RETURN(left, GetS(inputBuffer), inputBuffer)
+    REQUIRE(':', inputBuffer)
+    GET_AND_CHECK_WITH_RETURN(right, GetS(inputBuffer), inputBuffer)
+
+    result = tree.AddSelect(result, left, right);
+  }
+
+  return result;
+}
+
+/* Implies comparison rule of grammar. C->E{['<','<=','>','>=','==','!=']E}
+ * Comparisons do not chain. '=' alone is not comparison, so it may be expression terminator */
+size_t Grammar::GetC(InputBuffer &inputBuffer)
+{
+  PROFILE_SCOPE(PROF_GET_C)
+
+  size_t result = 0;
+  GET_AND_CHECK_WITH_RETURN(result, GetE(inputBuffer), inputBuffer)
+
+  NODE_TYPE type = NODE_NUM;
+  char curr = inputBuffer.ShowCurr();
+  bool is_double = curr != '\0' && inputBuffer.ShowAhead(1) == '=';
+
+  switch (curr)
+  {
+    case '<': type = is_double ? NODE_LE : NODE_LT; break;
+    case '>': type = is_double ? NODE_GE : NODE_GT; break;
+    case '=': type = is_double ? NODE_EQ : NODE_NUM; break;
+    case '!': type = is_double ? NODE_NE : NODE_NUM; break;
+    default : break;
+  }
+
+  if (!ExprTree::IsCompare(type))
+  {
+    return result;
+  }
+
+  inputBuffer.IncOffset();
+  if (is_double)
+  {
+    inputBuffer.IncOffset();
+  }
+
+  size_t right = 0;
+  GET_AND_CHECK_WITH_RETURN(right, GetE(inputBuffer), inputBuffer)
+
+  return tree.AddOp(type, result, right);
+}
+
 /* Implies [+,-] expression reading rule of grammar. E->T{[+,-]T}* */
-double Grammar::GetE(InputBuffer &inputBuffer)
+size_t Grammar::GetE(InputBuffer &inputBuffer)
 {
-  double result = 0;
+  PROFILE_SCOPE(PROF_GET_E)
+
+  size_t result = 0;
   GET_AND_CHECK_WITH_RETURN(result, GetT(inputBuffer), inputBuffer)
 
   while (inputBuffer.ShowCurr() == '+' || inputBuffer.ShowCurr() == '-')
   {
     char operation = inputBuffer.Get();
 
-    double tmp = 0;
+    size_t tmp = 0;
     GET_AND_CHECK_WITH_RETURN(tmp, GetT(inputBuffer), inputBuffer)
 
-    if (operation == '+') { result += tmp; }
-    else                  { result -= tmp; }
+    if (operation == '+') { result = tree.AddOp(NODE_ADD, result, tmp); }
+    else                  { result = tree.AddOp(NODE_SUB, result, tmp); }
   }
 
   return result;
 }
 
 /* Implies [*,/] expression reading rule of grammar. T->D{[*,/]D}* */
-double Grammar::GetT(InputBuffer &inputBuffer)
+size_t Grammar::GetT(InputBuffer &inputBuffer)
 {
-  double result = 0;
+  PROFILE_SCOPE(PROF_GET_T)
+
+  size_t result = 0;
   GET_AND_CHECK_WITH_RETURN(result, GetD(inputBuffer), inputBuffer)
 
   while (inputBuffer.ShowCurr() == '*' || inputBuffer.ShowCurr() == '/')
   {
     char operation = inputBuffer.Get();
 
-    double tmp = 0;
+    size_t tmp = 0;
     GET_AND_CHECK_WITH_RETURN(tmp, GetD(inputBuffer), inputBuffer)
 
-    if (operation == '*') { result *= tmp; }
-    else                  { result /= tmp; }
+    if (operation == '*') { result = tree.AddOp(NODE_MUL, result, tmp); }
+    else                  { result = tree.AddOp(NODE_DIV, result, tmp); }
   }
 
   return result;
 }
 
 /* Implies [^] expression reading rule of grammar. D->P{^D}* */
-double Grammar::GetD(InputBuffer &inputBuffer)
+size_t Grammar::GetD(InputBuffer &inputBuffer)
 {
-  double result = 0;
+  PROFILE_SCOPE(PROF_GET_D)
+
+  size_t result = 0;
   GET_AND_CHECK_WITH_RETURN(result, GetP(inputBuffer), inputBuffer)
 
   while (inputBuffer.ShowCurr() == '^')
   {
     inputBuffer.IncOffset();
 
-    double tmp = 0;
+    size_t tmp = 0;
     GET_AND_CHECK_WITH_RETURN(tmp, GetD(inputBuffer), inputBuffer)
 
-    result = pow(result, tmp);
+    result = tree.AddOp(NODE_POW, result, tmp);
   }
 
   return result;
 }
 
-/* Implies parentheses obtain. P->'('E')' | N | Id'('E')' */
-double Grammar::GetP(InputBuffer &inputBuffer)
+/* Implies parentheses obtain. P->'('S')' | N | Id'('S{','S}')' | R | F | Var */
+size_t Grammar::GetP(InputBuffer &inputBuffer)
 {
+  PROFILE_SCOPE(PROF_GET_P)
+
   SkipSpace(inputBuffer);
 
-  double result = 0;
+  size_t result = 0;
 
   if (inputBuffer.ShowCurr() == '(')
   {
     inputBuffer.IncOffset();
-    GET_AND_CHECK_WITH_RETURN(result, GetE(inputBuffer), inputBuffer)
+    GET_AND_CHECK_WITH_RETURN(result, GetS(inputBuffer), inputBuffer)
     REQUIRE(')', inputBuffer)
   }
   else if (isdigit(inputBuffer.ShowCurr()) || inputBuffer.ShowCurr() == '+' || inputBuffer.ShowCurr() == '-')
@@ -104,22 +479,79 @@ double Grammar::GetP(InputBuffer &inputBuffer)
     result = 0;
     GET_AND_CHECK_WITH_RETURN(result, GetN(inputBuffer), inputBuffer)
   }
-  else /* Id'('E')' is to be obtained here */
+  else /* Id'('E')' or Var is to be obtained here */
   {
+    std::string id_word{};
     ID_TYPE idType = NOT_ID;
-    GET_AND_CHECK_WITH_RETURN(idType, GetId(inputBuffer), inputBuffer)
+    GET_AND_CHECK_WITH_RETURN(idType, GetId(inputBuffer, id_word), inputBuffer)
 
-    if (idType == NOT_ID)
+    if (id_word.empty())
+    {
+      SyntaxError(inputBuffer, FAILURE, "operand");
+    }
+    else if (idType == NOT_ID && mode == MODE_COMPLEX && id_word == "i") /* imaginary unit */
+    {
+      result = tree.AddImag();
+    }
+    else if (idType == NOT_ID && FindIndex(id_word) != indices.size())
+    {
+      result = tree.AddIndex(indices[FindIndex(id_word)].second); /* index of enclosing reduction */
+    }
+    else if (idType == NOT_ID && !inline_stack.empty() && inline_stack.back().params.count(id_word) != 0)
+    {
+      result = tree.CopySubtree(inline_stack.back().params[id_word]); /* parameter of function being inlined */
+    }
+    else if (idType == NOT_ID && inline_stack.empty() && tree.LetIndex(id_word) != tree.let_names.size())
+    {
+      result = tree.AddLocal(tree.LetIndex(id_word)); /* 'let' binding, not visible in function bodies */
+    }
+    else if (idType == NOT_ID && functions.count(id_word) != 0)
+    {
+      GET_AND_CHECK_WITH_RETURN(result, GetCall(inputBuffer, id_word), inputBuffer)
+    }
+    else if (idType == NOT_ID) /* variable */
+    {
+      result = tree.AddVar(id_word);
+    }
+    else if (idType == ID_SUM || idType == ID_PROD)
     {
-      SyntaxError(inputBuffer);
+      GET_AND_CHECK_WITH_RETURN(result, GetR(inputBuffer, idType), inputBuffer)
     }
     else
     {
       SkipSpace(inputBuffer);
       REQUIRE('(', inputBuffer)
 
-      GET_AND_CHECK_WITH_RETURN(result, GetE(inputBuffer), inputBuffer)
-      result = CalcOpId(idType, result);
+      if (ExprTree::IdArity(idType) == 1)
+      {
+        GET_AND_CHECK_WITH_RETURN(result, GetS(inputBuffer), inputBuffer)
+        result = tree.AddFunc(idType, result);
+      }
+      else
+      {
+        arg_depth++;
+
+        size_t args[3] = {};
+        for (size_t i = 0; i < ExprTree::IdArity(idType); i++)
+        {
+          if (i != 0)
+          {
+            REQUIRE(',', inputBuffer)
+          }
+          GET_AND_CHECK_WITH_RETURN(args[i], GetS(inputBuffer), inputBuffer)
+        }
+
+        if (idType == ID_CLAMP) /* clamp(x, lo, hi) = min(max(x, lo), hi) */
+        {
+          result = tree.AddFunc(ID_MIN, tree.AddFunc(ID_MAX, args[0], args[1]), args[2]);
+        }
+        else
+        {
+          result = tree.AddFunc(idType, args[0], args[1]);
+        }
+
+        arg_depth--;
+      }
 
       REQUIRE(')', inputBuffer)
     }
@@ -129,9 +561,134 @@ double Grammar::GetP(InputBuffer &inputBuffer)
   return result;
 }
 
-/* Implies number reading rule of grammar. N->[+,-, eps][0,...,9]+ */
-double Grammar::GetN(InputBuffer &inputBuffer)
+/* Implies user function call rule of grammar. F->Id'('[S{','S}*]')'
+ * Call is inlined: function body is parsed in place with parameters bound to arguments.
+ * Calls of functions which are already being inlined are rejected with ERR_RECURSION, calls
+ * making inlined calls add more than 'inline_limit' nodes to expression with ERR_INLINE_LIMIT */
+size_t Grammar::GetCall(InputBuffer &inputBuffer, const std::string &name)
 {
+  PROFILE_SCOPE(PROF_GET_CALL)
+
+  const UserFunction &function = functions.at(name);
+  InlineFrame frame;
+  frame.name = name;
+
+  SkipSpace(inputBuffer);
+  REQUIRE('(', inputBuffer)
+  arg_depth++;
+
+  size_t result = 0;
+  for (size_t i = 0; i < function.params.size() && inputBuffer.ShowErr() == SUCCESS; i++)
+  {
+    if (i != 0)
+    {
+      REQUIRE(',', inputBuffer)
+    }
+    GET_AND_CHECK_WITH_RETURN(result, GetS(inputBuffer), inputBuffer)
+    frame.params[function.params[i]] = BindArgument(result);
+  }
+
+  arg_depth--;
+  REQUIRE(')', inputBuffer)
+  if (inputBuffer.ShowErr() != SUCCESS)
+  {
+    return result;
+  }
+
+  for (const InlineFrame &caller : inline_stack)
+  {
+    if (caller.name == name)
+    {
+      SyntaxError(inputBuffer, ERR_RECURSION, "non-recursive call");
+      return result;
+    }
+  }
+
+  if (inline_stack.empty())
+  {
+    inline_start = tree.nodes.size();
+  }
+  inline_stack.push_back(frame);
+
+  size_t outer_depth = arg_depth;
+  arg_depth = 0;
+  std::vector<std::pair<std::string, size_t>> outer_indices; /* indices of caller are not visible in body */
+  outer_indices.swap(indices);
+
+  InputBuffer body(const_cast<char *>(function.body.c_str()));
+  result = GetS(body);
+  if (body.ShowErr() == SUCCESS && body.ShowCurr() != '\0')
+  {
+    SyntaxError(body, FAILURE, "end of function body");
+  }
+
+  arg_depth = outer_depth;
+  indices.swap(outer_indices);
+  inline_stack.pop_back();
+
+  if (body.ShowErr() != SUCCESS) /* error is reported at call site with token expected in the innermost body */
+  {
+    SyntaxError(inputBuffer, body.ShowErr(), body.ShowErrInfo().expected);
+  }
+  else if (inlined_nodes + tree.nodes.size() - inline_start > inline_limit)
+  {
+    SyntaxError(inputBuffer, ERR_INLINE_LIMIT, "fewer inlined calls");
+  }
+
+  if (inline_stack.empty())
+  {
+    inlined_nodes += tree.nodes.size() - inline_start;
+  }
+
+  SkipSpace(inputBuffer);
+  return result;
+}
+
+/* Implies reduction rule of grammar. R->['sum','prod']'(' Id ',' S ',' S ',' S ')'
+ * Index is visible in body only and hides bindings, parameters and variables of the same name.
+ * Bounds must be folded to integer literals at compile time */
+size_t Grammar::GetR(InputBuffer &inputBuffer, ID_TYPE idType)
+{
+  PROFILE_SCOPE(PROF_GET_R)
+
+  SkipSpace(inputBuffer);
+  REQUIRE('(', inputBuffer)
+  SkipSpace(inputBuffer);
+
+  size_t result = 0;
+  std::string name{};
+  if (!IsNewName(name, GetId(inputBuffer, name)))
+  {
+    SyntaxError(inputBuffer, FAILURE, "index name");
+    return result;
+  }
+  SkipSpace(inputBuffer);
+  REQUIRE(',', inputBuffer)
+  arg_depth++;
+
+  size_t first = 0, last = 0;
+  GET_AND_CHECK_WITH_RETURN(first, GetS(inputBuffer), inputBuffer)
+  REQUIRE(',', inputBuffer)
+  GET_AND_CHECK_WITH_RETURN(last, GetS(inputBuffer), inputBuffer)
+  REQUIRE(',', inputBuffer)
+
+  size_t index = tree.index_count++;
+  indices.emplace_back(name, index);
+  GET_AND_CHECK_WITH_RETURN(result, GetS(inputBuffer), inputBuffer)
+  indices.pop_back();
+
+  arg_depth--;
+  REQUIRE(')', inputBuffer)
+  return tree.AddReduce(idType == ID_SUM ? NODE_SUM : NODE_PROD, index, first, last, result);
+}
+
+/* Implies number reading rule of grammar. N->[+,-, eps][0,...,9]+
+ * Literal is also kept as exact fraction if it fits to 64-bit integers.
+ * ',' is decimal separator only outside of multi-argument identifier calls */
+size_t Grammar::GetN(InputBuffer &inputBuffer)
+{
+  PROFILE_SCOPE(PROF_GET_N)
+
   bool is_positive = true;
   if (inputBuffer.ShowCurr() == '+' || inputBuffer.ShowCurr() == '-')
   {
@@ -139,38 +696,51 @@ double Grammar::GetN(InputBuffer &inputBuffer)
   }
 
   double result = 0;
+  long long num = 0, den = 1;
+  bool is_exact = true;
   size_t start_offset = inputBuffer.GetOffset();
 
   while ('0' <= inputBuffer.ShowCurr() && inputBuffer.ShowCurr() <= '9') /* integer part */
   {
-    result = result * 10 + inputBuffer.Get() - '0';
+    int digit = inputBuffer.Get() - '0';
+    result = result * 10 + digit;
+    is_exact = is_exact && !__builtin_mul_overflow(num, 10, &num) && !__builtin_add_overflow(num, digit, &num);
   }
 
-  if (inputBuffer.ShowCurr() == '.' || inputBuffer.ShowCurr() == ',')
+  if (inputBuffer.ShowCurr() == '.' || (inputBuffer.ShowCurr() == ',' && arg_depth == 0))
   {
     inputBuffer.IncOffset();
     double tenPower = 10;
     while ('0' <= inputBuffer.ShowCurr() && inputBuffer.ShowCurr() <= '9') /* fraction part */
     {
-      result += (inputBuffer.Get() - '0') / tenPower;
+      int digit = inputBuffer.Get() - '0';
+      result += digit / tenPower;
       tenPower *= 10;
+      is_exact = is_exact && !__builtin_mul_overflow(num, 10, &num) && !__builtin_add_overflow(num, digit, &num) &&
+                             !__builtin_mul_overflow(den, 10, &den);
     }
   }
 
   if (inputBuffer.GetOffset() == start_offset)
   {
-    SyntaxError(inputBuffer);
+    SyntaxError(inputBuffer, FAILURE, "number");
   }
 
-  if (!is_positive) { result *= -1; }
+  if (!is_positive)
+  {
+    result *= -1;
+    num *= -1;
+  }
 
-  return result;
+  /* exact fraction has no sign of zero, so negative zero stays 'double' */
+  is_exact = is_exact && (is_positive || num != 0);
+  return is_exact ? tree.AddExactNum(num, den) : tree.AddNum(result);
 }
 
-/* Implies ['a'-'z' | 'A'-'Z']+ reading rule of grammar */
-Grammar::ID_TYPE Grammar::GetId(InputBuffer &inputBuffer)
+/* Implies ['a'-'z' | 'A'-'Z']+ reading rule of grammar. Read word is written to 'id_word' */
+ID_TYPE Grammar::GetId(InputBuffer &inputBuffer, std::string &id_word)
 {
-  std::string id_word{};
+  PROFILE_SCOPE(PROF_GET_ID)
 
   while('a' <= inputBuffer.ShowCurr() && inputBuffer.ShowCurr() <= 'z' ||
         'A' <= inputBuffer.ShowCurr() && inputBuffer.ShowCurr() <= 'Z')
@@ -178,6 +748,7 @@ Grammar::ID_TYPE Grammar::GetId(InputBuffer &inputBuffer)
     id_word.push_back(tolower(inputBuffer.Get()));
   }
 
+  PROFILE_COUNT(id_lookups, 1)
   auto id_ptr = ID_map.find(id_word);
   if (id_ptr == ID_map.end())
   {
@@ -186,26 +757,66 @@ Grammar::ID_TYPE Grammar::GetId(InputBuffer &inputBuffer)
   return id_ptr->second;
 }
 
-/* Calculates identifier operation */
-double Grammar::CalcOpId(Grammar::ID_TYPE idType, double value)
+/* Sets new error code of input buffer */
+void Grammar::SyntaxError(InputBuffer &inputBuffer, ERR_CODE code, const char *expected)
+{
+  inputBuffer.SetErr(code >= ERR_LAST ? FAILURE : code, expected);
+}
+
+/* Sets error of calculation of compiled expression. It has no position in expression */
+void Grammar::SetEvalError(ERR_CODE code, const char *expected)
+{
+  last_error.code = code;
+  last_error.offset = 0;
+  last_error.expected = expected;
+}
+
+/* Checks if 'let' statement starts here. Keyword must be followed by space */
+bool Grammar::IsLet(const InputBuffer &inputBuffer)
+{
+  return inputBuffer.ShowCurr() == 'l' && inputBuffer.ShowAhead(1) == 'e' && inputBuffer.ShowAhead(2) == 't' &&
+         inputBuffer.ShowAhead(3) == ' ';
+}
+
+/* Checks if name may be given to binding, function or parameter */
+bool Grammar::IsNewName(const std::string &name, ID_TYPE idType) const
+{
+  return !name.empty() && idType == NOT_ID && name != "let" && !(mode == MODE_COMPLEX && name == "i");
+}
+
+/* Returns innermost position of index with given name in 'indices' or 'indices.size()' if there is no such index */
+size_t Grammar::FindIndex(const std::string &name) const
 {
-  switch (idType)
+  for (size_t pos = indices.size(); pos-- > 0;)
   {
-    case ID_SIN : return sin(value);
-    case ID_COS : return cos(value);
-    case ID_TAN : return tan(value);
-    case ID_COT : return 1.0 / tan(value);
-    case ID_SQRT: return sqrt(value);
-    case ID_LN  : return log(value);
-    case NOT_ID : //fallthrough;
-    default     : return 0;
+    if (indices[pos].first == name)
+    {
+      return pos;
+    }
   }
+  return indices.size();
 }
 
-/* Sets new error code of input buffer */
-void Grammar::SyntaxError(InputBuffer &inputBuffer, ERR_CODE code)
+/* Returns node copied at every use of parameter bound to argument 'arg'.
+ * Leaves and constant arguments are copied, so body is specialized for them by compile time folding.
+ * Arguments depending on reduction index are copied too, as they change inside reduction.
+ * Other arguments are calculated once into hidden 'let' binding */
+size_t Grammar::BindArgument(size_t arg)
 {
-  code >= ERR_LAST ? inputBuffer.SetErr(FAILURE) : inputBuffer.SetErr(code);
+  switch (tree.nodes[arg].type)
+  {
+    case NODE_NUM  : //fallthrough
+    case NODE_IMAG : //fallthrough
+    case NODE_VAR  : //fallthrough
+    case NODE_LOCAL: return arg;
+    default        : break;
+  }
+
+  if (tree.IsConstant(arg) || tree.HasIndex(arg))
+  {
+    return arg;
+  }
+  return tree.AddLocal(tree.AddLet("", arg));
 }
 
 /* Increases offset of 'inputBuffer' until all space characters ' ' are skipped */
@@ -1,8 +1,14 @@
 #ifndef CALCULATOR_GRAMMAR_H
 #define CALCULATOR_GRAMMAR_H
 
+#include <complex>
 #include <map>
+#include <string>
+#include <vector>
 #include "error_functions.h"
+#include "expr_tree.h"
+#include "interval.h"
+#include "matrix.h"
 
 /* Initializes 'result' with 'get_value',
  * checks if 'inputBuffer' contains 'SUCCESS' error code and returns result if not. */
@@ -17,17 +23,28 @@
 
 /* Detects syntax error if current character of 'inputBuffer' is not 'char' */
 #define REQUIRE(char, inputBuffer) \
-        {                                                                   \
-          if (inputBuffer.ShowCurr() == char) { inputBuffer.IncOffset(); }  \
-          else                                { SyntaxError(inputBuffer); } \
+        {                                                                                    \
+          if (inputBuffer.ShowCurr() == char) { inputBuffer.IncOffset(); }                   \
+          else                                { SyntaxError(inputBuffer, FAILURE, #char); }  \
         }
 
+/* Error of expression compilation or evaluation. Record has fixed size, so filling and copying it never allocates */
+struct ParseError
+{
+  ERR_CODE code = SUCCESS;
+  size_t offset = 0;        /* Byte offset of the first wrong character from expression start,
+                             * 0 for ERR_WRONG_INPUT errors found after parsing */
+  const char *expected = ""; /* Static description of token expected at 'offset', empty if unknown */
+};
+
 struct InputBuffer
 {
 private:
   char *buffer;     /* Contains input expression */
   size_t offset;    /* Offset from the head of input buffer */
   ERR_CODE errCode; /* Function using structure can set error code here */
+  size_t errOffset = 0;       /* Offset where the first error was detected */
+  const char *expected = "";  /* Token expected where the first error was detected */
 
 public:
   /* Class constructor */
@@ -47,6 +64,12 @@ public:
     offset++;
   }
 
+  /* Returns element which is 'ahead' positions after current one. Must not be called past the terminating zero */
+  char ShowAhead(size_t ahead) const
+  {
+    return buffer[offset + ahead];
+  }
+
   /* Returns current element from buffer without offset increment */
   char Get()
   {
@@ -72,30 +95,80 @@ public:
   {
     errCode = code;
   }
+
+  /* Sets error code and remembers current offset and expected token, if there was no error before.
+   * 'expected_token' must be static string */
+  void SetErr(ERR_CODE code, const char *expected_token)
+  {
+    if (errCode == SUCCESS)
+    {
+      errOffset = offset;
+      expected = expected_token;
+    }
+    errCode = code;
+  }
+
+  /* Returns description of the first error */
+  ParseError ShowErrInfo() const
+  {
+    ParseError error;
+    error.code = errCode;
+    error.offset = errCode == SUCCESS ? 0 : errOffset;
+    error.expected = errCode == SUCCESS ? "" : expected;
+    return error;
+  }
 };
 
-class Grammar
+/* Default maximal number of nodes inlined user function calls may add to one expression */
+#define INLINE_LIMIT 10000
+
+/* User-defined function. Body is parsed again at every call site with parameters bound to arguments */
+struct UserFunction
 {
-public:
-  /* Identifier types */
-  enum ID_TYPE
-  {
-    NOT_ID,
-    ID_SIN,
-    ID_COS,
-    ID_TAN,
-    ID_COT,
-    ID_SQRT,
-    ID_LN
-  };
+  std::vector<std::string> params; /* Parameter names */
+  std::string body;                /* Body expression without terminator */
+};
+
+typedef std::map<std::string, UserFunction> FunctionTable;
 
+/* Number field expressions are calculated in */
+enum CALC_MODE
+{
+  MODE_REAL,   /* Real numbers */
+  MODE_COMPLEX /* Complex numbers, identifier 'i' is imaginary unit */
+};
+
+class Grammar
+{
 private:
   const char terminator; /* Expression terminating symbol */
+  const CALC_MODE mode;  /* Number field of expressions */
   std::map<std::string, ID_TYPE> ID_map; /* Identifier map */
+  ExprTree tree; /* Expression tree being built */
+  size_t arg_depth = 0; /* Depth of nested multi-argument identifier calls, ',' separates arguments inside them */
+
+  /* User function call being inlined */
+  struct InlineFrame
+  {
+    std::string name;                      /* Function name */
+    std::map<std::string, size_t> params;  /* Parameter name -> node copied at every use of parameter */
+  };
+
+  FunctionTable functions;               /* User-defined functions */
+  std::vector<InlineFrame> inline_stack; /* Calls being inlined, innermost last */
+  size_t inline_limit = INLINE_LIMIT;    /* Maximal number of nodes inlined calls may add to one expression */
+  size_t inline_start = 0;               /* Number of tree nodes before the outermost call being inlined */
+  size_t inlined_nodes = 0;              /* Number of nodes added by already inlined outermost calls */
+
+  std::vector<std::pair<std::string, size_t>> indices; /* Names and numbers of indices of reductions being parsed,
+                                                        * innermost last */
+
+  ParseError last_error; /* Error of the last compiled or calculated expression */
 
 public:
   /* Class constructor which requires expression terminating symbol */
-  explicit Grammar(char init_terminator = '$') : terminator(init_terminator)
+  explicit Grammar(char init_terminator = '$', CALC_MODE init_mode = MODE_REAL) :
+    terminator(init_terminator), mode(init_mode)
   {
     ID_map["sin"]  = ID_SIN;
     ID_map["cos"]  = ID_COS;
@@ -103,22 +176,105 @@ public:
     ID_map["cot"]  = ID_COT;
     ID_map["sqrt"] = ID_SQRT;
     ID_map["ln"]   = ID_LN;
+    ID_map["norm"]   = ID_NORM;
+    ID_map["dot"]    = ID_DOT;
+    ID_map["matmul"] = ID_MATMUL;
+    ID_map["min"]    = ID_MIN;
+    ID_map["max"]    = ID_MAX;
+    ID_map["clamp"]  = ID_CLAMP;
+    ID_map["sum"]    = ID_SUM;
+    ID_map["prod"]   = ID_PROD;
+  }
+
+  /* Defines user function 'name(p1, ..., pn) = E' ended with terminator and returns error code.
+   * Redefinition replaces function, calls to it are resolved when expression using it is compiled */
+  ERR_CODE Define(const char *buffer);
+
+  /* Returns user-defined functions */
+  const FunctionTable &GetFunctions() const
+  {
+    return functions;
+  }
+
+  /* Replaces user-defined functions */
+  void SetFunctions(const FunctionTable &new_functions)
+  {
+    functions = new_functions;
+  }
+
+  /* Sets maximal number of nodes inlined calls may add to one expression */
+  void SetInlineLimit(size_t limit)
+  {
+    inline_limit = limit;
+  }
+
+  /* Builds expression tree of given expression using grammar rules and returns it and error code */
+  std::pair<ExprTree, ERR_CODE> Compile(const char *buffer);
+
+  /* Returns position and expected token of error of the last compiled or calculated expression */
+  const ParseError &GetLastError() const
+  {
+    return last_error;
   }
 
   /* Calculates given expression using grammar rules and returns result and error code */
   std::pair<double, ERR_CODE> CalcExpr(const char *buffer);
 
+  /* Calculates given expression with variables and returns result and error code */
+  std::pair<double, ERR_CODE> CalcExpr(const char *buffer, const std::map<std::string, double> &vars);
+
+  /* Calculates given real expression with variables in floating point type 'precision' and returns result
+   * and error code. Literals and variable values are rounded to that type */
+  std::pair<long double, ERR_CODE> CalcExpr(const char *buffer, const std::map<std::string, double> &vars,
+                                            PRECISION precision);
+
+  /* Calculates given expression with variables in complex numbers and returns result and error code */
+  std::pair<std::complex<double>, ERR_CODE> CalcComplexExpr(const char *buffer,
+                                                            const std::map<std::string, std::complex<double>> &vars = {});
+
+  /* Calculates given expression with vector and matrix variables and returns result and error code */
+  std::pair<Matrix, ERR_CODE> CalcMatrixExpr(const char *buffer, const std::map<std::string, Matrix> &vars);
+
+  /* Calculates bounds of given expression over intervals of variables and returns them and error code.
+   * Box of variables is split into at most 'boxes' sub-boxes calculated by 'threads' threads (see 'EvalIntervalBox') */
+  std::pair<Interval, ERR_CODE> CalcIntervalExpr(const char *buffer, const std::map<std::string, Interval> &vars,
+                                                 size_t boxes = 1, unsigned threads = 0);
+
 private:
-  double GetG(InputBuffer &inputBuffer);       /* Implies axiom rule of grammar. G->E'$' */
-  double GetE(InputBuffer &inputBuffer);       /* Implies [+,-] expression reading rule of grammar. E->T{[+,-]T}* */
-  double GetT(InputBuffer &inputBuffer);       /* Implies [*,/] expression reading rule of grammar. T->D{[*,/]D}* */
-  double GetD(InputBuffer &inputBuffer);       /* Implies [^] expression reading rule of grammar. D->P{^D}* */
-  double GetP(InputBuffer &inputBuffer);       /* Implies parentheses obtain. P->'('E')' | N | Id'('E')' */
-  double GetN(InputBuffer &inputBuffer);       /* Implies number reading rule of grammar. N->[+,-, eps][0,...,9]+ */
-  ID_TYPE GetId(InputBuffer &inputBuffer);     /* Implies ['a'-'z' | 'A'-'Z']+ reading rule of grammar */
-
-  double CalcOpId(ID_TYPE idType, double value);                              /* Calculates identifier operation */
-  static void SyntaxError(InputBuffer &inputBuffer, ERR_CODE code = FAILURE); /* Sets new error code of input buffer */
+  /* Builds expression tree. If 'is_rounding_folded' is false, polynomials and reductions are not folded
+   * in round-to-nearest 'double', so interval calculation of the tree gives guaranteed bounds */
+  std::pair<ExprTree, ERR_CODE> Compile(const char *buffer, bool is_rounding_folded);
+
+  /* Calculates expression in given scalar type */
+  template <typename ScalarT>
+  std::pair<ScalarT, ERR_CODE> CalcExprT(const char *buffer, const std::map<std::string, ScalarT> &vars);
+
+  size_t GetG(InputBuffer &inputBuffer);       /* Implies axiom rule of grammar. G->{L}*S'$' */
+  size_t GetL(InputBuffer &inputBuffer);       /* Implies binding rule of grammar. L->'let' Id '=' S ';' */
+  size_t GetS(InputBuffer &inputBuffer);       /* Implies selection rule of grammar. S->C{'?'S':'S} */
+  size_t GetC(InputBuffer &inputBuffer);       /* Implies comparison rule of grammar. C->E{['<','<=','>','>=','==','!=']E} */
+  size_t GetE(InputBuffer &inputBuffer);       /* Implies [+,-] expression reading rule of grammar. E->T{[+,-]T}* */
+  size_t GetT(InputBuffer &inputBuffer);       /* Implies [*,/] expression reading rule of grammar. T->D{[*,/]D}* */
+  size_t GetD(InputBuffer &inputBuffer);       /* Implies [^] expression reading rule of grammar. D->P{^D}* */
+  size_t GetP(InputBuffer &inputBuffer);       /* Implies parentheses obtain. P->'('S')' | N | Id'('S{','S}')' | R | F | Var */
+  size_t GetN(InputBuffer &inputBuffer);       /* Implies number reading rule of grammar. N->[+,-, eps][0,...,9]+ */
+  size_t GetCall(InputBuffer &inputBuffer, const std::string &name); /* Implies user function call rule of grammar.
+                                                                      * F->Id'('[S{','S}*]')' */
+  size_t GetR(InputBuffer &inputBuffer, ID_TYPE idType); /* Implies reduction rule of grammar.
+                                                          * R->['sum','prod']'(' Id ',' S ',' S ',' S ')' */
+  ID_TYPE GetId(InputBuffer &inputBuffer, std::string &id_word); /* Implies ['a'-'z' | 'A'-'Z']+ reading rule of grammar */
+
+  static void SyntaxError(InputBuffer &inputBuffer, ERR_CODE code = FAILURE,  /* Sets new error code of input buffer */
+                          const char *expected = "");                         /* and remembers expected token */
+  void SetEvalError(ERR_CODE code, const char *expected);                     /* Sets error of calculation of compiled
+                                                                               * expression */
+  static bool IsLet(const InputBuffer &inputBuffer);                          /* Checks if 'let' statement starts here */
+  bool IsNewName(const std::string &name, ID_TYPE idType) const;              /* Checks if name may be given to binding,
+                                                                               * function, parameter or index */
+  size_t FindIndex(const std::string &name) const;                            /* Returns position of the innermost index
+                                                                               * with given name in 'indices' */
+  size_t BindArgument(size_t arg);                                            /* Returns node copied at every use
+                                                                               * of parameter bound to argument */
   void SkipSpace(InputBuffer &inputBuffer);                                   /* Increases offset of 'inputBuffer'
                                                                                * until all space characters ' ' are skipped */
 };
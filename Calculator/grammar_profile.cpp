@@ -0,0 +1,117 @@
+#include "grammar_profile.h"
+
+#ifdef GRAMMAR_PROFILING
+
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/* Names of profiled points in JSON dump */
+static const char *const PROFILE_POINT_NAMES[PROF_LAST] = {"GetG", "GetE", "GetT", "GetD", "GetP", "GetN", "GetId", "GetL",
+                                                           "GetCall", "GetS", "GetC", "GetR", "Compile", "FoldExact",
+                                                           "RewritePolynomials", "FoldReductions", "Eval"};
+
+/* Names of identifier types in JSON dump */
+static const char *const ID_NAMES[ID_LAST] = {"not_id", "sin", "cos", "tan", "cot", "sqrt", "ln",
+                                              "norm", "dot", "matmul", "min", "max", "clamp",
+                                              "sum", "prod"};
+
+/* Counters of finished threads */
+static GrammarProfile retired_profile;
+static std::mutex retired_mutex;
+
+/* Profile of one thread, merged into 'retired_profile' when the thread finishes */
+struct ThreadProfile
+{
+  GrammarProfile profile;
+
+  ~ThreadProfile()
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired_profile.Merge(profile);
+  }
+};
+
+/* Returns profile of the calling thread */
+GrammarProfile &GrammarProfile::Get()
+{
+  static thread_local ThreadProfile thread_profile;
+  return thread_profile.profile;
+}
+
+/* Returns sum of profiles of finished threads and of the calling thread */
+GrammarProfile GrammarProfile::Total()
+{
+  GrammarProfile total;
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    total.Merge(retired_profile);
+  }
+  total.Merge(Get());
+  return total;
+}
+
+/* Sets all counters to zero */
+void GrammarProfile::Reset()
+{
+  *this = GrammarProfile();
+}
+
+/* Adds counters of 'other' profile. Recursion depths and scope chain are not merged */
+void GrammarProfile::Merge(const GrammarProfile &other)
+{
+  for (int i = 0; i < PROF_LAST; i++)
+  {
+    calls[i] += other.calls[i];
+    cycles[i] += other.cycles[i];
+    self_cycles[i] += other.self_cycles[i];
+  }
+  for (int i = 0; i < ID_LAST; i++)
+  {
+    op_calls[i] += other.op_calls[i];
+  }
+  bytes += other.bytes;
+  id_lookups += other.id_lookups;
+  var_lookups += other.var_lookups;
+}
+
+/* Writes counters in JSON format */
+void GrammarProfile::DumpJSON(std::ostream &os) const
+{
+  os << "{\n  \"points\": {\n";
+  for (int i = 0; i < PROF_LAST; i++)
+  {
+    os << "    \"" << PROFILE_POINT_NAMES[i] << "\": {\"calls\": " << calls[i] << ", \"cycles\": " << cycles[i]
+       << ", \"self_cycles\": " << self_cycles[i] << "}";
+    os << (i + 1 < PROF_LAST ? ",\n" : "\n");
+  }
+  os << "  },\n";
+
+  os << "  \"bytes\": " << bytes << ",\n";
+  os << "  \"id_lookups\": " << id_lookups << ",\n";
+  os << "  \"var_lookups\": " << var_lookups << ",\n";
+
+  os << "  \"op_calls\": {";
+  for (int i = ID_SIN; i < ID_LAST; i++)
+  {
+    os << "\"" << ID_NAMES[i] << "\": " << op_calls[i] << (i + 1 < ID_LAST ? ", " : "");
+  }
+  os << "}\n}\n";
+}
+
+/* Reads time stamp counter. Falls back to steady clock nanoseconds on other architectures */
+unsigned long long ReadTSC()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#endif //GRAMMAR_PROFILING
@@ -0,0 +1,124 @@
+#ifndef CALCULATOR_GRAMMAR_PROFILE_H
+#define CALCULATOR_GRAMMAR_PROFILE_H
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*********************************************************************************************************
+ * Grammar profiling implementation.
+ *
+ * To activate profiling counters it is necessary to define GRAMMAR_PROFILING for all calculator files
+ * (CMake option CALCULATOR_PROFILING). Without it all profiling code is compiled out.
+ */
+
+#ifdef GRAMMAR_PROFILING
+#define ON_GRAMMAR_PROFILING(code) code
+#else
+#define ON_GRAMMAR_PROFILING(code)
+#endif //GRAMMAR_PROFILING
+
+/* Counts call and measures cycles spent in the current scope */
+#define PROFILE_SCOPE(point) ON_GRAMMAR_PROFILING(ProfileScope profile_scope(point);)
+
+/* Adds 'value' to profiling counter 'counter' */
+#define PROFILE_COUNT(counter, value) ON_GRAMMAR_PROFILING(GrammarProfile::Get().counter += (value);)
+
+#ifdef GRAMMAR_PROFILING
+
+#include <iostream>
+#include "expr_tree.h"
+
+/* Profiled code points */
+enum PROFILE_POINT
+{
+  PROF_GET_G,
+  PROF_GET_E,
+  PROF_GET_T,
+  PROF_GET_D,
+  PROF_GET_P,
+  PROF_GET_N,
+  PROF_GET_ID,
+  PROF_GET_L,
+  PROF_GET_CALL,
+  PROF_GET_S,
+  PROF_GET_C,
+  PROF_GET_R,
+  PROF_COMPILE,      /* Whole 'Grammar::Compile' */
+  PROF_FOLD_EXACT,   /* Exact subexpressions folding */
+  PROF_REWRITE_POLY, /* Polynomial subexpressions rewriting */
+  PROF_FOLD_REDUCE,  /* Calculation of reductions of literals */
+  PROF_EVAL,         /* Expression tree evaluation */
+  PROF_LAST          /* used to mark the end of point list */
+};
+
+class ProfileScope;
+
+/* Profiling counters of grammar and expression evaluation. Every thread has its own counters and scope chain,
+ * counters of finished threads are merged into the total profile */
+struct GrammarProfile
+{
+  unsigned long long calls[PROF_LAST] = {};       /* Number of calls of every profiled point */
+  unsigned long long cycles[PROF_LAST] = {};      /* Time stamp counter cycles spent in every point, nested calls included.
+                                                   * Recursive calls of the same point are counted once */
+  unsigned long long self_cycles[PROF_LAST] = {}; /* Cycles spent in every point, nested profiled points excluded */
+  unsigned depth[PROF_LAST] = {};                 /* Current recursion depth of every point */
+  ProfileScope *current = nullptr;                /* Innermost active scope */
+  unsigned long long bytes = 0;              /* Bytes of input consumed by parser */
+  unsigned long long id_lookups = 0;         /* Lookups in identifier map */
+  unsigned long long var_lookups = 0;        /* Lookups in variable list of expression tree */
+  unsigned long long op_calls[ID_LAST] = {}; /* 'CalcOpId' calls by identifier type */
+
+  /* Returns profile of the calling thread */
+  static GrammarProfile &Get();
+
+  /* Returns sum of profiles of finished threads and of the calling thread */
+  static GrammarProfile Total();
+
+  /* Sets all counters to zero */
+  void Reset();
+
+  /* Adds counters of 'other' profile. Recursion depths and scope chain are not merged */
+  void Merge(const GrammarProfile &other);
+
+  /* Writes counters in JSON format */
+  void DumpJSON(std::ostream &os) const;
+};
+
+/* Reads time stamp counter. Falls back to steady clock nanoseconds on other architectures */
+unsigned long long ReadTSC();
+
+/* Counts call of profiled point and adds cycles spent in scope to it */
+class ProfileScope
+{
+private:
+  PROFILE_POINT point;
+  ProfileScope *parent;                  /* Enclosing active scope */
+  unsigned long long nested_cycles = 0;  /* Cycles spent in nested scopes */
+  unsigned long long start;
+
+public:
+  explicit ProfileScope(PROFILE_POINT init_point) : point(init_point), parent(GrammarProfile::Get().current)
+  {
+    GrammarProfile &profile = GrammarProfile::Get();
+
+    profile.calls[point]++;
+    profile.depth[point]++;
+    profile.current = this;
+    start = ReadTSC();
+  }
+
+  ~ProfileScope()
+  {
+    unsigned long long elapsed = ReadTSC() - start;
+    GrammarProfile &profile = GrammarProfile::Get();
+
+    profile.depth[point]--;
+    if (profile.depth[point] == 0) { profile.cycles[point] += elapsed; }
+    profile.self_cycles[point] += elapsed - nested_cycles;
+
+    if (parent != nullptr) { parent->nested_cycles += elapsed; }
+    profile.current = parent;
+  }
+};
+
+#endif //GRAMMAR_PROFILING
+
+#endif //CALCULATOR_GRAMMAR_PROFILE_H
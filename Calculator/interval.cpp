@@ -0,0 +1,472 @@
+#include <algorithm>
+
+#include "interval.h"
+#include "evaluator.h"
+#include "parallel.h"
+
+/* Magnitude starting from which period of trigonometric functions is not resolved precisely enough */
+#define INTERVAL_TRIG_MAX 1e15
+
+/* Relative tolerance of search of extremum and pole points, wider search only loosens bounds */
+#define INTERVAL_TRIG_EPS 1e-12
+
+/* Maximal number of integer exponents whose powers of negative base are joined one by one */
+#define INTERVAL_POW_MAX_INTS 16
+
+static const double PI = 3.14159265358979323846;
+
+/* Moves 'value' down by 'ulps' units in the last place */
+static double Down(double value, int ulps = 1)
+{
+  for (int i = 0; i < ulps; i++)
+  {
+    value = std::nextafter(value, -HUGE_VAL);
+  }
+  return value;
+}
+
+/* Moves 'value' up by 'ulps' units in the last place */
+static double Up(double value, int ulps = 1)
+{
+  for (int i = 0; i < ulps; i++)
+  {
+    value = std::nextafter(value, HUGE_VAL);
+  }
+  return value;
+}
+
+/* Returns product of bounds, zero times infinity is zero as the infinite bound is never reached */
+static double BoundMul(double left, double right)
+{
+  return left == 0 || right == 0 ? 0 : left * right;
+}
+
+/* Checks if there is point 'shift + period * k' with integer k in [lo, hi] */
+static bool HasPeriodPoint(double lo, double hi, double shift, double period)
+{
+  double first = (lo - shift) / period, last = (hi - shift) / period;
+  first -= INTERVAL_TRIG_EPS * (1 + fabs(first));
+  last += INTERVAL_TRIG_EPS * (1 + fabs(last));
+  return std::floor(last) >= std::ceil(first);
+}
+
+Interval &Interval::operator+=(const Interval &other)
+{
+  return *this = *this + other;
+}
+
+Interval &Interval::operator-=(const Interval &other)
+{
+  return *this = *this - other;
+}
+
+Interval &Interval::operator*=(const Interval &other)
+{
+  return *this = *this * other;
+}
+
+Interval &Interval::operator/=(const Interval &other)
+{
+  return *this = *this / other;
+}
+
+Interval operator+(Interval left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+  return Interval(Down(left.lo + right.lo), Up(left.hi + right.hi));
+}
+
+Interval operator-(Interval left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+  return Interval(Down(left.lo - right.hi), Up(left.hi - right.lo));
+}
+
+Interval operator*(Interval left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+
+  double corners[4] = {BoundMul(left.lo, right.lo), BoundMul(left.lo, right.hi),
+                       BoundMul(left.hi, right.lo), BoundMul(left.hi, right.hi)};
+  return Interval(Down(*std::min_element(corners, corners + 4)), Up(*std::max_element(corners, corners + 4)));
+}
+
+/* Divides 'left' by non-degenerate 'right' with zero at one of the bounds.
+ * Quotient is a half-line as zero bound of divisor is never reached */
+static Interval DivByHalfZero(const Interval &left, const Interval &right)
+{
+  if (left.lo < 0 && left.hi > 0)
+  {
+    return Interval::Entire();
+  }
+
+  bool is_positive = right.lo == 0;  /* divisor is (0, hi] or [lo, 0) */
+  double far = is_positive ? right.hi : right.lo;
+  if (left.lo >= 0)
+  {
+    return is_positive ? Interval(Down(left.lo / far), HUGE_VAL) : Interval(-HUGE_VAL, Up(left.lo / far));
+  }
+  return is_positive ? Interval(-HUGE_VAL, Up(left.hi / far)) : Interval(Down(left.hi / far), HUGE_VAL);
+}
+
+Interval operator/(Interval left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+  if (right.lo == 0 && right.hi == 0)
+  {
+    return Interval::Empty();
+  }
+  if (right.lo < 0 && right.hi > 0)
+  {
+    return Interval::Entire();
+  }
+  if (right.lo == 0 || right.hi == 0)
+  {
+    return DivByHalfZero(left, right);
+  }
+
+  double corners[4] = {left.lo / right.lo, left.lo / right.hi, left.hi / right.lo, left.hi / right.hi};
+  for (double &corner : corners)
+  {
+    if (std::isnan(corner)) /* infinity over infinity, quotients are bounded by zero from that side */
+    {
+      corner = 0;
+    }
+  }
+  return Interval(Down(*std::min_element(corners, corners + 4)), Up(*std::max_element(corners, corners + 4)));
+}
+
+Interval IntervalLiteral(const ExprNode &node)
+{
+  if (!node.is_exact)
+  {
+    return Interval(Down(node.value), Up(node.value));
+  }
+
+  /* fraction is representable if denominator is a power of two and numerator fits mantissa */
+  long long num_abs = node.exact_num < 0 ? -node.exact_num : node.exact_num;
+  if ((node.exact_den & (node.exact_den - 1)) == 0 && num_abs <= (1LL << 53))
+  {
+    return Interval(node.value);
+  }
+  /* value is 'num / den' with both operands and quotient rounded, so it is within 2 ulps */
+  return Interval(Down(node.value, 2), Up(node.value, 2));
+}
+
+Interval IntervalJoin(const Interval &left, const Interval &right)
+{
+  if (left.IsEmpty())
+  {
+    return right;
+  }
+  if (right.IsEmpty())
+  {
+    return left;
+  }
+  return Interval(std::min(left.lo, right.lo), std::max(left.hi, right.hi));
+}
+
+/* Calculates value ^ power for positive integer power */
+static Interval IntPow(const Interval &value, double power)
+{
+  bool is_even = std::fmod(power, 2) == 0;
+  double lo = pow(value.lo, power), hi = pow(value.hi, power);
+
+  if (!is_even || value.lo >= 0)
+  {
+    return Interval(Down(lo, INTERVAL_LIBM_ULPS), Up(hi, INTERVAL_LIBM_ULPS));
+  }
+  if (value.hi <= 0)
+  {
+    return Interval(Down(hi, INTERVAL_LIBM_ULPS), Up(lo, INTERVAL_LIBM_ULPS));
+  }
+  return Interval(0, Up(std::max(lo, hi), INTERVAL_LIBM_ULPS));
+}
+
+/* Calculates value ^ power for non-positive 'value'. Only integer powers of negative numbers are real,
+ * so powers are joined over integers of 'power', or bounded by the largest magnitude if there are many of them */
+static Interval NegativeBasePow(const Interval &value, const Interval &power)
+{
+  double first = std::ceil(power.lo), last = std::floor(power.hi);
+  if (first > last)
+  {
+    return Interval::Empty();
+  }
+
+  if (last - first < INTERVAL_POW_MAX_INTS)
+  {
+    Interval result = Interval::Empty();
+    for (double n = first; n <= last; n++)
+    {
+      Interval term = n == 0 ? Interval(1) : n > 0 ? IntPow(value, n) : Interval(1) / IntPow(value, -n);
+      result = IntervalJoin(result, term);
+    }
+    return result;
+  }
+
+  /* magnitude |value| ^ n is monotone in both |value| and n, signs of odd and even powers differ */
+  double abs_lo = std::fabs(value.hi), abs_hi = std::fabs(value.lo);
+  double magnitude = std::max(std::max(pow(abs_lo, first), pow(abs_lo, last)),
+                              std::max(pow(abs_hi, first), pow(abs_hi, last)));
+  magnitude = Up(magnitude, INTERVAL_LIBM_ULPS);
+  return Interval(-magnitude, magnitude);
+}
+
+Interval IntervalPow(const Interval &left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+
+  if (right.lo == right.hi && std::isfinite(right.lo) && std::floor(right.lo) == right.lo)
+  {
+    if (right.lo == 0)
+    {
+      return Interval(1);
+    }
+    return right.lo > 0 ? IntPow(left, right.lo) : Interval(1) / IntPow(left, -right.lo);
+  }
+
+  Interval result = Interval::Empty();
+  if (left.lo < 0)
+  {
+    result = NegativeBasePow(Interval(left.lo, std::min(left.hi, 0.0)), right);
+  }
+  if (left.hi < 0)
+  {
+    return result;
+  }
+
+  /* logarithm of power is bilinear in exponent and logarithm of base, so extremes are at corners */
+  double base_lo = std::max(left.lo, 0.0);
+  double corners[4] = {pow(base_lo, right.lo), pow(base_lo, right.hi), pow(left.hi, right.lo), pow(left.hi, right.hi)};
+  for (double corner : corners)
+  {
+    if (std::isnan(corner))
+    {
+      return IntervalJoin(result, Interval(0, HUGE_VAL));
+    }
+  }
+  return IntervalJoin(result, Interval(std::max(0.0, Down(*std::min_element(corners, corners + 4), INTERVAL_LIBM_ULPS)),
+                                       Up(*std::max_element(corners, corners + 4), INTERVAL_LIBM_ULPS)));
+}
+
+/* Calculates sin(value) if 'shift' is 0 or cos(value) = sin(value + PI / 2) if 'shift' is PI / 2 */
+static Interval SinShifted(const Interval &value, double shift)
+{
+  if (!(value.hi - value.lo < 2 * PI) || std::max(fabs(value.lo), fabs(value.hi)) > INTERVAL_TRIG_MAX)
+  {
+    return Interval(-1, 1);
+  }
+
+  double at_lo = shift == 0 ? std::sin(value.lo) : std::cos(value.lo);
+  double at_hi = shift == 0 ? std::sin(value.hi) : std::cos(value.hi);
+  Interval result(std::max(-1.0, Down(std::min(at_lo, at_hi), INTERVAL_LIBM_ULPS)),
+                  std::min(1.0, Up(std::max(at_lo, at_hi), INTERVAL_LIBM_ULPS)));
+
+  if (HasPeriodPoint(value.lo, value.hi, PI / 2 - shift, 2 * PI))
+  {
+    result.hi = 1;
+  }
+  if (HasPeriodPoint(value.lo, value.hi, -PI / 2 - shift, 2 * PI))
+  {
+    result.lo = -1;
+  }
+  return result;
+}
+
+/* Calculates tan(value) or cot(value). Both are monotone between poles, cot is a half-line when its pole 0 is a bound */
+static Interval TanCot(const Interval &value, bool is_cot)
+{
+  double pole = is_cot ? 0 : PI / 2;
+  if (is_cot && value.lo == 0 && value.hi > 0 && value.hi < PI && !HasPeriodPoint(PI / 2, value.hi, 0, PI))
+  {
+    return Interval(Down(1 / std::tan(value.hi), INTERVAL_LIBM_ULPS + 1), HUGE_VAL);
+  }
+  if (is_cot && value.hi == 0 && value.lo < 0 && value.lo > -PI && !HasPeriodPoint(value.lo, -PI / 2, 0, PI))
+  {
+    return Interval(-HUGE_VAL, Up(1 / std::tan(value.lo), INTERVAL_LIBM_ULPS + 1));
+  }
+  if (!(value.hi - value.lo < PI) || std::max(fabs(value.lo), fabs(value.hi)) > INTERVAL_TRIG_MAX ||
+      HasPeriodPoint(value.lo, value.hi, pole, PI))
+  {
+    return Interval::Entire();
+  }
+
+  if (is_cot)
+  {
+    return Interval(Down(1 / std::tan(value.hi), INTERVAL_LIBM_ULPS + 1),
+                    Up(1 / std::tan(value.lo), INTERVAL_LIBM_ULPS + 1));
+  }
+  return Interval(Down(std::tan(value.lo), INTERVAL_LIBM_ULPS), Up(std::tan(value.hi), INTERVAL_LIBM_ULPS));
+}
+
+Interval IntervalOpId(ID_TYPE idType, const Interval &value)
+{
+  PROFILE_COUNT(op_calls[idType], 1)
+
+  if (value.IsEmpty())
+  {
+    return value;
+  }
+
+  switch (idType)
+  {
+    case ID_SIN : return SinShifted(value, 0);
+    case ID_COS : return SinShifted(value, PI / 2);
+    case ID_TAN : return TanCot(value, false);
+    case ID_COT : return TanCot(value, true);
+    case ID_SQRT:
+      if (value.hi < 0)
+      {
+        return Interval::Empty();
+      }
+      return Interval(value.lo > 0 ? Down(std::sqrt(value.lo)) : 0, Up(std::sqrt(value.hi)));
+    case ID_LN  :
+      if (value.hi < 0)
+      {
+        return Interval::Empty();
+      }
+      return Interval(value.lo > 0 ? Down(std::log(value.lo), INTERVAL_LIBM_ULPS) : -HUGE_VAL,
+                      Up(std::log(value.hi), INTERVAL_LIBM_ULPS));
+    case ID_NORM:
+      if (value.lo >= 0)
+      {
+        return value;
+      }
+      if (value.hi <= 0)
+      {
+        return Interval(-value.hi, -value.lo);
+      }
+      return Interval(0, std::max(-value.lo, value.hi));
+    case NOT_ID : //fallthrough;
+    default     : return Interval(0);
+  }
+}
+
+Interval IntervalOpId(ID_TYPE idType, const Interval &left, const Interval &right)
+{
+  PROFILE_COUNT(op_calls[idType], 1)
+
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+
+  switch (idType)
+  {
+    case ID_DOT   : //fallthrough;
+    case ID_MATMUL: return left * right;
+    case ID_MIN   : return Interval(std::min(left.lo, right.lo), std::min(left.hi, right.hi));
+    case ID_MAX   : return Interval(std::max(left.lo, right.lo), std::max(left.hi, right.hi));
+    default       : return Interval(0);
+  }
+}
+
+Interval IntervalCompare(NODE_TYPE type, const Interval &left, const Interval &right)
+{
+  if (left.IsEmpty() || right.IsEmpty())
+  {
+    return Interval::Empty();
+  }
+
+  /* comparison is decided if it has the same result for all pairs of points */
+  switch (type)
+  {
+    case NODE_LT: //fallthrough;
+    case NODE_LE:
+      if (ExprTree::Compare(type, left.hi, right.lo) != 0) { return Interval(1); }
+      if (ExprTree::Compare(type, left.lo, right.hi) == 0) { return Interval(0); }
+      break;
+    case NODE_GT: //fallthrough;
+    case NODE_GE:
+      if (ExprTree::Compare(type, left.lo, right.hi) != 0) { return Interval(1); }
+      if (ExprTree::Compare(type, left.hi, right.lo) == 0) { return Interval(0); }
+      break;
+    case NODE_EQ: //fallthrough;
+    case NODE_NE:
+      if (left.lo == left.hi && right.lo == right.hi) { return Interval(ExprTree::Compare(type, left.lo, right.lo)); }
+      if (left.hi < right.lo || right.hi < left.lo)   { return Interval(type == NODE_NE ? 1 : 0); }
+      break;
+    default     : return Interval(0);
+  }
+  return Interval(0, 1);
+}
+
+ERR_CODE EvalIntervalBox(const ExprTree &tree, const Interval *box, Interval &result, size_t boxes, unsigned threads)
+{
+  if (tree.has_imag)
+  {
+    return ERR_WRONG_INPUT;
+  }
+
+  /* bisect the variable with the widest finite piece until number of boxes is reached */
+  size_t vars = tree.var_names.size(), count = 1;
+  std::vector<size_t> pieces(vars, 1);
+  while (count * 2 <= boxes)
+  {
+    size_t widest = vars;
+    double widest_width = 0;
+    for (size_t var = 0; var < vars; var++)
+    {
+      double width = (box[var].hi - box[var].lo) / pieces[var];
+      if (std::isfinite(width) && width > widest_width)
+      {
+        widest = var;
+        widest_width = width;
+      }
+    }
+    if (widest == vars)
+    {
+      break;
+    }
+    pieces[widest] *= 2;
+    count *= 2;
+  }
+
+  unsigned parts = (unsigned)std::min((size_t)ThreadCount(threads), count);
+  std::vector<Interval> hulls(parts, Interval::Empty());
+
+  RunParallel(parts, [&](unsigned part)
+  {
+    std::vector<Interval> sub_box(box, box + vars);
+    for (size_t sub = part; sub < count; sub += parts)
+    {
+      size_t rest = sub;
+      for (size_t var = 0; var < vars; var++)
+      {
+        size_t piece = rest % pieces[var], n = pieces[var];
+        rest /= n;
+        if (n == 1)
+        {
+          continue;
+        }
+
+        double lo = box[var].lo, width = box[var].hi - box[var].lo;
+        sub_box[var].lo = piece == 0 ? lo : lo + width * piece / n;
+        sub_box[var].hi = piece + 1 == n ? box[var].hi : lo + width * (piece + 1) / n;
+      }
+      hulls[part] = IntervalJoin(hulls[part], Evaluator<Interval>::Eval(tree, sub_box.data()));
+    }
+  });
+
+  result = Interval::Empty();
+  for (const Interval &hull : hulls)
+  {
+    result = IntervalJoin(result, hull);
+  }
+  return SUCCESS;
+}
@@ -0,0 +1,106 @@
+#ifndef CALCULATOR_INTERVAL_H
+#define CALCULATOR_INTERVAL_H
+
+#include <cmath>
+#include <limits>
+
+#include "error_functions.h"
+#include "expr_tree.h"
+
+/* Number of units in the last place standard library functions are assumed to be wrong by */
+#define INTERVAL_LIBM_ULPS 2
+
+/***
+ * Closed interval of real numbers [lo, hi] for calculation of guaranteed bounds.
+ *
+ * Every operation returns interval containing results of the operation for all points of operand intervals.
+ * Results are rounded outwards: bounds calculated in round-to-nearest mode are moved by one unit
+ * in the last place (INTERVAL_LIBM_ULPS for standard library functions) away from the interval center,
+ * so no rounding mode switching is needed. Points where operation is undefined (square root and
+ * logarithm of negative numbers) are excluded, interval with no defined points is empty and has NaN bounds.
+ */
+struct Interval
+{
+  double lo = 0;
+  double hi = 0;
+
+  /* Class constructors */
+  Interval() = default;
+
+  Interval(double value) : lo(value), hi(value)
+  {
+  }
+
+  Interval(double init_lo, double init_hi) : lo(init_lo), hi(init_hi)
+  {
+  }
+
+  /* Returns interval with no points */
+  static Interval Empty()
+  {
+    return Interval(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+  }
+
+  /* Returns interval of all real numbers */
+  static Interval Entire()
+  {
+    return Interval(-HUGE_VAL, HUGE_VAL);
+  }
+
+  /* Checks if interval has no points */
+  bool IsEmpty() const
+  {
+    return std::isnan(lo) || std::isnan(hi);
+  }
+
+  /* Checks if 'value' belongs to interval */
+  bool Contains(double value) const
+  {
+    return lo <= value && value <= hi;
+  }
+
+  Interval &operator+=(const Interval &other);
+  Interval &operator-=(const Interval &other);
+  Interval &operator*=(const Interval &other);
+  Interval &operator/=(const Interval &other);
+};
+
+Interval operator+(Interval left, const Interval &right);
+Interval operator-(Interval left, const Interval &right);
+Interval operator*(Interval left, const Interval &right);
+Interval operator/(Interval left, const Interval &right);
+
+/* Returns interval containing value of NODE_NUM node. It is a point only if literal is exactly representable */
+Interval IntervalLiteral(const ExprNode &node);
+
+/* Returns the smallest interval containing both intervals. Empty intervals are ignored */
+Interval IntervalJoin(const Interval &left, const Interval &right);
+
+/* Calculates left ^ right. Non-integer powers are defined for non-negative bases only */
+Interval IntervalPow(const Interval &left, const Interval &right);
+
+/* Calculates identifier operation */
+Interval IntervalOpId(ID_TYPE idType, const Interval &value);
+
+/* Calculates two-argument identifier operation */
+Interval IntervalOpId(ID_TYPE idType, const Interval &left, const Interval &right);
+
+/* Calculates comparison: [1, 1] if it is true for all points, [0, 0] if it is false for all points, [0, 1] otherwise */
+Interval IntervalCompare(NODE_TYPE type, const Interval &left, const Interval &right);
+
+/***
+ * Calculates bounds of real expression over box of variable intervals.
+ *
+ * Box is bisected along the widest variables into at most 'boxes' equal sub-boxes (power of two),
+ * which are calculated by 'threads' threads. Result is the join of sub-box results, it is tighter
+ * than result for the whole box, as every variable is repeated in expression over smaller interval.
+ *
+ * @param box - intervals of variables in order of 'tree.var_names'
+ * @param threads - number of threads, 0 uses all hardware threads
+ *
+ * @return error code. ERR_WRONG_INPUT if expression contains imaginary unit.
+ */
+ERR_CODE EvalIntervalBox(const ExprTree &tree, const Interval *box, Interval &result, size_t boxes = 1,
+                         unsigned threads = 0);
+
+#endif //CALCULATOR_INTERVAL_H
@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "matrix.h"
+
+/* Header of binary matrix file */
+struct MatrixFileHeader
+{
+  char signature[sizeof(MATRIX_FILE_SIGNATURE)];
+  uint64_t rows;
+  uint64_t cols;
+};
+
+/* Reads matrix from binary file */
+ERR_CODE LoadMatrix(const char *file_name, Matrix &matrix)
+{
+  FILE *file = fopen(file_name, "rb");
+  if (file == nullptr)
+  {
+    return ERR_FILE_OPEN;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  MatrixFileHeader header = {};
+  size_t data_offset = 0;
+  size_t header_read = fread(&header, 1, sizeof(header), file);
+
+  if (header_read == sizeof(header) && memcmp(header.signature, MATRIX_FILE_SIGNATURE, sizeof(header.signature)) == 0)
+  {
+    matrix.rows = header.rows;
+    matrix.cols = header.cols;
+    data_offset = sizeof(header);
+  }
+  else /* raw column vector */
+  {
+    matrix.rows = file_size / sizeof(double);
+    matrix.cols = 1;
+  }
+
+  /* element number is checked by division first, so huge header dimensions can not overflow */
+  size_t max_size = file_size > 0 ? (size_t)file_size / sizeof(double) : 0;
+  if (matrix.rows == 0 || matrix.cols == 0 || matrix.cols > max_size / matrix.rows ||
+      data_offset + matrix.Size() * sizeof(double) > (size_t)file_size)
+  {
+    fclose(file);
+    return ERR_UNEXP_EOF;
+  }
+
+  matrix.data.resize(matrix.Size());
+  fseek(file, (long)data_offset, SEEK_SET);
+  size_t read = fread(matrix.data.data(), sizeof(double), matrix.Size(), file);
+  fclose(file);
+
+  return read == matrix.Size() ? SUCCESS : ERR_FILE_OPERATE;
+}
+
+/* Writes matrix to binary file */
+ERR_CODE SaveMatrix(const char *file_name, const Matrix &matrix)
+{
+  FILE *file = fopen(file_name, "wb");
+  if (file == nullptr)
+  {
+    return ERR_FILE_OPEN;
+  }
+
+  MatrixFileHeader header = {};
+  memcpy(header.signature, MATRIX_FILE_SIGNATURE, sizeof(header.signature));
+  header.rows = matrix.rows;
+  header.cols = matrix.cols;
+
+  bool is_written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    fwrite(matrix.data.data(), sizeof(double), matrix.Size(), file) == matrix.Size();
+  fclose(file);
+
+  return is_written ? SUCCESS : ERR_FILE_OPERATE;
+}
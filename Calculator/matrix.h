@@ -0,0 +1,55 @@
+#ifndef CALCULATOR_MATRIX_H
+#define CALCULATOR_MATRIX_H
+
+#include <vector>
+
+#include "error_functions.h"
+
+/* Signature of binary matrix file */
+#define MATRIX_FILE_SIGNATURE "CALCMAT"
+
+/* Dense row-major matrix. Vectors are matrices with one column, scalars are 1 x 1 matrices */
+struct Matrix
+{
+  size_t rows = 1;
+  size_t cols = 1;
+  std::vector<double> data = std::vector<double>(1, 0.0);
+
+  /* Class constructors */
+  Matrix() = default;
+
+  Matrix(size_t init_rows, size_t init_cols, double value = 0) :
+    rows(init_rows), cols(init_cols), data(init_rows * init_cols, value)
+  {
+  }
+
+  /* Returns number of elements */
+  size_t Size() const
+  {
+    return rows * cols;
+  }
+
+  /* Checks if matrix is 1 x 1 */
+  bool IsScalar() const
+  {
+    return rows == 1 && cols == 1;
+  }
+};
+
+/***
+ * Reads matrix from binary file. File consists of 'MATRIX_FILE_SIGNATURE' with terminating zero,
+ * 64-bit row and column numbers and 'rows * cols' doubles row by row.
+ * File without signature is read as column vector of raw doubles.
+ *
+ * @return error code. It can occur because of problems with opening/reading file.
+ */
+ERR_CODE LoadMatrix(const char *file_name, Matrix &matrix);
+
+/***
+ * Writes matrix to binary file in format of 'LoadMatrix'
+ *
+ * @return error code. It can occur because of problems with opening/writing file.
+ */
+ERR_CODE SaveMatrix(const char *file_name, const Matrix &matrix);
+
+#endif //CALCULATOR_MATRIX_H
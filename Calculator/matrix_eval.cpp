@@ -0,0 +1,300 @@
+#include <deque>
+#include <string>
+
+#include "matrix_eval.h"
+#include "batch_eval.h"
+#include "evaluator.h"
+#include "grammar_profile.h"
+#include "matrix_kernels.h"
+
+/* Elementwise subexpression extracted into separate tree for batch evaluation */
+struct ElementwiseTask
+{
+  ExprTree tree;                      /* Extracted subexpression, scalar operands are replaced with literals */
+  std::vector<const Matrix *> inputs; /* Values of extracted tree variables */
+  std::deque<Matrix> computed;        /* Results of non-elementwise subexpressions used as inputs */
+  bool has_shape = false;             /* 'true' if any input is not scalar */
+  size_t rows = 1;                    /* Shape of non-scalar inputs */
+  size_t cols = 1;
+};
+
+static ERR_CODE EvalNode(const ExprTree &tree, size_t idx, const Matrix *const *var_values, Matrix &result);
+
+/* Returns index of NODE_VAR, NODE_POLY or NODE_LOCAL value in 'var_values'.
+ * Values of 'let' bindings follow values of variables */
+static size_t ValueIndex(const ExprTree &tree, const ExprNode &node)
+{
+  return node.type == NODE_LOCAL ? tree.var_names.size() + node.var : node.var;
+}
+
+/* Checks if node is calculated independently for every element */
+static bool IsElementwise(const ExprNode &node)
+{
+  return node.type != NODE_FUNC || (ExprTree::IdArity(node.id) == 1 && node.id != ID_NORM) ||
+         node.id == ID_MIN || node.id == ID_MAX;
+}
+
+/* Registers non-scalar input of elementwise task and returns its variable index in extracted tree */
+static ERR_CODE AddInput(ElementwiseTask &task, const std::string &name, const Matrix &value, size_t &var)
+{
+  if (task.has_shape && (task.rows != value.rows || task.cols != value.cols))
+  {
+    return ERR_WRONG_INPUT;
+  }
+  task.has_shape = true;
+  task.rows = value.rows;
+  task.cols = value.cols;
+
+  var = task.tree.VarIndex(name);
+  if (var == task.tree.var_names.size())
+  {
+    task.tree.var_names.push_back(name);
+    task.inputs.push_back(&value);
+  }
+  return SUCCESS;
+}
+
+/* Copies elementwise subtree with root 'idx' into 'task.tree'. Index of copied root is written to 'copy_idx' */
+static ERR_CODE Extract(const ExprTree &tree, size_t idx, const Matrix *const *var_values, ElementwiseTask &task,
+                        size_t &copy_idx)
+{
+  const ExprNode &node = tree.nodes[idx];
+  ERR_CODE code = SUCCESS;
+
+  if (!IsElementwise(node))
+  {
+    if (tree.HasIndex(idx)) /* matrix operation in reduction body is calculated once, not for every index */
+    {
+      return ERR_WRONG_INPUT;
+    }
+
+    task.computed.emplace_back();
+    if ((code = EvalNode(tree, idx, var_values, task.computed.back())) != SUCCESS)
+    {
+      return code;
+    }
+
+    const Matrix &value = task.computed.back();
+    if (value.IsScalar())
+    {
+      copy_idx = task.tree.AddNum(value.data[0]);
+      return SUCCESS;
+    }
+
+    size_t var = 0;
+    if ((code = AddInput(task, "#" + std::to_string(task.computed.size()), value, var)) != SUCCESS)
+    {
+      return code;
+    }
+    copy_idx = task.tree.AddVar(task.tree.var_names[var]);
+    return SUCCESS;
+  }
+
+  switch (node.type)
+  {
+    case NODE_NUM : copy_idx = task.tree.AddNum(node.value); return SUCCESS;
+    case NODE_IMAG: return ERR_WRONG_INPUT;
+    case NODE_VAR :
+    case NODE_LOCAL:
+    case NODE_POLY:
+    {
+      const Matrix &value = *var_values[ValueIndex(tree, node)];
+      if (value.IsScalar())
+      {
+        double scalar = value.data[0];
+        copy_idx = task.tree.AddNum(node.type != NODE_POLY ? scalar :
+                                    Evaluator<double>::CalcPoly(&tree.coeffs[node.left], node.right, scalar));
+        return SUCCESS;
+      }
+
+      std::string name = node.type == NODE_LOCAL ? "$" + std::to_string(node.var) : tree.var_names[node.var];
+      size_t var = 0;
+      if ((code = AddInput(task, name, value, var)) != SUCCESS)
+      {
+        return code;
+      }
+      copy_idx = task.tree.AddVar(task.tree.var_names[var]);
+
+      if (node.type == NODE_POLY)
+      {
+        ExprNode &copy = task.tree.nodes[copy_idx];
+        copy.type = NODE_POLY;
+        copy.left = task.tree.coeffs.size();
+        copy.right = node.right;
+        task.tree.coeffs.insert(task.tree.coeffs.end(), &tree.coeffs[node.left], &tree.coeffs[node.left] + node.right + 1);
+      }
+      return SUCCESS;
+    }
+    case NODE_FUNC:
+    {
+      size_t arg = 0, second = 0;
+      if ((code = Extract(tree, node.left, var_values, task, arg)) != SUCCESS)
+      {
+        return code;
+      }
+      if (ExprTree::IdArity(node.id) == 2)
+      {
+        if ((code = Extract(tree, node.right, var_values, task, second)) != SUCCESS)
+        {
+          return code;
+        }
+        copy_idx = task.tree.AddFunc(node.id, arg, second);
+        return SUCCESS;
+      }
+      copy_idx = task.tree.AddFunc(node.id, arg);
+      return SUCCESS;
+    }
+    case NODE_SELECT:
+    {
+      size_t cond = 0, left = 0, right = 0;
+      if ((code = Extract(tree, node.cond, var_values, task, cond)) != SUCCESS ||
+          (code = Extract(tree, node.left, var_values, task, left)) != SUCCESS ||
+          (code = Extract(tree, node.right, var_values, task, right)) != SUCCESS)
+      {
+        return code;
+      }
+      copy_idx = task.tree.AddSelect(cond, left, right);
+      return SUCCESS;
+    }
+    case NODE_INDEX: copy_idx = task.tree.AddIndex(node.var); return SUCCESS;
+    case NODE_SUM: //fallthrough
+    case NODE_PROD:
+    {
+      size_t body = 0, first = 0, last = 0;
+      if ((code = Extract(tree, node.cond, var_values, task, body)) != SUCCESS ||
+          (code = Extract(tree, node.left, var_values, task, first)) != SUCCESS ||
+          (code = Extract(tree, node.right, var_values, task, last)) != SUCCESS)
+      {
+        return code;
+      }
+      copy_idx = task.tree.AddReduce(node.type, node.var, first, last, body);
+      task.tree.index_count = tree.index_count;
+      return SUCCESS;
+    }
+    default:
+    {
+      size_t left = 0, right = 0;
+      if ((code = Extract(tree, node.left, var_values, task, left)) != SUCCESS ||
+          (code = Extract(tree, node.right, var_values, task, right)) != SUCCESS)
+      {
+        return code;
+      }
+      copy_idx = task.tree.AddOp(node.type, left, right);
+      return SUCCESS;
+    }
+  }
+}
+
+/* Calculates 'norm', 'dot' or 'matmul' */
+static ERR_CODE CalcMatrixOpId(ID_TYPE idType, const Matrix &left, const Matrix &right, Matrix &result)
+{
+  PROFILE_COUNT(op_calls[idType], 1)
+
+  switch (idType)
+  {
+    case ID_NORM:
+      result = Matrix(1, 1, MatNorm(left.data.data(), left.Size()));
+      return SUCCESS;
+
+    case ID_DOT:
+      if (left.rows != right.rows || left.cols != right.cols)
+      {
+        return ERR_WRONG_INPUT;
+      }
+      result = Matrix(1, 1, MatDot(left.data.data(), right.data.data(), left.Size()));
+      return SUCCESS;
+
+    case ID_MATMUL:
+      if (left.cols != right.rows)
+      {
+        return ERR_WRONG_INPUT;
+      }
+      result = Matrix(left.rows, right.cols);
+      MatMul(left.data.data(), right.data.data(), result.data.data(), left.rows, left.cols, right.cols);
+      return SUCCESS;
+
+    default:
+      return ERR_FUNC_IMPL;
+  }
+}
+
+/* Evaluates operand of 'norm', 'dot' or 'matmul'. Variables and bindings are used in place, other values are stored in 'storage' */
+static ERR_CODE EvalOperand(const ExprTree &tree, size_t idx, const Matrix *const *var_values, Matrix &storage,
+                           const Matrix *&value)
+{
+  const ExprNode &node = tree.nodes[idx];
+  if (node.type == NODE_VAR || node.type == NODE_LOCAL)
+  {
+    value = var_values[ValueIndex(tree, node)];
+    return SUCCESS;
+  }
+
+  value = &storage;
+  return EvalNode(tree, idx, var_values, storage);
+}
+
+/* Evaluates subtree with root 'idx' */
+static ERR_CODE EvalNode(const ExprTree &tree, size_t idx, const Matrix *const *var_values, Matrix &result)
+{
+  const ExprNode &node = tree.nodes[idx];
+  ERR_CODE code = SUCCESS;
+
+  if (!IsElementwise(node))
+  {
+    Matrix left_storage, right_storage;
+    const Matrix *left = &left_storage, *right = &right_storage;
+
+    if ((code = EvalOperand(tree, node.left, var_values, left_storage, left)) != SUCCESS)
+    {
+      return code;
+    }
+    if (ExprTree::IdArity(node.id) == 2 &&
+        (code = EvalOperand(tree, node.right, var_values, right_storage, right)) != SUCCESS)
+    {
+      return code;
+    }
+    return CalcMatrixOpId(node.id, *left, *right, result);
+  }
+
+  ElementwiseTask task;
+  if ((code = Extract(tree, idx, var_values, task, task.tree.root)) != SUCCESS)
+  {
+    return code;
+  }
+
+  std::vector<const double *> columns;
+  for (const Matrix *input : task.inputs)
+  {
+    columns.push_back(input->data.data());
+  }
+
+  result = Matrix(task.rows, task.cols);
+  BatchEvaluator<double>(task.tree).Eval(columns.data(), result.Size(), result.data.data());
+  return SUCCESS;
+}
+
+/* Evaluates real expression whose variables are vectors and matrices */
+ERR_CODE EvalMatrixExpr(const ExprTree &tree, const Matrix *const *var_values, Matrix &result)
+{
+  if (tree.nodes.empty())
+  {
+    result = Matrix();
+    return SUCCESS;
+  }
+
+  /* Bindings are calculated in order of statements and appended to variable values */
+  std::vector<const Matrix *> values(var_values, var_values + tree.var_names.size());
+  std::deque<Matrix> locals;
+  ERR_CODE code = SUCCESS;
+
+  for (size_t let_root : tree.let_roots)
+  {
+    locals.emplace_back();
+    if ((code = EvalNode(tree, let_root, values.data(), locals.back())) != SUCCESS)
+    {
+      return code;
+    }
+    values.push_back(&locals.back());
+  }
+  return EvalNode(tree, tree.root, values.data(), result);
+}
@@ -0,0 +1,22 @@
+#ifndef CALCULATOR_MATRIX_EVAL_H
+#define CALCULATOR_MATRIX_EVAL_H
+
+#include "error_functions.h"
+#include "expr_tree.h"
+#include "matrix.h"
+
+/***
+ * Evaluates real expression whose variables are vectors and matrices.
+ *
+ * Arithmetic operations, comparisons, 'select', 'min', 'max' and one-argument identifiers except 'norm'
+ * are elementwise, scalar operands are broadcast. 'norm', 'dot' and 'matmul' are calculated by 'matrix_kernels.h'.
+ * Maximal elementwise subexpressions are evaluated by 'BatchEvaluator' block by block,
+ * so their temporaries stay in L1 cache instead of being whole-array passes.
+ *
+ * @param var_values - pointers to values of variables in order of 'tree.var_names'
+ *
+ * @return error code. ERR_WRONG_INPUT if operand shapes do not match or expression contains imaginary unit.
+ */
+ERR_CODE EvalMatrixExpr(const ExprTree &tree, const Matrix *const *var_values, Matrix &result);
+
+#endif //CALCULATOR_MATRIX_EVAL_H
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+
+#include "matrix_kernels.h"
+
+/* Number of independent partial sums of reductions */
+#define REDUCE_LANES 8
+
+/* Greater maximal elements make squares overflow and norm is calculated with scaling */
+#define NORM_MAX_UNSCALED 1e150
+
+/* Tile sizes of matrix product. Tile of 'b' (MATMUL_TILE_INNER x MATMUL_TILE_COLS doubles) takes 16 KB */
+#define MATMUL_TILE_INNER 32
+#define MATMUL_TILE_COLS  64
+
+/* Number of rows of 'a' processed together, every loaded row of 'b' tile is reused for all of them */
+#define MATMUL_ROWS 4
+
+/* Returns sum of a[i] * b[i] */
+double MatDot(const double *a, const double *b, size_t count)
+{
+  double partial[REDUCE_LANES] = {};
+  size_t body = count - count % REDUCE_LANES;
+
+  for (size_t i = 0; i < body; i += REDUCE_LANES)
+  {
+    for (size_t lane = 0; lane < REDUCE_LANES; lane++)
+    {
+      partial[lane] += a[i + lane] * b[i + lane];
+    }
+  }
+
+  double result = 0;
+  for (size_t i = body; i < count; i++)
+  {
+    result += a[i] * b[i];
+  }
+  for (double sum : partial)
+  {
+    result += sum;
+  }
+  return result;
+}
+
+/* Returns Euclidean norm. Elements are scaled by maximal absolute value if squares may overflow or underflow */
+double MatNorm(const double *a, size_t count)
+{
+  double partial[REDUCE_LANES] = {};
+  size_t body = count - count % REDUCE_LANES;
+
+  for (size_t i = 0; i < body; i += REDUCE_LANES)
+  {
+    for (size_t lane = 0; lane < REDUCE_LANES; lane++)
+    {
+      partial[lane] = std::max(partial[lane], fabs(a[i + lane]));
+    }
+  }
+
+  double max_abs = 0;
+  for (size_t i = body; i < count; i++)
+  {
+    max_abs = std::max(max_abs, fabs(a[i]));
+  }
+  for (double value : partial)
+  {
+    max_abs = std::max(max_abs, value);
+  }
+
+  if (max_abs == 0)
+  {
+    return 0;
+  }
+  if (!std::isfinite(max_abs) || (max_abs < NORM_MAX_UNSCALED && max_abs > 1.0 / NORM_MAX_UNSCALED))
+  {
+    return sqrt(MatDot(a, a, count));
+  }
+
+  double scale = 1.0 / max_abs, sum = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    sum += (a[i] * scale) * (a[i] * scale);
+  }
+  return max_abs * sqrt(sum);
+}
+
+/* Adds product of 'row_count' rows of 'a' by tile of 'b' to corresponding rows of 'c'.
+ * Tile covers rows [k_start, k_end) and columns [j_start, j_end) of 'b' */
+static void MatMulTile(const double *__restrict a, const double *__restrict b, double *__restrict c,
+                       size_t inner, size_t cols, size_t row_count,
+                       size_t k_start, size_t k_end, size_t j_start, size_t j_end)
+{
+  for (size_t k = k_start; k < k_end; k++)
+  {
+    const double *b_row = b + k * cols;
+
+    if (row_count == MATMUL_ROWS)
+    {
+      double a0 = a[k], a1 = a[inner + k], a2 = a[2 * inner + k], a3 = a[3 * inner + k];
+      double *c0 = c, *c1 = c + cols, *c2 = c + 2 * cols, *c3 = c + 3 * cols;
+
+      for (size_t j = j_start; j < j_end; j++)
+      {
+        double b_value = b_row[j];
+        c0[j] += a0 * b_value;
+        c1[j] += a1 * b_value;
+        c2[j] += a2 * b_value;
+        c3[j] += a3 * b_value;
+      }
+    }
+    else
+    {
+      for (size_t r = 0; r < row_count; r++)
+      {
+        double a_value = a[r * inner + k];
+        double *c_row = c + r * cols;
+
+        for (size_t j = j_start; j < j_end; j++)
+        {
+          c_row[j] += a_value * b_row[j];
+        }
+      }
+    }
+  }
+}
+
+/* c = a * b. Loops are tiled by inner dimension and columns of 'b' so that tile of 'b' stays in L1 cache
+ * while all rows of 'a' pass over it */
+void MatMul(const double *a, const double *b, double *c, size_t rows, size_t inner, size_t cols)
+{
+  std::fill(c, c + rows * cols, 0.0);
+
+  for (size_t k_start = 0; k_start < inner; k_start += MATMUL_TILE_INNER)
+  {
+    size_t k_end = std::min(inner, k_start + MATMUL_TILE_INNER);
+
+    for (size_t j_start = 0; j_start < cols; j_start += MATMUL_TILE_COLS)
+    {
+      size_t j_end = std::min(cols, j_start + MATMUL_TILE_COLS);
+
+      for (size_t i = 0; i < rows; i += MATMUL_ROWS)
+      {
+        size_t row_count = std::min((size_t)MATMUL_ROWS, rows - i);
+        MatMulTile(a + i * inner, b, c + i * cols, inner, cols, row_count, k_start, k_end, j_start, j_end);
+      }
+    }
+  }
+}
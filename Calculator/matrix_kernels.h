@@ -0,0 +1,19 @@
+#ifndef CALCULATOR_MATRIX_KERNELS_H
+#define CALCULATOR_MATRIX_KERNELS_H
+
+#include <cstddef>
+
+/***
+ * Dense linear algebra kernels over row-major 'double' arrays.
+ *
+ * Reductions keep several independent partial sums, so compiler vectorizes them without reassociation flags.
+ * Matrix product is split into tiles which fit into L1 cache.
+ */
+
+double MatDot(const double *a, const double *b, size_t count); /* Returns sum of a[i] * b[i] */
+double MatNorm(const double *a, size_t count);                 /* Returns Euclidean norm, does not overflow for huge elements */
+
+/* c = a * b, 'a' is 'rows x inner', 'b' is 'inner x cols', 'c' is 'rows x cols' and must not overlap 'a' and 'b' */
+void MatMul(const double *a, const double *b, double *c, size_t rows, size_t inner, size_t cols);
+
+#endif //CALCULATOR_MATRIX_KERNELS_H
@@ -0,0 +1,34 @@
+#ifndef CALCULATOR_PARALLEL_H
+#define CALCULATOR_PARALLEL_H
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+/* Returns number of threads to use, 0 means all hardware threads */
+inline unsigned ThreadCount(unsigned threads)
+{
+  if (threads == 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+  return threads == 0 ? 1 : threads;
+}
+
+/* Calls 'body(part)' for every part in [0, parts) in separate threads */
+inline void RunParallel(unsigned parts, const std::function<void(unsigned)> &body)
+{
+  std::vector<std::thread> workers;
+  for (unsigned part = 1; part < parts; part++)
+  {
+    workers.emplace_back(body, part);
+  }
+  body(0);
+
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+}
+
+#endif //CALCULATOR_PARALLEL_H
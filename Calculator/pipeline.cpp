@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "pipeline.h"
+#include "bounded_queue.h"
+#include "evaluator.h"
+#include "grammar.h"
+
+/* Number of bytes read from input at once */
+#define PIPELINE_READ_CHUNK (1 << 16)
+
+/* Number of queue capacities reader may run ahead of writer */
+#define PIPELINE_WINDOW 4
+
+typedef std::chrono::steady_clock Clock;
+
+/* Lines handed between stages together with their results */
+struct LineBatch
+{
+  size_t seq = 0;                 /* Batch number in input order */
+  size_t first_line = 0;          /* Input line number of the first line, from 1 */
+  std::string text;               /* Lines, every line ends with '\n' */
+  std::vector<size_t> starts;     /* Offset of every line in 'text' */
+  std::vector<ExprTree> trees;    /* Compiled lines */
+  std::vector<ParseError> errors; /* Error of every line */
+  std::string output;             /* Results, one line per input line */
+  std::string failed;             /* Records of failed lines for side file */
+};
+
+typedef std::unique_ptr<LineBatch> BatchPtr;
+
+/* Queue between stages. Consumers stop when all producers are done and queue is drained */
+struct Channel
+{
+  BoundedQueue<BatchPtr> queue;
+  std::atomic<unsigned> producers; /* Number of running producer threads */
+
+  Channel(size_t capacity, unsigned producer_count) : queue(capacity), producers(producer_count)
+  {
+  }
+};
+
+/* Statistics of one stage thread */
+struct WorkerStats
+{
+  size_t batches = 0;
+  size_t lines = 0;
+  Clock::duration busy{};
+  Clock::duration wait_in{};
+  Clock::duration wait_out{};
+  size_t takes = 0;     /* Number of input queue depth samples */
+  size_t depth_sum = 0;
+  size_t max_depth = 0;
+  size_t max_pending = 0; /* Maximal size of reorder buffer */
+};
+
+/* Takes batch from channel, waiting for it. Returns 'false' when channel is closed and drained */
+static bool Take(Channel &channel, BatchPtr &batch, WorkerStats &stats)
+{
+  size_t depth = channel.queue.Size();
+  stats.takes++;
+  stats.depth_sum += depth;
+  stats.max_depth = std::max(stats.max_depth, depth);
+
+  auto start = Clock::now();
+  bool is_taken = false;
+  while (!(is_taken = channel.queue.TryPop(batch)))
+  {
+    if (channel.producers.load(std::memory_order_acquire) == 0)
+    {
+      is_taken = channel.queue.TryPop(batch); /* last producer may have pushed just before finishing */
+      break;
+    }
+    std::this_thread::yield();
+  }
+
+  stats.wait_in += Clock::now() - start;
+  return is_taken;
+}
+
+/* Puts batch to channel, waiting for room in it */
+static void Put(Channel &channel, BatchPtr &batch, WorkerStats &stats)
+{
+  auto start = Clock::now();
+  while (!channel.queue.TryPush(batch))
+  {
+    std::this_thread::yield();
+  }
+  stats.wait_out += Clock::now() - start;
+}
+
+/* Cuts input into batches of 'batch_lines' lines. Waits while it is more than 'window' batches ahead of writer */
+static ERR_CODE ReadStage(FILE *in, size_t batch_lines, size_t window, Channel &out,
+                          const std::atomic<size_t> &written, WorkerStats &stats)
+{
+  std::vector<char> chunk(PIPELINE_READ_CHUNK);
+  BatchPtr batch(new LineBatch);
+  size_t seq = 0, line_start = 0, line_count = 0;
+  ERR_CODE code = SUCCESS;
+
+  auto emit = [&]()
+  {
+    stats.batches++;
+    stats.lines += batch->starts.size();
+    batch->seq = seq++;
+    batch->first_line = line_count + 1;
+    line_count += batch->starts.size();
+
+    auto start = Clock::now();
+    while (seq > written.load(std::memory_order_acquire) + window)
+    {
+      std::this_thread::yield();
+    }
+    stats.wait_out += Clock::now() - start;
+
+    Put(out, batch, stats);
+    batch.reset(new LineBatch);
+    line_start = 0;
+  };
+
+  for (;;)
+  {
+    auto start = Clock::now();
+    size_t size = fread(chunk.data(), 1, chunk.size(), in);
+    if (size == 0)
+    {
+      code = ferror(in) ? ERR_FILE_OPERATE : SUCCESS;
+      stats.busy += Clock::now() - start;
+      break;
+    }
+
+    size_t pos = 0;
+    while (pos < size)
+    {
+      const char *end = (const char *)memchr(chunk.data() + pos, '\n', size - pos);
+      if (end == nullptr) /* line continues in the next chunk */
+      {
+        batch->text.append(chunk.data() + pos, size - pos);
+        break;
+      }
+
+      batch->text.append(chunk.data() + pos, end + 1 - (chunk.data() + pos));
+      pos = end - chunk.data() + 1;
+      if (batch->text.size() >= 2 && batch->text[batch->text.size() - 2] == '\r')
+      {
+        batch->text[batch->text.size() - 2] = ' ';
+      }
+
+      batch->starts.push_back(line_start);
+      line_start = batch->text.size();
+      if (batch->starts.size() == batch_lines)
+      {
+        stats.busy += Clock::now() - start;
+        emit();
+        start = Clock::now();
+      }
+    }
+    stats.busy += Clock::now() - start;
+  }
+
+  if (batch->text.size() > line_start) /* last line without line feed */
+  {
+    batch->text.push_back('\n');
+    batch->starts.push_back(line_start);
+  }
+  if (!batch->starts.empty())
+  {
+    emit();
+  }
+
+  out.producers.fetch_sub(1, std::memory_order_release);
+  return code;
+}
+
+/* Compiles lines of batches */
+static void ParseStage(Channel &in, Channel &out, WorkerStats &stats)
+{
+  Grammar grammar('\n');
+  BatchPtr batch;
+
+  while (Take(in, batch, stats))
+  {
+    auto start = Clock::now();
+    batch->trees.reserve(batch->starts.size());
+    batch->errors.reserve(batch->starts.size());
+    for (size_t line_start : batch->starts)
+    {
+      std::pair<ExprTree, ERR_CODE> compiled = grammar.Compile(batch->text.c_str() + line_start);
+      batch->trees.push_back(std::move(compiled.first));
+      batch->errors.push_back(grammar.GetLastError());
+    }
+    stats.batches++;
+    stats.lines += batch->starts.size();
+    stats.busy += Clock::now() - start;
+
+    Put(out, batch, stats);
+  }
+
+  out.producers.fetch_sub(1, std::memory_order_release);
+}
+
+/* Appends record of failed line to side file text: "<line>:<byte offset>: error <code>, expected <token>: <text>" */
+static void AppendFailed(const LineBatch &batch, size_t line, const ParseError &error, std::string &failed)
+{
+  char header[64];
+  snprintf(header, sizeof(header), "%zu:%zu: error %d", batch.first_line + line, error.offset, (int)error.code);
+  failed += header;
+  if (*error.expected != '\0')
+  {
+    failed += ", expected ";
+    failed += error.expected;
+  }
+  failed += ": ";
+
+  const char *text = batch.text.c_str() + batch.starts[line];
+  failed.append(text, strchr(text, '\n') + 1);
+}
+
+/* Calculates compiled lines of batches and formats results. If failed lines go to side file,
+ * their results are empty lines, otherwise they are "error <code>" */
+static void EvalStage(const std::map<std::string, double> &vars, bool is_side_file, Channel &in, Channel &out,
+                      WorkerStats &stats)
+{
+  BatchPtr batch;
+  std::vector<double> values;
+  char number[32];
+
+  while (Take(in, batch, stats))
+  {
+    auto start = Clock::now();
+    for (size_t line = 0; line < batch->trees.size(); line++)
+    {
+      const ExprTree &tree = batch->trees[line];
+      ParseError &error = batch->errors[line];
+
+      values.clear();
+      for (size_t var = 0; var < tree.var_names.size() && error.code == SUCCESS; var++)
+      {
+        auto var_ptr = vars.find(tree.var_names[var]);
+        if (var_ptr == vars.end()) { error.code = ERR_WRONG_INPUT; error.expected = "value of every variable"; }
+        else                       { values.push_back(var_ptr->second); }
+      }
+      if (error.code == SUCCESS && tree.has_imag)
+      {
+        error.code = ERR_WRONG_INPUT;
+        error.expected = "real expression";
+      }
+
+      if (error.code == SUCCESS)
+      {
+        snprintf(number, sizeof(number), "%.17g\n", Evaluator<double>::Eval(tree, values.data()));
+        batch->output += number;
+      }
+      else if (is_side_file)
+      {
+        batch->output += '\n';
+        AppendFailed(*batch, line, error, batch->failed);
+      }
+      else
+      {
+        snprintf(number, sizeof(number), "error %d\n", (int)error.code);
+        batch->output += number;
+      }
+    }
+    batch->trees.clear();
+    stats.batches++;
+    stats.lines += batch->starts.size();
+    stats.busy += Clock::now() - start;
+
+    Put(out, batch, stats);
+  }
+
+  out.producers.fetch_sub(1, std::memory_order_release);
+}
+
+/* Writes results of batches and records of failed lines in input order. Batches which come early wait
+ * in reorder buffer */
+static ERR_CODE WriteStage(FILE *out, FILE *errors, Channel &in, std::atomic<size_t> &written, WorkerStats &stats)
+{
+  std::map<size_t, BatchPtr> pending;
+  BatchPtr batch;
+  size_t next = 0;
+  ERR_CODE code = SUCCESS;
+
+  while (Take(in, batch, stats))
+  {
+    auto start = Clock::now();
+    pending[batch->seq] = std::move(batch);
+
+    for (auto ready = pending.begin(); ready != pending.end() && ready->first == next; ready = pending.begin())
+    {
+      const std::string &output = ready->second->output, &failed = ready->second->failed;
+      if (code == SUCCESS && (fwrite(output.data(), 1, output.size(), out) != output.size() ||
+                              (errors != nullptr && fwrite(failed.data(), 1, failed.size(), errors) != failed.size())))
+      {
+        code = ERR_FILE_OPERATE; /* input is still drained, so other stages finish */
+      }
+      stats.batches++;
+      stats.lines += ready->second->starts.size();
+
+      pending.erase(ready);
+      written.store(++next, std::memory_order_release);
+    }
+    stats.max_pending = std::max(stats.max_pending, pending.size());
+    stats.busy += Clock::now() - start;
+  }
+
+  return code;
+}
+
+/* Joins statistics of stage threads */
+static StageStats JoinStats(const char *name, const std::vector<WorkerStats> &workers, size_t queue_capacity)
+{
+  StageStats stats;
+  stats.name = name;
+  stats.workers = (unsigned)workers.size();
+  stats.queue_capacity = queue_capacity;
+
+  size_t takes = 0, depth_sum = 0;
+  for (const WorkerStats &worker : workers)
+  {
+    stats.batches += worker.batches;
+    stats.lines += worker.lines;
+    stats.busy_ms += std::chrono::duration<double, std::milli>(worker.busy).count();
+    stats.wait_in_ms += std::chrono::duration<double, std::milli>(worker.wait_in).count();
+    stats.wait_out_ms += std::chrono::duration<double, std::milli>(worker.wait_out).count();
+    takes += worker.takes;
+    depth_sum += worker.depth_sum;
+    stats.max_depth = std::max(stats.max_depth, worker.max_depth);
+    stats.max_pending = std::max(stats.max_pending, worker.max_pending);
+  }
+  stats.mean_depth = takes != 0 ? (double)depth_sum / takes : 0;
+  return stats;
+}
+
+/* Calculates file of real expressions, one per line, and writes results in the same order */
+ERR_CODE RunPipeline(FILE *in, FILE *out, const PipelineParams &params, std::vector<StageStats> &stats)
+{
+  unsigned parsers = std::max(1u, params.parsers), evaluators = std::max(1u, params.evaluators);
+  size_t batch_lines = std::max((size_t)1, params.batch_lines);
+
+  Channel read_queue(params.queue_capacity, 1), parse_queue(params.queue_capacity, parsers),
+          eval_queue(params.queue_capacity, evaluators);
+  std::atomic<size_t> written(0);
+  size_t window = PIPELINE_WINDOW * read_queue.queue.Capacity();
+
+  std::vector<WorkerStats> reader(1), parser(parsers), evaluator(evaluators), writer(1);
+  ERR_CODE read_code = SUCCESS, write_code = SUCCESS;
+  std::vector<std::thread> threads;
+
+  threads.emplace_back([&]() { read_code = ReadStage(in, batch_lines, window, read_queue, written, reader[0]); });
+  for (unsigned worker = 0; worker < parsers; worker++)
+  {
+    threads.emplace_back([&, worker]() { ParseStage(read_queue, parse_queue, parser[worker]); });
+  }
+  for (unsigned worker = 0; worker < evaluators; worker++)
+  {
+    threads.emplace_back([&, worker]() { EvalStage(params.vars, params.errors != nullptr, parse_queue, eval_queue, evaluator[worker]); });
+  }
+  write_code = WriteStage(out, params.errors, eval_queue, written, writer[0]);
+
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  stats.clear();
+  stats.push_back(JoinStats("read", reader, 0));
+  stats.push_back(JoinStats("parse", parser, read_queue.queue.Capacity()));
+  stats.push_back(JoinStats("eval", evaluator, parse_queue.queue.Capacity()));
+  stats.push_back(JoinStats("write", writer, eval_queue.queue.Capacity()));
+
+  if (read_code != SUCCESS)
+  {
+    return read_code;
+  }
+  if (write_code == SUCCESS && (fflush(out) != 0 || (params.errors != nullptr && fflush(params.errors) != 0)))
+  {
+    write_code = ERR_FILE_OPERATE;
+  }
+  return write_code;
+}
@@ -0,0 +1,58 @@
+#ifndef CALCULATOR_PIPELINE_H
+#define CALCULATOR_PIPELINE_H
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "error_functions.h"
+
+/* Settings of expression file pipeline */
+struct PipelineParams
+{
+  unsigned parsers = 1;         /* Number of parsing threads */
+  unsigned evaluators = 1;      /* Number of evaluating threads */
+  size_t batch_lines = 256;     /* Number of lines handed between stages at once */
+  size_t queue_capacity = 16;   /* Number of batches every queue between stages holds */
+  std::map<std::string, double> vars; /* Values of variables of all expressions */
+  FILE *errors = nullptr;       /* Side file of failed lines, nullptr puts "error <code>" to output instead */
+};
+
+/* Statistics of one pipeline stage. Times are summed over stage threads */
+struct StageStats
+{
+  std::string name;
+  unsigned workers = 0;      /* Number of stage threads */
+  size_t batches = 0;        /* Number of processed batches */
+  size_t lines = 0;          /* Number of processed lines */
+  double busy_ms = 0;        /* Time spent on processing */
+  double wait_in_ms = 0;     /* Time spent waiting for input batch */
+  double wait_out_ms = 0;    /* Time spent waiting for room in output queue */
+  size_t queue_capacity = 0; /* Capacity of stage input queue, 0 for reader */
+  double mean_depth = 0;     /* Mean depth of input queue sampled at every taken batch */
+  size_t max_depth = 0;      /* Maximal sampled depth of input queue */
+  size_t max_pending = 0;    /* Maximal number of batches waiting for earlier ones in writer, 0 for other stages */
+};
+
+/***
+ * Calculates file of real expressions, one per line, and writes results in the same order, one per line.
+ *
+ * Work is split into stages connected by bounded lock-free queues ('bounded_queue.h'):
+ * reader cuts input into batches of lines, parser threads compile them, evaluator threads calculate them
+ * and writer puts results back in input order. Stages overlap, so reading and writing do not wait
+ * for calculation and vice versa. Reader does not run further than a few queues ahead of writer,
+ * so memory stays bounded when one batch is slow.
+ * Result of line which cannot be calculated is "error <code>". If 'params.errors' is set, it is an empty line instead,
+ * and record "<line>:<byte offset>: error <code>, expected <token>: <line text>" is written to 'params.errors'.
+ * Error records have fixed size ('ParseError'), so failed lines cost no more than calculated ones.
+ *
+ * @param in - input file
+ * @param out - output file
+ * @param stats - statistics of reader, parser, evaluator and writer stages
+ *
+ * @return error code. ERR_FILE_OPERATE if input cannot be read or output cannot be written.
+ */
+ERR_CODE RunPipeline(FILE *in, FILE *out, const PipelineParams &params, std::vector<StageStats> &stats);
+
+#endif //CALCULATOR_PIPELINE_H
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cmath>
+
+#include "polynomial.h"
+
+/* Maximal exponent of '^' operation which is expanded to polynomial multiplication */
+#define POLY_MAX_POWER 32
+
+/* Checks if polynomials have compatible variables and sets variable of 'result' */
+static bool JoinVars(const Polynomial &a, const Polynomial &b, Polynomial &result)
+{
+  if (a.has_var && b.has_var && a.var != b.var)
+  {
+    return false;
+  }
+
+  result.has_var = a.has_var || b.has_var;
+  result.var = a.has_var ? a.var : b.var;
+  return true;
+}
+
+/* Checks if polynomial has at most one non-zero coefficient, i.e. it is c*x^k */
+static bool IsMonomial(const Polynomial &poly)
+{
+  return std::count_if(poly.coeffs.begin(), poly.coeffs.end(), [](double coeff) { return coeff != 0; }) <= 1;
+}
+
+/* Calculates a + sign * b. Polynomials of variable are added only if they have no terms of the same power,
+ * as combined terms may cancel each other (e.g. 'x*x - x*x' is NaN for large 'x', not 0) */
+static bool PolyAdd(const Polynomial &a, const Polynomial &b, double sign, Polynomial &result)
+{
+  if (!JoinVars(a, b, result))
+  {
+    return false;
+  }
+
+  if (result.has_var)
+  {
+    for (size_t i = 0; i < std::min(a.coeffs.size(), b.coeffs.size()); i++)
+    {
+      if (a.coeffs[i] != 0 && b.coeffs[i] != 0)
+      {
+        return false;
+      }
+    }
+  }
+
+  result.coeffs.assign(std::max(a.coeffs.size(), b.coeffs.size()), 0);
+  for (size_t i = 0; i < a.coeffs.size(); i++)
+  {
+    result.coeffs[i] += a.coeffs[i];
+  }
+  for (size_t i = 0; i < b.coeffs.size(); i++)
+  {
+    result.coeffs[i] += sign * b.coeffs[i];
+  }
+  return true;
+}
+
+/* Calculates a * b if both are monomials. Products of sums are not expanded, as expanded form
+ * loses accuracy by cancellation (e.g. 'x*(x-1)' near 1) */
+static bool PolyMul(const Polynomial &a, const Polynomial &b, Polynomial &result)
+{
+  if (!IsMonomial(a) || !IsMonomial(b) || !JoinVars(a, b, result) || a.Degree() + b.Degree() > POLY_MAX_DEGREE)
+  {
+    return false;
+  }
+
+  result.coeffs.assign(a.coeffs.size() + b.coeffs.size() - 1, 0);
+  for (size_t i = 0; i < a.coeffs.size(); i++)
+  {
+    for (size_t j = 0; j < b.coeffs.size(); j++)
+    {
+      result.coeffs[i + j] += a.coeffs[i] * b.coeffs[j];
+    }
+  }
+  return true;
+}
+
+/* Calculates a / b if 'a' is monomial and 'b' is constant. Division of variable by zero is kept,
+ * as zero coefficients of 'a' would become NaN instead of infinity */
+static bool PolyDiv(const Polynomial &a, const Polynomial &b, Polynomial &result)
+{
+  if (b.has_var || !IsMonomial(a) || (a.has_var && b.coeffs[0] == 0))
+  {
+    return false;
+  }
+
+  result = a;
+  for (auto &coeff : result.coeffs)
+  {
+    coeff /= b.coeffs[0];
+  }
+  return true;
+}
+
+/* Calculates a ^ b if 'a' is constant or 'a' is monomial and 'b' is small non-negative integer constant.
+ * Powers of sums are not expanded (e.g. '(x-1)^20' is kept accurate near 1) */
+static bool PolyPow(const Polynomial &a, const Polynomial &b, Polynomial &result)
+{
+  if (b.has_var)
+  {
+    return false;
+  }
+
+  double power = b.coeffs[0];
+  if (!a.has_var && (a.coeffs[0] >= 0 || power == floor(power))) /* negative base is folded only if result is real */
+  {
+    result = a;
+    result.coeffs[0] = pow(a.coeffs[0], power);
+    return true;
+  }
+
+  if (!a.has_var || !IsMonomial(a) || power < 0 || power > POLY_MAX_POWER || power != floor(power) || a.Degree() * (size_t)power > POLY_MAX_DEGREE)
+  {
+    return false;
+  }
+
+  result.has_var = true;
+  result.var = a.var;
+  result.coeffs.assign(1, 1);
+
+  for (size_t i = 0; i < (size_t)power; i++)
+  {
+    Polynomial tmp;
+    PolyMul(result, a, tmp);
+    result = tmp;
+  }
+  return true;
+}
+
+/* Replaces tree node 'idx' with node calculating polynomial 'poly' */
+static void EmitPoly(ExprTree &tree, size_t idx, const Polynomial &poly)
+{
+  ExprNode &node = tree.nodes[idx];
+
+  if (!poly.has_var)
+  {
+    node.type = NODE_NUM;
+    node.value = poly.coeffs[0];
+  }
+  else if (node.type != NODE_VAR)
+  {
+    node.type = NODE_POLY;
+    node.left = tree.coeffs.size();
+    node.right = poly.Degree();
+    node.var = poly.var;
+    tree.coeffs.insert(tree.coeffs.end(), poly.coeffs.begin(), poly.coeffs.end());
+  }
+}
+
+/* Checks if subtree with root 'idx' is polynomial and writes it to 'poly'.
+ * If it is not, its maximal polynomial subtrees are rewritten */
+static bool CollectPoly(ExprTree &tree, size_t idx, Polynomial &poly)
+{
+  const ExprNode node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_NUM:
+      poly.has_var = false;
+      poly.coeffs.assign(1, node.value);
+      return true;
+
+    case NODE_VAR:
+      poly.has_var = true;
+      poly.var = node.var;
+      poly.coeffs.assign(2, 0);
+      poly.coeffs[1] = 1;
+      return true;
+
+    case NODE_ADD:
+    case NODE_SUB:
+    case NODE_MUL:
+    case NODE_DIV:
+    case NODE_POW:
+    {
+      Polynomial left, right;
+      bool is_left_poly  = CollectPoly(tree, node.left, left);
+      bool is_right_poly = CollectPoly(tree, node.right, right);
+
+      if (is_left_poly && is_right_poly)
+      {
+        bool is_joined = false;
+        switch (node.type)
+        {
+          case NODE_ADD: is_joined = PolyAdd(left, right, 1, poly);  break;
+          case NODE_SUB: is_joined = PolyAdd(left, right, -1, poly); break;
+          case NODE_MUL: is_joined = PolyMul(left, right, poly);     break;
+          case NODE_DIV: is_joined = PolyDiv(left, right, poly);     break;
+          case NODE_POW: is_joined = PolyPow(left, right, poly);     break;
+          default      : break;
+        }
+
+        if (is_joined)
+        {
+          return true;
+        }
+      }
+
+      if (is_left_poly)  { EmitPoly(tree, node.left, left); }
+      if (is_right_poly) { EmitPoly(tree, node.right, right); }
+      return false;
+    }
+
+    case NODE_LOCAL: /* binding of constant, bindings are rewritten before statements using them */
+      if (tree.nodes[tree.let_roots[node.var]].type != NODE_NUM)
+      {
+        return false;
+      }
+      poly.has_var = false;
+      poly.coeffs.assign(1, tree.nodes[tree.let_roots[node.var]].value);
+      return true;
+
+    case NODE_FUNC:
+    {
+      Polynomial arg, second;
+      bool is_arg_poly = CollectPoly(tree, node.left, arg);
+      bool is_second_poly = ExprTree::IdArity(node.id) == 2 && CollectPoly(tree, node.right, second);
+
+      /* Identifier of constants is calculated if its value is finite, so real calculation of it
+       * is valid in complex numbers as well */
+      if (is_arg_poly && !arg.has_var && (ExprTree::IdArity(node.id) == 1 || (is_second_poly && !second.has_var)))
+      {
+        double value = ExprTree::IdArity(node.id) == 1 ? ExprTree::CalcOpId(node.id, arg.coeffs[0]) :
+                                                         ExprTree::CalcOpId(node.id, arg.coeffs[0], second.coeffs[0]);
+        if (std::isfinite(value))
+        {
+          poly.has_var = false;
+          poly.coeffs.assign(1, value);
+          return true;
+        }
+      }
+
+      if (is_arg_poly)    { EmitPoly(tree, node.left, arg); }
+      if (is_second_poly) { EmitPoly(tree, node.right, second); }
+      return false;
+    }
+
+    case NODE_SELECT:
+    {
+      Polynomial cond, left, right;
+      bool is_cond_poly = CollectPoly(tree, node.cond, cond);
+      bool is_left_poly = CollectPoly(tree, node.left, left);
+      bool is_right_poly = CollectPoly(tree, node.right, right);
+
+      if (is_cond_poly && !cond.has_var) /* constant condition, node is replaced with chosen operand */
+      {
+        bool is_left = cond.coeffs[0] != 0;
+        if (is_left ? is_left_poly : is_right_poly)
+        {
+          poly = is_left ? left : right;
+          return true;
+        }
+        tree.nodes[idx] = tree.nodes[is_left ? node.left : node.right];
+        return false;
+      }
+
+      if (is_cond_poly)  { EmitPoly(tree, node.cond, cond); }
+      if (is_left_poly)  { EmitPoly(tree, node.left, left); }
+      if (is_right_poly) { EmitPoly(tree, node.right, right); }
+      return false;
+    }
+
+    case NODE_SUM: //fallthrough
+    case NODE_PROD: /* bounds become literals, body is rewritten, reduction itself is calculated by 'FoldReductions' */
+    {
+      Polynomial body, first, last;
+      if (CollectPoly(tree, node.cond, body))  { EmitPoly(tree, node.cond, body); }
+      if (CollectPoly(tree, node.left, first)) { EmitPoly(tree, node.left, first); }
+      if (CollectPoly(tree, node.right, last)) { EmitPoly(tree, node.right, last); }
+      return false;
+    }
+
+    case NODE_POLY: //fallthrough;
+    default:
+      if (ExprTree::IsCompare(node.type))
+      {
+        Polynomial left, right;
+        bool is_left_poly = CollectPoly(tree, node.left, left);
+        bool is_right_poly = CollectPoly(tree, node.right, right);
+
+        if (is_left_poly && is_right_poly && !left.has_var && !right.has_var)
+        {
+          poly.has_var = false;
+          poly.coeffs.assign(1, ExprTree::Compare(node.type, left.coeffs[0], right.coeffs[0]));
+          return true;
+        }
+        if (is_left_poly)  { EmitPoly(tree, node.left, left); }
+        if (is_right_poly) { EmitPoly(tree, node.right, right); }
+      }
+      return false;
+  }
+}
+
+/* Replaces maximal polynomial subexpressions of one variable with NODE_POLY nodes
+ * and constant subexpressions with NODE_NUM nodes. Only sums of terms c*x^k written term by term are collected */
+void RewritePolynomials(ExprTree &tree)
+{
+  if (tree.nodes.empty())
+  {
+    return;
+  }
+
+  std::vector<size_t> roots = tree.let_roots;
+  roots.push_back(tree.root);
+
+  for (size_t root : roots)
+  {
+    Polynomial poly;
+    if (CollectPoly(tree, root, poly))
+    {
+      EmitPoly(tree, root, poly);
+    }
+  }
+}
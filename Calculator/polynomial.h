@@ -0,0 +1,27 @@
+#ifndef CALCULATOR_POLYNOMIAL_H
+#define CALCULATOR_POLYNOMIAL_H
+
+#include <vector>
+#include "expr_tree.h"
+
+/* Polynomial in at most one variable. Is used to recognize polynomial subexpressions of expression tree */
+struct Polynomial
+{
+  std::vector<double> coeffs; /* Coefficients, lowest power first */
+  bool has_var = false;       /* 'false' if polynomial is constant */
+  size_t var = 0;             /* Variable index of expression tree */
+
+  /* Returns polynomial degree */
+  size_t Degree() const
+  {
+    return coeffs.size() - 1;
+  }
+};
+
+/* Replaces maximal polynomial subexpressions of one variable with NODE_POLY nodes
+ * and constant subexpressions with NODE_NUM nodes. Polynomial subexpression is a sum of terms c*x^k
+ * of different powers written term by term, products and powers of sums are kept as they are written
+ * to avoid cancellation. Identifiers of constants and references to constant bindings are constant subexpressions too */
+void RewritePolynomials(ExprTree &tree);
+
+#endif //CALCULATOR_POLYNOMIAL_H
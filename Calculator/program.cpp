@@ -0,0 +1,308 @@
+#include <algorithm>
+
+#include "program.h"
+
+/* Number of reduction iterations after which reduction cost stops growing */
+#define REDUCE_MAX_COST (1 << 20)
+
+/* Counts reads of index 'index' in reduction body and collects binding references into 'lets' */
+static void CountLoopReads(const ExprTree &tree, size_t idx, size_t index, size_t &index_reads,
+                           std::vector<size_t> &lets)
+{
+  const ExprNode &node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_INDEX: index_reads += node.var == index ? 1 : 0; return;
+    case NODE_LOCAL: lets.push_back(node.var); return;
+    case NODE_NUM  : //fallthrough
+    case NODE_IMAG : //fallthrough
+    case NODE_VAR  : //fallthrough
+    case NODE_POLY : return;
+    case NODE_SELECT: //fallthrough
+    case NODE_SUM   : //fallthrough
+    case NODE_PROD  : CountLoopReads(tree, node.cond, index, index_reads, lets); break;
+    case NODE_FUNC  :
+      if (ExprTree::IdArity(node.id) == 1)
+      {
+        CountLoopReads(tree, node.left, index, index_reads, lets);
+        return;
+      }
+      break;
+    default: break;
+  }
+
+  CountLoopReads(tree, node.left, index, index_reads, lets);
+  CountLoopReads(tree, node.right, index, index_reads, lets);
+}
+
+/* Returns cost of calculation of subtree, references to bindings are free */
+static size_t Cost(const ExprTree &tree, size_t idx)
+{
+  const ExprNode &node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_LOCAL : return 0;
+    case NODE_NUM   : //fallthrough
+    case NODE_IMAG  : //fallthrough
+    case NODE_VAR   : return 1;
+    case NODE_POLY  : return node.right + 1;
+    case NODE_POW   : return Cost(tree, node.left) + Cost(tree, node.right) + 8;
+    case NODE_SELECT: return Cost(tree, node.cond) + Cost(tree, node.left) + Cost(tree, node.right) + 1;
+    case NODE_INDEX : return 0;
+    case NODE_SUM   : //fallthrough
+    case NODE_PROD  :
+    {
+      double count = tree.nodes[node.right].value - tree.nodes[node.left].value + 1;
+      return (size_t)std::min(std::max(count, 0.0), (double)REDUCE_MAX_COST) * (Cost(tree, node.cond) + 1) + 1;
+    }
+    case NODE_FUNC  :
+      return Cost(tree, node.left) + (ExprTree::IdArity(node.id) == 2 ? Cost(tree, node.right) + 1 : 8);
+    default         : return Cost(tree, node.left) + Cost(tree, node.right) + 1;
+  }
+}
+
+/* Class constructor. Compiles 'tree' */
+Program::Program(const ExprTree &tree, SELECT_MODE init_select_mode) : coeffs(tree.coeffs),
+                                                                       select_mode(init_select_mode)
+{
+  register_count = 0;
+  if (tree.nodes.empty())
+  {
+    Instruction zero;
+    zero.dst = Allocate();
+    code.push_back(zero);
+    return;
+  }
+
+  /* Liveness: walk statements backwards, binding is live if any live statement after it refers to it */
+  let_uses.assign(tree.let_roots.size(), 0);
+  let_registers.assign(tree.let_roots.size(), 0);
+  index_registers.assign(tree.index_count, 0);
+  counter_count = tree.index_count;
+  CountUses(tree, tree.root);
+  for (size_t let = tree.let_roots.size(); let-- > 0;)
+  {
+    if (let_uses[let] != 0)
+    {
+      CountUses(tree, tree.let_roots[let]);
+    }
+  }
+
+  for (size_t let = 0; let < tree.let_roots.size(); let++)
+  {
+    if (let_uses[let] == 0)
+    {
+      continue;
+    }
+
+    /* Value register is kept until all references are read */
+    size_t reg = Emit(tree, tree.let_roots[let]);
+    ref_counts[reg] += let_uses[let];
+    Release(reg);
+    let_registers[let] = reg;
+    live_lets++;
+  }
+
+  result = Emit(tree, tree.root);
+}
+
+/* Counts binding references in subtree */
+void Program::CountUses(const ExprTree &tree, size_t idx)
+{
+  const ExprNode &node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_LOCAL: let_uses[node.var]++; return;
+    case NODE_ADD  : //fallthrough
+    case NODE_SUB  : //fallthrough
+    case NODE_MUL  : //fallthrough
+    case NODE_DIV  : //fallthrough
+    case NODE_POW  :
+      CountUses(tree, node.left);
+      CountUses(tree, node.right);
+      return;
+    case NODE_FUNC:
+      CountUses(tree, node.left);
+      if (ExprTree::IdArity(node.id) == 2)
+      {
+        CountUses(tree, node.right);
+      }
+      return;
+    case NODE_SELECT:
+      CountUses(tree, node.cond);
+      CountUses(tree, node.left);
+      CountUses(tree, node.right);
+      return;
+    case NODE_SUM: //fallthrough
+    case NODE_PROD:
+      CountUses(tree, node.cond);
+      return;
+    default:
+      if (ExprTree::IsCompare(node.type))
+      {
+        CountUses(tree, node.left);
+        CountUses(tree, node.right);
+      }
+      return;
+  }
+}
+
+/* Emits code of subtree and returns its register. Register of binding reference is the binding register */
+size_t Program::Emit(const ExprTree &tree, size_t idx)
+{
+  const ExprNode &node = tree.nodes[idx];
+  Instruction ins;
+  ins.type = node.type;
+  ins.id = node.id;
+  ins.value = node.value;
+  ins.var = node.var;
+
+  switch (node.type)
+  {
+    case NODE_LOCAL:
+      return let_registers[node.var];
+    case NODE_INDEX:
+      return index_registers[node.var];
+    case NODE_SUM: //fallthrough
+    case NODE_PROD:
+      return EmitReduce(tree, node);
+    case NODE_POLY:
+      ins.left = node.left;
+      ins.right = node.right;
+      ins.dst = Allocate();
+      break;
+    case NODE_NUM : //fallthrough
+    case NODE_IMAG: //fallthrough
+    case NODE_VAR :
+      ins.dst = Allocate();
+      break;
+    case NODE_SELECT:
+    {
+      /* Condition is kept until operands are blended */
+      ins.cond = Emit(tree, node.cond);
+
+      size_t cost = std::max(Cost(tree, node.left), Cost(tree, node.right));
+      bool is_lazy = select_mode == SELECT_LAZY || (select_mode == SELECT_AUTO && cost > LAZY_SELECT_COST);
+      ins.left = is_lazy ? EmitGuarded(tree, node.left, ins.cond, CONTROL_IF_TRUE) : Emit(tree, node.left);
+      ins.right = is_lazy ? EmitGuarded(tree, node.right, ins.cond, CONTROL_IF_FALSE) : Emit(tree, node.right);
+
+      Release(ins.cond);
+      Release(ins.left);
+      ins.dst = Allocate();
+      Release(ins.right);
+      break;
+    }
+    case NODE_FUNC:
+      if (ExprTree::IdArity(node.id) == 1)
+      {
+        ins.left = Emit(tree, node.left);
+        Release(ins.left);
+        ins.dst = Allocate();
+        break;
+      }
+      //fallthrough
+    default:
+      /* Left operand register is released before allocation so the result may overwrite it,
+       * right one after, so it is never overwritten before it is read */
+      ins.left = Emit(tree, node.left);
+      ins.right = Emit(tree, node.right);
+      Release(ins.left);
+      ins.dst = Allocate();
+      Release(ins.right);
+      break;
+  }
+
+  code.push_back(ins);
+  return ins.dst;
+}
+
+/* Emits code of subtree preceded by guard which skips it if condition 'cond' does not choose it */
+size_t Program::EmitGuarded(const ExprTree &tree, size_t idx, size_t cond, CONTROL_TYPE guard)
+{
+  size_t guard_pos = code.size();
+  code.emplace_back();
+  code[guard_pos].control = guard;
+  code[guard_pos].cond = cond;
+
+  size_t reg = Emit(tree, idx);
+
+  code[guard_pos].skip = code.size() - guard_pos - 1;
+  if (code[guard_pos].skip == 0) /* binding reference has no code */
+  {
+    code.erase(code.begin() + guard_pos);
+  }
+  return reg;
+}
+
+/* Emits loop of NODE_SUM or NODE_PROD and returns accumulator register.
+ * Index register and bindings read by body are kept until loop ends */
+size_t Program::EmitReduce(const ExprTree &tree, const ExprNode &node)
+{
+  size_t index_reads = 0;
+  std::vector<size_t> lets;
+  CountLoopReads(tree, node.cond, node.var, index_reads, lets);
+  for (size_t let : lets)
+  {
+    ref_counts[let_registers[let]]++;
+  }
+
+  Instruction ins;
+  ins.type = node.type;
+  ins.control = CONTROL_LOOP;
+  ins.value = tree.nodes[node.left].value;
+  ins.counter = node.var;
+  ins.dst = Allocate();
+  ins.cond = Allocate();
+  ins.var = Allocate();
+  ref_counts[ins.var] += index_reads;
+  index_registers[node.var] = ins.var;
+
+  size_t loop_pos = code.size();
+  code.push_back(ins);
+  ins.left = Emit(tree, node.cond);
+
+  ins.control = CONTROL_NEXT;
+  ins.value = tree.nodes[node.right].value;
+  ins.skip = code.size() - loop_pos;
+  code[loop_pos].skip = ins.skip;
+  code.push_back(ins);
+
+  Release(ins.left);
+  Release(ins.cond);
+  Release(ins.var);
+  for (size_t let : lets)
+  {
+    Release(let_registers[let]);
+  }
+  return ins.dst;
+}
+
+/* Returns the lowest free register */
+size_t Program::Allocate()
+{
+  size_t reg = 0;
+  while (reg < ref_counts.size() && ref_counts[reg] != 0)
+  {
+    reg++;
+  }
+
+  if (reg == ref_counts.size())
+  {
+    ref_counts.push_back(0);
+    register_count = ref_counts.size();
+  }
+  ref_counts[reg] = 1;
+  return reg;
+}
+
+/* Marks one pending read of register as done. Register becomes free after the last one */
+void Program::Release(size_t reg)
+{
+  if (ref_counts[reg] != 0)
+  {
+    ref_counts[reg]--;
+  }
+}
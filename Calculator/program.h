@@ -0,0 +1,94 @@
+#ifndef CALCULATOR_PROGRAM_H
+#define CALCULATOR_PROGRAM_H
+
+#include <vector>
+
+#include "expr_tree.h"
+
+/* Operand cost starting from which 'select' operands are evaluated lazily in SELECT_AUTO mode.
+ * Arithmetic operation costs 1, identifier operation and power cost 8 */
+#define LAZY_SELECT_COST 16
+
+/* Evaluation of 'select' operands */
+enum SELECT_MODE
+{
+  SELECT_AUTO,  /* Lazy if any operand costs more than LAZY_SELECT_COST, eager otherwise */
+  SELECT_EAGER, /* Both operands are calculated for all points and blended by condition */
+  SELECT_LAZY   /* Operand is skipped for block of points if condition does not choose it for any point */
+};
+
+/* Control flow of instruction */
+enum CONTROL_TYPE
+{
+  CONTROL_NONE,     /* Instruction calculates value */
+  CONTROL_IF_TRUE,  /* Guard of lazy 'select' operand: following 'skip' instructions are executed only
+                     * if condition is true for some point */
+  CONTROL_IF_FALSE, /* Following 'skip' instructions are executed only if condition is false for some point */
+  CONTROL_LOOP,     /* Start of NODE_SUM or NODE_PROD: clears accumulator, sets counter and index to first value
+                     * 'value', skips 'skip' instructions if range is empty */
+  CONTROL_NEXT      /* End of reduction body: accumulates body value 'left', increments counter, copies it to index
+                     * and jumps 'skip' instructions back while counter does not exceed last value 'value'.
+                     * Counter is integer, so loop ends even if index type can not hold every value of range */
+};
+
+/* Program instruction. Operation type and fields mirror 'ExprNode', operands are register indices */
+struct Instruction
+{
+  NODE_TYPE type = NODE_NUM;
+  ID_TYPE id = NOT_ID;    /* Identifier type of NODE_FUNC */
+  double value = 0;       /* Literal value of NODE_NUM, index bound of loop instructions */
+  size_t var = 0;         /* Variable index of NODE_VAR and NODE_POLY, index register of loop instructions */
+  size_t dst = 0;         /* Result register, accumulator of loop instructions */
+  size_t left = 0;        /* Left operand register or offset of NODE_POLY coefficients */
+  size_t right = 0;       /* Right operand register or degree of NODE_POLY */
+  size_t cond = 0;        /* Condition register of NODE_SELECT and guard, rounding error register of loop */
+  size_t counter = 0;     /* Integer counter of loop instructions, index register only gets its value */
+  CONTROL_TYPE control = CONTROL_NONE;
+  size_t skip = 0;        /* Number of instructions skipped by guard or loop jump */
+};
+
+/***
+ * Expression script compiled to linear register code.
+ *
+ * Every 'let' binding and intermediate value lives in a register. Registers are reused as soon
+ * as their value is dead: temporaries after their only use, bindings after their last reference.
+ * Bindings the final expression does not depend on are not compiled at all.
+ * Binary instruction never has 'dst == right', so executor may copy 'left' into 'dst' and
+ * apply operation in place. NODE_SELECT instruction blends operands by condition point by point,
+ * its operands may be guarded to be skipped for blocks where they are not chosen.
+ * NODE_SUM and NODE_PROD are loops over their body code; registers the body reads are kept
+ * until the loop ends, so body temporaries never overwrite them.
+ */
+class Program
+{
+public:
+  std::vector<Instruction> code; /* Instructions in execution order */
+  std::vector<double> coeffs;    /* Coefficient pool of NODE_POLY instructions */
+  size_t register_count = 1;     /* Number of registers used by code */
+  size_t result = 0;             /* Register holding value of final expression */
+  size_t live_lets = 0;          /* Number of compiled 'let' bindings */
+  size_t counter_count = 0;      /* Number of loop counters, one for every reduction index */
+
+  /* Class constructor. Compiles 'tree' */
+  explicit Program(const ExprTree &tree, SELECT_MODE init_select_mode = SELECT_AUTO);
+
+private:
+  SELECT_MODE select_mode;           /* Evaluation of 'select' operands */
+  std::vector<size_t> let_uses;      /* Number of references to every binding from compiled statements */
+  std::vector<size_t> let_registers; /* Register of every compiled binding */
+  std::vector<size_t> ref_counts;    /* Number of pending reads of every register, 0 if register is free */
+  std::vector<size_t> index_registers; /* Register of every reduction index */
+
+  void CountUses(const ExprTree &tree, size_t idx); /* Counts binding references in subtree */
+  size_t Emit(const ExprTree &tree, size_t idx);    /* Emits code of subtree and returns its register */
+  size_t Allocate();                                /* Returns the lowest free register */
+  void Release(size_t reg);                         /* Marks one pending read of register as done */
+
+  /* Emits code of subtree preceded by guard which skips it if condition 'cond' does not choose it */
+  size_t EmitGuarded(const ExprTree &tree, size_t idx, size_t cond, CONTROL_TYPE guard);
+
+  /* Emits loop of NODE_SUM or NODE_PROD and returns accumulator register */
+  size_t EmitReduce(const ExprTree &tree, const ExprNode &node);
+};
+
+#endif //CALCULATOR_PROGRAM_H
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "reduce.h"
+#include "batch_eval.h"
+#include "parallel.h"
+#include "polynomial.h"
+#include "scalar_ops.h"
+#include "vec_math.h"
+
+/* Compensated sum or product of part of index range */
+struct PartialReduction
+{
+  double value = 0;
+  double error = 0; /* Rounding error of sum, 0 for product */
+};
+
+/* Calculates reduction over [first, last] in one thread. Every lane of index block is accumulated separately */
+static PartialReduction ReducePart(const ExprTree &kernel, NODE_TYPE type, long long first, long long last)
+{
+  BatchEvaluator<double> evaluator(kernel);
+  double index[BATCH_BLOCK], term[BATCH_BLOCK];
+  double lanes[BATCH_BLOCK], errors[BATCH_BLOCK];
+  std::fill(lanes, lanes + BATCH_BLOCK, type == NODE_SUM ? 0.0 : 1.0);
+  std::fill(errors, errors + BATCH_BLOCK, 0.0);
+
+  const double *columns[1] = {index};
+  size_t used_lanes = 0;
+
+  for (long long start = first; start <= last; start += BATCH_BLOCK)
+  {
+    size_t n = last - start + 1 < BATCH_BLOCK ? (size_t)(last - start + 1) : BATCH_BLOCK;
+    for (size_t i = 0; i < n; i++)
+    {
+      index[i] = (double)(start + (long long)i);
+    }
+    evaluator.Eval(columns, n, term);
+
+    if (type == NODE_SUM) { VecSumStep(lanes, errors, term, n); }
+    else                  { for (size_t i = 0; i < n; i++) { lanes[i] *= term[i]; } }
+    used_lanes = std::max(used_lanes, n);
+  }
+
+  PartialReduction result;
+  result.value = type == NODE_SUM ? 0 : 1;
+  for (size_t i = 0; i < used_lanes; i++)
+  {
+    if (type == NODE_SUM)
+    {
+      double sum = result.value + lanes[i];
+      result.error += ScalarOps<double>::SumError(result.value, lanes[i], sum) + errors[i];
+      result.value = sum;
+    }
+    else
+    {
+      result.value *= lanes[i];
+    }
+  }
+  return result;
+}
+
+/* Calculates sum or product of real expression over index range [first, last] */
+double ReduceRange(const ExprTree &kernel, NODE_TYPE type, long long first, long long last, unsigned threads)
+{
+  if (first > last)
+  {
+    return type == NODE_SUM ? 0 : 1;
+  }
+
+  unsigned long long count = (unsigned long long)(last - first) + 1;
+  unsigned parts = (unsigned)std::max(1ULL, std::min((unsigned long long)ThreadCount(threads), count / REDUCE_MIN_CHUNK));
+  unsigned long long chunk = count / parts;
+
+  std::vector<PartialReduction> partials(parts);
+  RunParallel(parts, [&](unsigned part)
+  {
+    long long part_first = first + (long long)(chunk * part);
+    long long part_last = part + 1 == parts ? last : part_first + (long long)chunk - 1;
+    partials[part] = ReducePart(kernel, type, part_first, part_last);
+  });
+
+  PartialReduction result = partials[0];
+  for (unsigned part = 1; part < parts; part++)
+  {
+    if (type == NODE_SUM)
+    {
+      double sum = result.value + partials[part].value;
+      result.error += ScalarOps<double>::SumError(result.value, partials[part].value, sum) + partials[part].error;
+      result.value = sum;
+    }
+    else
+    {
+      result.value *= partials[part].value;
+    }
+  }
+  return type == NODE_SUM ? result.value + result.error : result.value;
+}
+
+/* Checks if subtree depends only on indices in 'bound' */
+static bool IsClosed(const ExprTree &tree, size_t idx, std::vector<size_t> &bound)
+{
+  const ExprNode &node = tree.nodes[idx];
+
+  switch (node.type)
+  {
+    case NODE_NUM  : return true;
+    case NODE_INDEX: return std::find(bound.begin(), bound.end(), node.var) != bound.end();
+    case NODE_IMAG : //fallthrough
+    case NODE_VAR  : //fallthrough
+    case NODE_LOCAL: //fallthrough
+    case NODE_POLY : return false;
+    case NODE_SUM  : //fallthrough
+    case NODE_PROD :
+    {
+      bound.push_back(node.var);
+      bool is_closed = IsClosed(tree, node.cond, bound);
+      bound.pop_back();
+      return is_closed;
+    }
+    case NODE_SELECT: return IsClosed(tree, node.cond, bound) && IsClosed(tree, node.left, bound) &&
+                             IsClosed(tree, node.right, bound);
+    case NODE_FUNC  :
+      return IsClosed(tree, node.left, bound) && (ExprTree::IdArity(node.id) == 1 || IsClosed(tree, node.right, bound));
+    default         : return IsClosed(tree, node.left, bound) && IsClosed(tree, node.right, bound);
+  }
+}
+
+/* Checks if reduction bound is integer literal */
+static bool IsBound(const ExprNode &node)
+{
+  return node.type == NODE_NUM && node.value == std::floor(node.value) && std::fabs(node.value) <= REDUCE_MAX_BOUND;
+}
+
+/* Checks bounds and folds closed reductions of subtree, inner ones first. Only checks bounds if 'is_folding' is false */
+static ERR_CODE FoldNode(ExprTree &tree, size_t idx, unsigned threads, bool is_folding)
+{
+  const ExprNode node = tree.nodes[idx];
+  ERR_CODE code = SUCCESS;
+
+  switch (node.type)
+  {
+    case NODE_NUM  : //fallthrough
+    case NODE_IMAG : //fallthrough
+    case NODE_VAR  : //fallthrough
+    case NODE_LOCAL: //fallthrough
+    case NODE_POLY : //fallthrough
+    case NODE_INDEX: return SUCCESS;
+    case NODE_SUM  : //fallthrough
+    case NODE_PROD :
+    {
+      if ((code = FoldNode(tree, node.cond, threads, is_folding)) != SUCCESS)
+      {
+        return code;
+      }
+      if (!IsBound(tree.nodes[node.left]) || !IsBound(tree.nodes[node.right]))
+      {
+        return ERR_WRONG_INPUT;
+      }
+
+      std::vector<size_t> bound(1, node.var);
+      if (!is_folding || !IsClosed(tree, node.cond, bound))
+      {
+        return SUCCESS;
+      }
+
+      /* Body is compiled with index as the only variable, so powers of index become polynomials */
+      ExprTree kernel;
+      kernel.nodes = tree.nodes;
+      kernel.coeffs = tree.coeffs;
+      kernel.index_count = tree.index_count;
+      kernel.var_names.push_back("#k");
+      kernel.root = node.cond;
+      for (ExprNode &kernel_node : kernel.nodes)
+      {
+        if (kernel_node.type == NODE_INDEX && kernel_node.var == node.var)
+        {
+          kernel_node.type = NODE_VAR;
+          kernel_node.var = 0;
+        }
+      }
+      RewritePolynomials(kernel);
+
+      double value = ReduceRange(kernel, node.type, (long long)tree.nodes[node.left].value,
+                                 (long long)tree.nodes[node.right].value, threads);
+      if (std::isfinite(value))
+      {
+        tree.nodes[idx] = ExprNode();
+        tree.nodes[idx].value = value;
+      }
+      return SUCCESS;
+    }
+    case NODE_SELECT:
+      if ((code = FoldNode(tree, node.cond, threads, is_folding)) != SUCCESS)
+      {
+        return code;
+      }
+      break;
+    case NODE_FUNC:
+      if (ExprTree::IdArity(node.id) == 1)
+      {
+        return FoldNode(tree, node.left, threads, is_folding);
+      }
+      break;
+    default:
+      break;
+  }
+
+  if ((code = FoldNode(tree, node.left, threads, is_folding)) != SUCCESS)
+  {
+    return code;
+  }
+  return FoldNode(tree, node.right, threads, is_folding);
+}
+
+/* Checks bounds of reductions of all roots of tree and folds them if 'is_folding' is true */
+static ERR_CODE FoldRoots(ExprTree &tree, unsigned threads, bool is_folding)
+{
+  if (tree.nodes.empty() || tree.index_count == 0)
+  {
+    return SUCCESS;
+  }
+
+  std::vector<size_t> roots = tree.let_roots;
+  roots.push_back(tree.root);
+
+  for (size_t root : roots)
+  {
+    ERR_CODE code = FoldNode(tree, root, threads, is_folding);
+    if (code != SUCCESS)
+    {
+      return code;
+    }
+  }
+  return SUCCESS;
+}
+
+/* Checks bounds of reductions and calculates reductions whose body depends only on indices */
+ERR_CODE FoldReductions(ExprTree &tree, unsigned threads)
+{
+  return FoldRoots(tree, threads, true);
+}
+
+/* Checks bounds of reductions without calculating them */
+ERR_CODE CheckReductions(ExprTree &tree)
+{
+  return FoldRoots(tree, 1, false);
+}
@@ -0,0 +1,47 @@
+#ifndef CALCULATOR_REDUCE_H
+#define CALCULATOR_REDUCE_H
+
+#include "error_functions.h"
+#include "expr_tree.h"
+
+/* Minimal number of reduction terms given to separate thread. Batch evaluation of term takes several nanoseconds
+ * and threads are started one by one for about 20 microseconds each, so smaller chunks are slower than one thread */
+#define REDUCE_MIN_CHUNK (1 << 20)
+
+/* Maximal absolute value of reduction bound, indices up to it are exact in 'double' */
+#define REDUCE_MAX_BOUND (1LL << 53)
+
+/***
+ * Checks bounds of NODE_SUM and NODE_PROD nodes and calculates reductions whose body depends only
+ * on its index (and indices of inner reductions) at compile time.
+ *
+ * Body is compiled once and evaluated by 'BatchEvaluator' for blocks of consecutive indices,
+ * index range is split between threads. Sums are compensated by Neumaier scheme in every block lane,
+ * lanes and threads are joined by compensated summation as well.
+ * Reductions of variables and bindings are left to evaluators. Reduction is not folded if its value
+ * is not finite, so real calculation of it is valid in complex numbers as well.
+ *
+ * @param threads - number of threads, 0 uses all hardware threads
+ *
+ * @return error code. ERR_WRONG_INPUT if bound is not integer literal.
+ */
+ERR_CODE FoldReductions(ExprTree &tree, unsigned threads = 0);
+
+/***
+ * Checks bounds of NODE_SUM and NODE_PROD nodes the same way as 'FoldReductions', but leaves all reductions
+ * to evaluators. Used for interval calculation, whose bounds must not rely on folding in rounded arithmetic.
+ *
+ * @return error code. ERR_WRONG_INPUT if bound is not integer literal.
+ */
+ERR_CODE CheckReductions(ExprTree &tree);
+
+/***
+ * Calculates sum or product of real expression over index range [first, last].
+ *
+ * @param kernel - reduction body, index is variable 0
+ * @param type - NODE_SUM or NODE_PROD
+ * @param threads - number of threads, 0 uses all hardware threads
+ */
+double ReduceRange(const ExprTree &kernel, NODE_TYPE type, long long first, long long last, unsigned threads = 0);
+
+#endif //CALCULATOR_REDUCE_H
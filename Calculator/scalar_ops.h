@@ -0,0 +1,360 @@
+#ifndef CALCULATOR_SCALAR_OPS_H
+#define CALCULATOR_SCALAR_OPS_H
+
+#include <cmath>
+#include <complex>
+#include <limits>
+
+#include "expr_tree.h"
+#include "grammar_profile.h"
+#include "interval.h"
+
+/***
+ * Scalar type operations used by templated evaluator.
+ * Every scalar type must provide:
+ *   Literal(double)       - scalar with given real value
+ *   Literal(node)         - value of NODE_NUM node, may use its exact rational value
+ *   ImagUnit()            - imaginary unit or NaN if scalar type is real
+ *   MulAdd(a, b, c)       - a * b + c
+ *   Pow(a, b)             - a ^ b
+ *   CalcOpId(id, value)   - identifier operation
+ *   CalcOpId(id, a, b)    - two-argument identifier operation
+ *   Compare(type, a, b)   - comparison, 1 if true and 0 if false
+ *   IsTrue(value)         - checks if value is true condition
+ *   IsFalse(value)        - checks if value is false condition, value may be neither true nor false (intervals)
+ *   Join(a, b)            - scalar containing both values, used when condition is neither true nor false
+ *   SumError(a, b, sum)   - rounding error of 'sum = a + b', so 'a + b = sum + error' exactly
+ */
+template <typename ScalarT>
+struct ScalarOps;
+
+template <>
+struct ScalarOps<double>
+{
+  static double Literal(double value)
+  {
+    return value;
+  }
+
+  static double Literal(const ExprNode &node)
+  {
+    return node.value;
+  }
+
+  static double ImagUnit()
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  static double MulAdd(double a, double b, double c)
+  {
+#ifdef FP_FAST_FMA
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif //FP_FAST_FMA
+  }
+
+  static double Pow(double a, double b)
+  {
+    return pow(a, b);
+  }
+
+  static double CalcOpId(ID_TYPE idType, double value)
+  {
+    return ExprTree::CalcOpId(idType, value);
+  }
+
+  static double CalcOpId(ID_TYPE idType, double left, double right)
+  {
+    return ExprTree::CalcOpId(idType, left, right);
+  }
+
+  static double Compare(NODE_TYPE type, double left, double right)
+  {
+    return ExprTree::Compare(type, left, right);
+  }
+
+  static bool IsTrue(double value)
+  {
+    return value != 0;
+  }
+
+  static bool IsFalse(double value)
+  {
+    return value == 0;
+  }
+
+  static double Join(double a, double)
+  {
+    return a;
+  }
+
+  static double SumError(double a, double b, double sum)
+  {
+    return fabs(a) >= fabs(b) ? (a - sum) + b : (b - sum) + a;
+  }
+};
+
+/* Operations of real types other than 'double'. Literals are parsed to 'double' and rounded to the type */
+template <typename RealT>
+struct RealScalarOps
+{
+  static RealT Literal(double value)
+  {
+    return (RealT)value;
+  }
+
+  /* Exact literals are rounded to the type directly, so decimal fractions keep extended precision */
+  static RealT Literal(const ExprNode &node)
+  {
+    return node.is_exact ? (RealT)node.exact_num / (RealT)node.exact_den : (RealT)node.value;
+  }
+
+  static RealT ImagUnit()
+  {
+    return std::numeric_limits<RealT>::quiet_NaN();
+  }
+
+  static RealT MulAdd(RealT a, RealT b, RealT c)
+  {
+    return a * b + c;
+  }
+
+  static RealT Pow(RealT a, RealT b)
+  {
+    return std::pow(a, b);
+  }
+
+  static RealT CalcOpId(ID_TYPE idType, RealT value)
+  {
+    PROFILE_COUNT(op_calls[idType], 1)
+
+    switch (idType)
+    {
+      case ID_SIN : return std::sin(value);
+      case ID_COS : return std::cos(value);
+      case ID_TAN : return std::tan(value);
+      case ID_COT : return 1 / std::tan(value);
+      case ID_SQRT: return std::sqrt(value);
+      case ID_LN  : return std::log(value);
+      case ID_NORM: return std::fabs(value);
+      case NOT_ID : //fallthrough;
+      default     : return 0;
+    }
+  }
+
+  static RealT CalcOpId(ID_TYPE idType, RealT left, RealT right)
+  {
+    PROFILE_COUNT(op_calls[idType], 1)
+
+    switch (idType)
+    {
+      case ID_DOT   : //fallthrough;
+      case ID_MATMUL: return left * right;
+      case ID_MIN   : return right < left ? right : left;
+      case ID_MAX   : return right > left ? right : left;
+      default       : return 0;
+    }
+  }
+
+  static RealT Compare(NODE_TYPE type, RealT left, RealT right)
+  {
+    switch (type)
+    {
+      case NODE_LT: return left <  right ? 1 : 0;
+      case NODE_LE: return left <= right ? 1 : 0;
+      case NODE_GT: return left >  right ? 1 : 0;
+      case NODE_GE: return left >= right ? 1 : 0;
+      case NODE_EQ: return left == right ? 1 : 0;
+      case NODE_NE: return left != right ? 1 : 0;
+      default     : return 0;
+    }
+  }
+
+  static bool IsTrue(RealT value)
+  {
+    return value != 0;
+  }
+
+  static bool IsFalse(RealT value)
+  {
+    return value == 0;
+  }
+
+  static RealT Join(RealT a, RealT)
+  {
+    return a;
+  }
+
+  static RealT SumError(RealT a, RealT b, RealT sum)
+  {
+    return std::fabs(a) >= std::fabs(b) ? (a - sum) + b : (b - sum) + a;
+  }
+};
+
+template <>
+struct ScalarOps<float> : RealScalarOps<float>
+{
+};
+
+template <>
+struct ScalarOps<long double> : RealScalarOps<long double>
+{
+};
+
+template <>
+struct ScalarOps<std::complex<double>>
+{
+  typedef std::complex<double> ComplexT;
+
+  static ComplexT Literal(double value)
+  {
+    return ComplexT(value, 0);
+  }
+
+  static ComplexT Literal(const ExprNode &node)
+  {
+    return ComplexT(node.value, 0);
+  }
+
+  static ComplexT ImagUnit()
+  {
+    return ComplexT(0, 1);
+  }
+
+  static ComplexT MulAdd(const ComplexT &a, const ComplexT &b, const ComplexT &c)
+  {
+    return a * b + c;
+  }
+
+  static ComplexT Pow(const ComplexT &a, const ComplexT &b)
+  {
+    return std::pow(a, b);
+  }
+
+  static ComplexT CalcOpId(ID_TYPE idType, const ComplexT &value)
+  {
+    PROFILE_COUNT(op_calls[idType], 1)
+
+    switch (idType)
+    {
+      case ID_SIN : return std::sin(value);
+      case ID_COS : return std::cos(value);
+      case ID_TAN : return std::tan(value);
+      case ID_COT : return 1.0 / std::tan(value);
+      case ID_SQRT: return std::sqrt(value);
+      case ID_LN  : return std::log(value);
+      case ID_NORM: return std::abs(value);
+      case NOT_ID : //fallthrough;
+      default     : return 0;
+    }
+  }
+
+  static ComplexT CalcOpId(ID_TYPE idType, const ComplexT &left, const ComplexT &right)
+  {
+    PROFILE_COUNT(op_calls[idType], 1)
+
+    switch (idType)
+    {
+      case ID_DOT   : //fallthrough;
+      case ID_MATMUL: return left * right;
+      case ID_MIN   : return right.real() < left.real() ? right : left;
+      case ID_MAX   : return right.real() > left.real() ? right : left;
+      default       : return 0;
+    }
+  }
+
+  static ComplexT Compare(NODE_TYPE type, const ComplexT &left, const ComplexT &right)
+  {
+    return ExprTree::Compare(type, left.real(), right.real());
+  }
+
+  static bool IsTrue(const ComplexT &value)
+  {
+    return value.real() != 0;
+  }
+
+  static bool IsFalse(const ComplexT &value)
+  {
+    return value.real() == 0;
+  }
+
+  static ComplexT Join(const ComplexT &a, const ComplexT &)
+  {
+    return a;
+  }
+
+  static ComplexT SumError(const ComplexT &a, const ComplexT &b, const ComplexT &sum)
+  {
+    return ComplexT(ScalarOps<double>::SumError(a.real(), b.real(), sum.real()),
+                    ScalarOps<double>::SumError(a.imag(), b.imag(), sum.imag()));
+  }
+};
+
+template <>
+struct ScalarOps<Interval>
+{
+  static Interval Literal(double value)
+  {
+    return Interval(value);
+  }
+
+  static Interval Literal(const ExprNode &node)
+  {
+    return IntervalLiteral(node);
+  }
+
+  static Interval ImagUnit()
+  {
+    return Interval::Empty();
+  }
+
+  static Interval MulAdd(const Interval &a, const Interval &b, const Interval &c)
+  {
+    return a * b + c;
+  }
+
+  static Interval Pow(const Interval &a, const Interval &b)
+  {
+    return IntervalPow(a, b);
+  }
+
+  static Interval CalcOpId(ID_TYPE idType, const Interval &value)
+  {
+    return IntervalOpId(idType, value);
+  }
+
+  static Interval CalcOpId(ID_TYPE idType, const Interval &left, const Interval &right)
+  {
+    return IntervalOpId(idType, left, right);
+  }
+
+  static Interval Compare(NODE_TYPE type, const Interval &left, const Interval &right)
+  {
+    return IntervalCompare(type, left, right);
+  }
+
+  static bool IsTrue(const Interval &value)
+  {
+    return !value.IsEmpty() && !value.Contains(0);
+  }
+
+  static bool IsFalse(const Interval &value)
+  {
+    return value.lo == 0 && value.hi == 0;
+  }
+
+  static Interval Join(const Interval &a, const Interval &b)
+  {
+    return IntervalJoin(a, b);
+  }
+
+  /* Bounds are rounded outwards already */
+  static Interval SumError(const Interval &, const Interval &, const Interval &)
+  {
+    return Interval(0);
+  }
+};
+
+#endif //CALCULATOR_SCALAR_OPS_H
@@ -0,0 +1,531 @@
+#include <cmath>
+#include <cstring>
+
+#include "vec_math.h"
+
+/* Constants of Cephes and fdlibm approximations */
+#define PI_2   1.57079632679489661923
+#define PI_4   0.78539816339744830962
+#define FOUR_PI 1.27323954473516268615 /* 4 / pi */
+#define DP1    7.85398125648498535156E-1  /* pi / 4 split into three parts for argument reduction */
+#define DP2    3.77489470793079817668E-8
+#define DP3    2.69515142907905952645E-15
+#define LOG2E  1.4426950408889634073599
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define SQRT2  1.41421356237309504880
+#define DP1_F  0.78515625f                /* pi / 4 split into three parts for single precision reduction */
+#define DP2_F  2.4187564849853515625e-4f
+#define DP3_F  3.77489497744594108e-8f
+
+#define SINCOS_MAX_ARG 1.0e5      /* Greater arguments are reduced by standard library */
+#define SINCOS_MAX_ARG_F 8192.0f  /* The same for single precision kernel */
+#define EXP_MAX_ARG    709.78     /* exp() overflows after it */
+#define EXP_MIN_ARG    (-745.13)  /* exp() is zero before it */
+#define ROUND_MAGIC    6755399441055744.0 /* 1.5 * 2^52, adding it rounds to integer */
+
+/* Number of arguments copied aside before kernel pass, so output arrays may coincide with input ones */
+#define VEC_CHUNK 256
+
+/* Kernels must be inlined into loops to be vectorized */
+#define VEC_INLINE inline __attribute__((always_inline))
+
+/* Reinterprets bits of double as integer */
+static VEC_INLINE long long AsBits(double value)
+{
+  long long bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/* Reinterprets bits of integer as double */
+static VEC_INLINE double AsDouble(long long bits)
+{
+  double value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Calculates sine and cosine of |x| <= SINCOS_MAX_ARG (Cephes sin.c scheme) */
+static VEC_INLINE void SinCosKernel(double x, double &out_sin, double &out_cos)
+{
+  double ax = fabs(x);
+  int octant = (int)(ax * FOUR_PI);
+  octant += octant & 1;
+
+  double y = octant;
+  double z = ((ax - y * DP1) - y * DP2) - y * DP3;
+  double zz = z * z;
+
+  double poly_sin = 1.58962301576546568060E-10;
+  poly_sin = poly_sin * zz - 2.50507477628578072866E-8;
+  poly_sin = poly_sin * zz + 2.75573136213857245213E-6;
+  poly_sin = poly_sin * zz - 1.98412698295895385996E-4;
+  poly_sin = poly_sin * zz + 8.33333333332211858878E-3;
+  poly_sin = poly_sin * zz - 1.66666666666666307295E-1;
+  poly_sin = z + z * zz * poly_sin;
+
+  double poly_cos = -1.13585365213876817300E-11;
+  poly_cos = poly_cos * zz + 2.08757008419747316778E-9;
+  poly_cos = poly_cos * zz - 2.75573141792967388112E-7;
+  poly_cos = poly_cos * zz + 2.48015872888517045348E-5;
+  poly_cos = poly_cos * zz - 1.38888888888730564116E-3;
+  poly_cos = poly_cos * zz + 4.16666666666665929218E-2;
+  poly_cos = 1.0 - 0.5 * zz + zz * zz * poly_cos;
+
+  int quadrant = octant & 7;
+  bool is_swapped = (quadrant & 2) != 0;
+
+  double s = is_swapped ? poly_cos : poly_sin;
+  double c = is_swapped ? poly_sin : poly_cos;
+
+  s = (quadrant & 4) != 0 ? -s : s;
+  s = std::signbit(x) ? -s : s;
+  c = ((quadrant + 2) & 4) != 0 ? -c : c;
+
+  out_sin = s;
+  out_cos = c;
+}
+
+/* Calculates exponent of x in [EXP_MIN_ARG, EXP_MAX_ARG] (Cephes exp.c scheme) */
+static VEC_INLINE double ExpKernel(double x)
+{
+  double rounded = x * LOG2E + ROUND_MAGIC;
+  int power = (int)AsBits(rounded);
+  double px = rounded - ROUND_MAGIC;
+
+  x -= px * 6.93145751953125E-1;
+  x -= px * 1.42860682030941723212E-6;
+
+  double xx = x * x;
+  double num = 1.26177193074810590878E-4;
+  num = num * xx + 3.02994407707441961300E-2;
+  num = num * xx + 9.99999999999999999910E-1;
+  num *= x;
+
+  double den = 3.00198505138664455042E-6;
+  den = den * xx + 2.52448340349684104192E-3;
+  den = den * xx + 2.27265548208155028766E-1;
+  den = den * xx + 2.00000000000000000009E0;
+
+  double result = 1.0 + 2.0 * (num / (den - num));
+
+  /* scaling by 2^power is split into two multiplications to reach subnormal results */
+  int half = power / 2;
+  result *= AsDouble((long long)(half + 1023) << 52);
+  result *= AsDouble((long long)(power - half + 1023) << 52);
+  return result;
+}
+
+/* Calculates logarithm of normal positive x (fdlibm e_log.c scheme) */
+static VEC_INLINE double LogKernel(double x)
+{
+  long long bits = AsBits(x);
+  int power = (int)((bits >> 52) & 0x7ff) - 1023;
+  double mantissa = AsDouble((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+
+  bool is_big = mantissa > SQRT2;
+  mantissa = is_big ? mantissa * 0.5 : mantissa;
+  power = is_big ? power + 1 : power;
+
+  double f = mantissa - 1.0;
+  double s = f / (2.0 + f);
+  double z = s * s;
+  double w = z * z;
+  double t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+  double t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 +
+                   w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+  double r = t1 + t2;
+  double hfsq = 0.5 * f * f;
+  double dk = power;
+
+  return dk * LN2_HI - ((hfsq - (s * (hfsq + r) + dk * LN2_LO)) - f);
+}
+
+/* Calculates arctangent of x >= 0 (Cephes atan.c scheme) */
+static VEC_INLINE double AtanKernel(double x)
+{
+  bool is_big = x > 2.41421356237309504880;
+  bool is_mid = !is_big && x > 0.66;
+
+  double y = is_big ? PI_2 : (is_mid ? PI_4 : 0.0);
+  double more_bits = is_big ? 6.123233995736765886130E-17 : (is_mid ? 0.5 * 6.123233995736765886130E-17 : 0.0);
+  x = is_big ? -1.0 / x : (is_mid ? (x - 1.0) / (x + 1.0) : x);
+
+  double z = x * x;
+  double num = -8.750608600031904122785E-1;
+  num = num * z - 1.615753718733365076637E1;
+  num = num * z - 7.500855792314704667340E1;
+  num = num * z - 1.228866684490136173410E2;
+  num = num * z - 6.485021904942025371773E1;
+
+  double den = z + 2.485846490142306297962E1;
+  den = den * z + 1.650270098316988542046E2;
+  den = den * z + 4.328810604912902668951E2;
+  den = den * z + 4.853903996359136964868E2;
+  den = den * z + 1.945506571482613964425E2;
+
+  z = z * num / den;
+  return y + (x * z + x + more_bits);
+}
+
+/* Checks if sine and cosine kernel can be applied */
+static VEC_INLINE bool IsSinCosArg(double x)
+{
+  return fabs(x) <= SINCOS_MAX_ARG;
+}
+
+/* Checks if logarithm kernel can be applied */
+static VEC_INLINE bool IsLogArg(double x)
+{
+  return x >= 2.2250738585072014e-308 && x <= 1.7976931348623157e308;
+}
+
+/* Checks if arctangent kernel can be applied to pair of arguments */
+static VEC_INLINE bool IsAtan2Arg(double y, double x)
+{
+  return fabs(y) <= 1.7976931348623157e308 && fabs(x) <= 1.7976931348623157e308 && (x != 0 || y != 0);
+}
+
+/* Reinterprets bits of float as integer */
+static VEC_INLINE int AsBitsF(float value)
+{
+  int bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/* Reinterprets bits of integer as float */
+static VEC_INLINE float AsFloat(int bits)
+{
+  float value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Calculates sine and cosine of |x| <= SINCOS_MAX_ARG_F in single precision (Cephes sinf.c scheme) */
+static VEC_INLINE void SinCosKernelF(float x, float &out_sin, float &out_cos)
+{
+  float ax = fabsf(x);
+  int octant = (int)(ax * (float)FOUR_PI);
+  octant += octant & 1;
+
+  float y = (float)octant;
+  float z = ((ax - y * DP1_F) - y * DP2_F) - y * DP3_F;
+  float zz = z * z;
+
+  float poly_sin = -1.9515295891E-4f;
+  poly_sin = poly_sin * zz + 8.3321608736E-3f;
+  poly_sin = poly_sin * zz - 1.6666654611E-1f;
+  poly_sin = z + z * zz * poly_sin;
+
+  float poly_cos = 2.443315711809948E-5f;
+  poly_cos = poly_cos * zz - 1.388731625493765E-3f;
+  poly_cos = poly_cos * zz + 4.166664568298827E-2f;
+  poly_cos = 1.0f - 0.5f * zz + zz * zz * poly_cos;
+
+  int quadrant = octant & 7;
+  bool is_swapped = (quadrant & 2) != 0;
+
+  float s = is_swapped ? poly_cos : poly_sin;
+  float c = is_swapped ? poly_sin : poly_cos;
+
+  s = (quadrant & 4) != 0 ? -s : s;
+  s = std::signbit(x) ? -s : s;
+  c = ((quadrant + 2) & 4) != 0 ? -c : c;
+
+  out_sin = s;
+  out_cos = c;
+}
+
+/* Calculates logarithm of normal positive x in single precision (Cephes logf.c scheme) */
+static VEC_INLINE float LogKernelF(float x)
+{
+  int bits = AsBitsF(x);
+  int power = ((bits >> 23) & 0xff) - 127;
+  float mantissa = AsFloat((bits & 0x007fffff) | 0x3f800000);
+
+  bool is_big = mantissa > (float)SQRT2;
+  mantissa = is_big ? mantissa * 0.5f : mantissa;
+  power = is_big ? power + 1 : power;
+
+  float f = mantissa - 1.0f;
+  float z = f * f;
+  float poly = 7.0376836292E-2f;
+  poly = poly * f - 1.1514610310E-1f;
+  poly = poly * f + 1.1676998740E-1f;
+  poly = poly * f - 1.2420140846E-1f;
+  poly = poly * f + 1.4249322787E-1f;
+  poly = poly * f - 1.6668057665E-1f;
+  poly = poly * f + 2.0000714765E-1f;
+  poly = poly * f - 2.4999993993E-1f;
+  poly = poly * f + 3.3333331174E-1f;
+
+  float dk = (float)power;
+  float result = f * z * poly - 2.12194440E-4f * dk - 0.5f * z;
+  return (f + result) + 0.693359375f * dk;
+}
+
+/* Checks if single precision sine and cosine kernel can be applied */
+static VEC_INLINE bool IsSinCosArgF(float x)
+{
+  return fabsf(x) <= SINCOS_MAX_ARG_F;
+}
+
+/* Checks if single precision logarithm kernel can be applied */
+static VEC_INLINE bool IsLogArgF(float x)
+{
+  return x >= 1.17549435e-38f && x <= 3.40282347e38f;
+}
+
+/* Applies 'kernel' to every argument, then recalculates arguments rejected by 'is_arg' with 'fallback'.
+ * 'kernel' must accept any argument without branches */
+template <typename RealT, typename KernelT, typename CheckT, typename FallbackT>
+static VEC_INLINE void ApplyKernel(const RealT *x, RealT *out, size_t count,
+                                   KernelT kernel, CheckT is_arg, FallbackT fallback)
+{
+  RealT args[VEC_CHUNK];
+
+  for (size_t start = 0; start < count; start += VEC_CHUNK)
+  {
+    size_t n = count - start < VEC_CHUNK ? count - start : VEC_CHUNK;
+    memcpy(args, x + start, n * sizeof(RealT));
+
+    for (size_t i = 0; i < n; i++)
+    {
+      out[start + i] = kernel(args[i]);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+      if (!is_arg(args[i])) { out[start + i] = fallback(args[i]); }
+    }
+  }
+}
+
+void VecSinCos(const double *x, double *out_sin, double *out_cos, size_t count)
+{
+  double args[VEC_CHUNK];
+
+  for (size_t start = 0; start < count; start += VEC_CHUNK)
+  {
+    size_t n = count - start < VEC_CHUNK ? count - start : VEC_CHUNK;
+    memcpy(args, x + start, n * sizeof(double));
+
+    for (size_t i = 0; i < n; i++)
+    {
+      double arg = IsSinCosArg(args[i]) ? args[i] : 0.0;
+      SinCosKernel(arg, out_sin[start + i], out_cos[start + i]);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+      if (!IsSinCosArg(args[i]))
+      {
+        out_sin[start + i] = sin(args[i]);
+        out_cos[start + i] = cos(args[i]);
+      }
+    }
+  }
+}
+
+void VecSin(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](double arg) { double s = 0, c = 0; SinCosKernel(IsSinCosArg(arg) ? arg : 0.0, s, c); return s; },
+              IsSinCosArg, [](double arg) { return sin(arg); });
+}
+
+void VecCos(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](double arg) { double s = 0, c = 0; SinCosKernel(IsSinCosArg(arg) ? arg : 0.0, s, c); return c; },
+              IsSinCosArg, [](double arg) { return cos(arg); });
+}
+
+void VecTan(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](double arg) { double s = 0, c = 0; SinCosKernel(IsSinCosArg(arg) ? arg : 0.0, s, c); return s / c; },
+              IsSinCosArg, [](double arg) { return tan(arg); });
+}
+
+void VecCot(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](double arg) { double s = 0, c = 0; SinCosKernel(IsSinCosArg(arg) ? arg : 0.0, s, c); return c / s; },
+              IsSinCosArg, [](double arg) { return 1.0 / tan(arg); });
+}
+
+void VecSqrt(const double *x, double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    out[i] = sqrt(x[i]);
+  }
+}
+
+void VecExp(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](double arg)
+              {
+                double result = ExpKernel(arg < EXP_MIN_ARG ? EXP_MIN_ARG : (arg > EXP_MAX_ARG ? EXP_MAX_ARG : arg));
+                result = arg < EXP_MIN_ARG ? 0.0 : result;
+                return arg > EXP_MAX_ARG ? HUGE_VAL : result;
+              },
+              [](double arg) { return !std::isnan(arg); }, [](double arg) { return arg; });
+}
+
+void VecLog(const double *x, double *out, size_t count)
+{
+  ApplyKernel(x, out, count, [](double arg) { return LogKernel(IsLogArg(arg) ? arg : 1.0); },
+              IsLogArg, [](double arg) { return log(arg); });
+}
+
+void VecAtan2(const double *y, const double *x, double *out, size_t count)
+{
+  double args_y[VEC_CHUNK], args_x[VEC_CHUNK];
+
+  for (size_t start = 0; start < count; start += VEC_CHUNK)
+  {
+    size_t n = count - start < VEC_CHUNK ? count - start : VEC_CHUNK;
+    memcpy(args_y, y + start, n * sizeof(double));
+    memcpy(args_x, x + start, n * sizeof(double));
+
+    for (size_t i = 0; i < n; i++)
+    {
+      double ax = fabs(args_x[i]), ay = fabs(args_y[i]);
+      bool is_steep = ay > ax;
+
+      /* ratio in [0, 1] keeps arctangent argument finite */
+      double ratio = is_steep ? ax / ay : ay / (ax != 0 ? ax : 1.0);
+      double angle = AtanKernel(ratio);
+
+      angle = is_steep ? PI_2 - angle : angle;
+      angle = args_x[i] < 0 ? 2 * PI_2 - angle : angle;
+      out[start + i] = copysign(angle, args_y[i]);
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+      if (!IsAtan2Arg(args_y[i], args_x[i])) { out[start + i] = atan2(args_y[i], args_x[i]); }
+    }
+  }
+}
+
+void VecSumStep(double *sum, double *error, const double *term, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    double old_sum = sum[i], value = term[i];
+    double new_sum = old_sum + value;
+    double big = fabs(old_sum) >= fabs(value) ? old_sum : value;
+    double small = fabs(old_sum) >= fabs(value) ? value : old_sum;
+
+    error[i] += (big - new_sum) + small;
+    sum[i] = new_sum;
+  }
+}
+
+void VecSin(const float *x, float *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](float arg) { float s = 0, c = 0; SinCosKernelF(IsSinCosArgF(arg) ? arg : 0.0f, s, c); return s; },
+              IsSinCosArgF, [](float arg) { return sinf(arg); });
+}
+
+void VecCos(const float *x, float *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](float arg) { float s = 0, c = 0; SinCosKernelF(IsSinCosArgF(arg) ? arg : 0.0f, s, c); return c; },
+              IsSinCosArgF, [](float arg) { return cosf(arg); });
+}
+
+void VecTan(const float *x, float *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](float arg) { float s = 0, c = 0; SinCosKernelF(IsSinCosArgF(arg) ? arg : 0.0f, s, c); return s / c; },
+              IsSinCosArgF, [](float arg) { return tanf(arg); });
+}
+
+void VecCot(const float *x, float *out, size_t count)
+{
+  ApplyKernel(x, out, count,
+              [](float arg) { float s = 0, c = 0; SinCosKernelF(IsSinCosArgF(arg) ? arg : 0.0f, s, c); return c / s; },
+              IsSinCosArgF, [](float arg) { return 1.0f / tanf(arg); });
+}
+
+void VecSqrt(const float *x, float *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    out[i] = sqrtf(x[i]);
+  }
+}
+
+void VecLog(const float *x, float *out, size_t count)
+{
+  ApplyKernel(x, out, count, [](float arg) { return LogKernelF(IsLogArgF(arg) ? arg : 1.0f); },
+              IsLogArgF, [](float arg) { return logf(arg); });
+}
+
+void VecSumStep(float *sum, float *error, const float *term, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    float old_sum = sum[i], value = term[i];
+    float new_sum = old_sum + value;
+    float big = fabsf(old_sum) >= fabsf(value) ? old_sum : value;
+    float small = fabsf(old_sum) >= fabsf(value) ? value : old_sum;
+
+    error[i] += (big - new_sum) + small;
+    sum[i] = new_sum;
+  }
+}
+
+/* Extended precision kernels call standard library, as there are no vector instructions for it */
+
+void VecSin(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = sinl(x[i]); }
+}
+
+void VecCos(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = cosl(x[i]); }
+}
+
+void VecTan(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = tanl(x[i]); }
+}
+
+void VecCot(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = 1.0L / tanl(x[i]); }
+}
+
+void VecSqrt(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = sqrtl(x[i]); }
+}
+
+void VecLog(const long double *x, long double *out, size_t count)
+{
+  for (size_t i = 0; i < count; i++) { out[i] = logl(x[i]); }
+}
+
+void VecSumStep(long double *sum, long double *error, const long double *term, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    long double old_sum = sum[i], value = term[i];
+    long double new_sum = old_sum + value;
+    long double big = fabsl(old_sum) >= fabsl(value) ? old_sum : value;
+    long double small = fabsl(old_sum) >= fabsl(value) ? value : old_sum;
+
+    error[i] += (big - new_sum) + small;
+    sum[i] = new_sum;
+  }
+}
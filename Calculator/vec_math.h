@@ -0,0 +1,48 @@
+#ifndef CALCULATOR_VEC_MATH_H
+#define CALCULATOR_VEC_MATH_H
+
+#include <cstddef>
+
+/***
+ * Elementwise math kernels over 'double' arrays.
+ *
+ * Kernels are written without calls and branches in the main loop, so compiler vectorizes them
+ * for the target instruction set. Arguments out of kernel range (huge, infinite, NaN, non-positive for 'VecLog')
+ * are calculated by standard library functions in a separate pass.
+ * Input and output arrays may coincide, but must not partially overlap.
+ *
+ * Single precision kernels use approximations of single precision accuracy, so vectors hold twice as many lanes.
+ * Extended precision kernels are loops over standard library functions.
+ */
+
+void VecSinCos(const double *x, double *out_sin, double *out_cos, size_t count);
+void VecSin(const double *x, double *out, size_t count);
+void VecCos(const double *x, double *out, size_t count);
+void VecTan(const double *x, double *out, size_t count);
+void VecCot(const double *x, double *out, size_t count);
+void VecSqrt(const double *x, double *out, size_t count);
+void VecExp(const double *x, double *out, size_t count);
+void VecLog(const double *x, double *out, size_t count);
+void VecAtan2(const double *y, const double *x, double *out, size_t count);
+
+/* Adds 'term' to compensated sums 'sum + error' elementwise (Neumaier scheme): rounding error of every
+ * addition is accumulated in 'error', which is added to 'sum' once at the end of summation */
+void VecSumStep(double *sum, double *error, const double *term, size_t count);
+
+void VecSin(const float *x, float *out, size_t count);
+void VecCos(const float *x, float *out, size_t count);
+void VecTan(const float *x, float *out, size_t count);
+void VecCot(const float *x, float *out, size_t count);
+void VecSqrt(const float *x, float *out, size_t count);
+void VecLog(const float *x, float *out, size_t count);
+void VecSumStep(float *sum, float *error, const float *term, size_t count);
+
+void VecSin(const long double *x, long double *out, size_t count);
+void VecCos(const long double *x, long double *out, size_t count);
+void VecTan(const long double *x, long double *out, size_t count);
+void VecCot(const long double *x, long double *out, size_t count);
+void VecSqrt(const long double *x, long double *out, size_t count);
+void VecLog(const long double *x, long double *out, size_t count);
+void VecSumStep(long double *sum, long double *error, const long double *term, size_t count);
+
+#endif //CALCULATOR_VEC_MATH_H
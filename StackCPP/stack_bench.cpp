@@ -0,0 +1,610 @@
+/***
+ * Stack benchmarks.
+ *
+ * Build: g++ -std=c++14 -O2 [-msse4.2] stack_bench.cpp error_functions.cpp -o stack_bench
+ */
+
+#include <iostream>
+
+#define STACK_CANARY_PROTECTION
+#define STACK_HASH_PROTECTION
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "stack_functions.h"
+
+/***
+ * Element of 64 bytes for hash benchmark of large elements
+ */
+struct BigElem
+{
+  double values[8];
+
+  BigElem(int value = 0)
+  {
+    for (double &elem : values)
+    {
+      elem = value;
+    }
+  }
+};
+
+std::ostream &operator<<(std::ostream &os, const BigElem &elem)
+{
+  return os << elem.values[0];
+}
+
+/***
+ * Returns time in seconds since some moment
+ */
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/***
+ * Compares byte loop and word-at-a-time hash kernels on a large buffer
+ *
+ * @param size_t buf_size - size of buffer in bytes
+ */
+static void RunKernelBench(size_t buf_size)
+{
+  std::vector<uchar> buffer(buf_size);
+  for (size_t i = 0; i < buf_size; i++)
+  {
+    buffer[i] = (uchar)(i * 131 + (i >> 8));
+  }
+
+  double start = Now();
+  HashT bytes_hash = HashBufferBytes(buffer.data(), buf_size);
+  double bytes_time = Now() - start;
+
+  start = Now();
+  HashT words_hash = HashBuffer(buffer.data(), buf_size);
+  double words_time = Now() - start;
+
+  printf("Kernel on %zu MB buffer:\n", buf_size >> 20u);
+  printf("  byte loop      - %8.2f ms, %6.2f GB/s (hash %llx)\n", bytes_time * 1e3, buf_size / bytes_time * 1e-9,
+         bytes_hash);
+  printf("  word-at-a-time - %8.2f ms, %6.2f GB/s (hash %llx)\n", words_time * 1e3, buf_size / words_time * 1e-9,
+         words_hash);
+}
+
+/***
+ * Measures full verification of a stack of 'count' elements with 'StackOK' and the same
+ * position-keyed sum calculated with byte loop kernel
+ *
+ * @param const char *name - element type name to print
+ * @param size_t count     - number of elements
+ */
+template <typename ElemT>
+static void RunVerifyBench(const char *name, size_t count)
+{
+  StackT<ElemT> stk(count, VarInfo("stk", CURR_LOCATION));
+  std::vector<ElemT> copy;
+  copy.reserve(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    stk.Push(ElemT((int)i));
+    copy.push_back(ElemT((int)i));
+  }
+
+  double start = Now();
+  HashT bytes_hash = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    bytes_hash += HashMix(HashBufferBytes(&copy[i], sizeof(ElemT)) + (i + 1) * 0x9E3779B97F4A7C15ull);
+  }
+  double bytes_time = Now() - start;
+
+  start = Now();
+  ERR_CODE code = stk.StackOK();
+  double words_time = Now() - start;
+
+  double bytes = (double)count * sizeof(ElemT);
+  printf("Full verification of %zu elements of %s:\n", count, name);
+  printf("  byte loop      - %8.2f ms, %6.2f GB/s (hash %llx)\n", bytes_time * 1e3, bytes / bytes_time * 1e-9,
+         bytes_hash);
+  printf("  StackOK        - %8.2f ms, %6.2f GB/s (", words_time * 1e3, bytes / words_time * 1e-9);
+  print_err(std::cout, code);
+}
+
+/***
+ * Measures push and pop of 'count' elements with every verification level
+ *
+ * @param size_t count - number of elements
+ */
+static void RunVerifyLevelBench(size_t count)
+{
+  const char *names[] = {"off", "cheap", "scrub", "sampled", "paranoid"};
+  STACK_VERIFY levels[] = {STACK_VERIFY_OFF, STACK_VERIFY_CHEAP, STACK_VERIFY_SCRUB, STACK_VERIFY_SAMPLED,
+                           STACK_VERIFY_PARANOID};
+
+  printf("Push and pop of %zu elements of int by verification level:\n", count);
+  for (size_t level = 0; level < sizeof(levels) / sizeof(levels[0]); level++)
+  {
+    // paranoid level is quadratic, so it is measured on a smaller stack
+    size_t level_count = levels[level] == STACK_VERIFY_PARANOID ? count / 256 : count;
+    StackT<int> stk(VarInfo("stk", CURR_LOCATION));
+    stk.SetVerifyLevel(levels[level]);
+
+    double start = Now();
+    for (size_t i = 0; i < level_count; i++)
+    {
+      stk.Push((int)i);
+    }
+
+    int value = 0;
+    for (size_t i = 0; i < level_count; i++)
+    {
+      stk.Pop(&value);
+    }
+    double time = Now() - start;
+
+    const StackCheckCounters &counters = stk.GetCheckCounters();
+    printf("  %-8s - %8.2f ns/op (%zu elements; checks: %zu cheap, %zu scrub, %zu full)\n", names[level],
+           time / (2.0 * level_count) * 1e9, level_count, counters.cheap, counters.scrub, counters.full);
+  }
+}
+
+/***
+ * Stack of int with the same algorithm as 'StackT' without any policies, reference for policy costs
+ */
+class PlainStack
+{
+private:
+  int *data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+
+public:
+  PlainStack(size_t init_capacity, const VarInfo &) : data((int *)malloc(init_capacity * sizeof(int))),
+                                                     capacity(init_capacity)
+  {
+  }
+
+  PlainStack(const PlainStack &)
+  = delete;
+
+  ~PlainStack()
+  {
+    free(data);
+  }
+
+  ERR_CODE Push(int value)
+  {
+    if (size == capacity)
+    {
+      auto ptr = (int *)realloc(data, (size == 0 ? 1 : size * 2) * sizeof(int));
+      if (ptr == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+      data = ptr;
+      capacity = size == 0 ? 1 : size * 2;
+    }
+
+    data[size++] = value;
+    return SUCCESS;
+  }
+
+  ERR_CODE Pop(int *receiver)
+  {
+    if (size == 0)
+    {
+      return FAILURE;
+    }
+
+    *receiver = data[size - 1];
+    data[size - 1] = 0;
+    size--;
+    return SUCCESS;
+  }
+};
+
+/***
+ * Measures push and pop of 'count' elements on stack 'StackType', repeated 'repeats' times
+ *
+ * @return double - time of one operation in nanoseconds
+ */
+template <typename StackType>
+static double MeasurePushPop(size_t count, size_t repeats)
+{
+  StackType stk(count, VarInfo("stk", CURR_LOCATION));
+  int value = 0;
+  long long sum = 0;
+
+  double start = Now();
+  for (size_t repeat = 0; repeat < repeats; repeat++)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      stk.Push((int)i);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      stk.Pop(&value);
+      sum += value;
+    }
+  }
+  double time = Now() - start;
+
+  if (sum == 0)
+  {
+    printf("Unexpected sum\n");
+  }
+
+  return time / (2.0 * count * repeats) * 1e9;
+}
+
+/***
+ * Compares stack without protection policies with plain array and protected stacks
+ *
+ * @param size_t count - number of elements
+ */
+static void RunPolicyBench(size_t count)
+{
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff> FastStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyFixed<STACK_VERIFY_CHEAP>> CheapStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic> DynamicStackT;
+  const size_t repeats = 64;
+
+  printf("Push and pop of %zu elements of int by policies:\n", count);
+  printf("  hand-written stack             - %6.2f ns/op, sizeof %zu\n", MeasurePushPop<PlainStack>(count, repeats),
+         sizeof(PlainStack));
+  printf("  no protection, no checks       - %6.2f ns/op, sizeof %zu\n", MeasurePushPop<FastStackT>(count, repeats),
+         sizeof(FastStackT));
+  printf("  canaries and hash, cheap check - %6.2f ns/op, sizeof %zu\n", MeasurePushPop<CheapStackT>(count, repeats),
+         sizeof(CheapStackT));
+  printf("  canaries and hash, scrub check - %6.2f ns/op, sizeof %zu\n",
+         MeasurePushPop<DynamicStackT>(count, repeats), sizeof(DynamicStackT));
+}
+
+/***
+ * Measures creation of a stack, 'count' pushes and pops and destruction, repeated 'repeats' times
+ *
+ * @return double - time of one stack life in nanoseconds
+ */
+template <typename StackType>
+static double MeasureShortLived(size_t count, size_t repeats)
+{
+  long long sum = 0;
+
+  double start = Now();
+  for (size_t repeat = 0; repeat < repeats; repeat++)
+  {
+    StackType stk;
+    int value = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      stk.Push((int)(i + repeat));
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      stk.Pop(&value);
+      sum += value;
+    }
+  }
+  double time = Now() - start;
+
+  if (sum == 0)
+  {
+    printf("Unexpected sum\n");
+  }
+
+  return time / repeats * 1e9;
+}
+
+/***
+ * Compares short-lived stacks with heap and inline storage
+ *
+ * @param size_t count - number of elements pushed into every stack
+ */
+static void RunSmallBench(size_t count)
+{
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackHeapStorage> FastHeapStackT;
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackSmallStorage<16>> FastSmallStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackHeapStorage> HeapStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackSmallStorage<16>> SmallStackT;
+  const size_t repeats = 1u << 20u;
+
+  printf("Short-lived stack with %zu pushes and pops:\n", count);
+  printf("  no protection, heap storage       - %7.2f ns\n", MeasureShortLived<FastHeapStackT>(count, repeats));
+  printf("  no protection, inline storage     - %7.2f ns\n", MeasureShortLived<FastSmallStackT>(count, repeats));
+  printf("  canaries and hash, heap storage   - %7.2f ns\n", MeasureShortLived<HeapStackT>(count, repeats));
+  printf("  canaries and hash, inline storage - %7.2f ns\n", MeasureShortLived<SmallStackT>(count, repeats));
+}
+
+/***
+ * Compares short-lived stacks with 'malloc' and pool allocators
+ *
+ * @param size_t count - number of elements pushed into every stack
+ */
+static void RunPoolBench(size_t count)
+{
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackHeapStorage, StackMallocAllocator>
+    FastMallocStackT;
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackHeapStorage, StackPoolAllocator>
+    FastPoolStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackHeapStorage, StackMallocAllocator>
+    MallocStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackHeapStorage, StackPoolAllocator>
+    PoolStackT;
+  const size_t repeats = 1u << 18u;
+
+  printf("Short-lived stack with %zu pushes and pops by allocator:\n", count);
+  printf("  no protection, malloc allocator     - %8.2f ns\n", MeasureShortLived<FastMallocStackT>(count, repeats));
+  printf("  no protection, pool allocator       - %8.2f ns\n", MeasureShortLived<FastPoolStackT>(count, repeats));
+  printf("  canaries and hash, malloc allocator - %8.2f ns\n", MeasureShortLived<MallocStackT>(count, repeats));
+  printf("  canaries and hash, pool allocator   - %8.2f ns\n", MeasureShortLived<PoolStackT>(count, repeats));
+}
+
+/***
+ * Measures push and pop of batches of 'count' elements on stack 'StackType' one by one or by 'PushN' and 'PopN'
+ *
+ * @return double - time of one element push and pop in nanoseconds
+ */
+template <typename StackType>
+static double MeasureBatches(size_t count, size_t repeats, bool bulk)
+{
+  StackType stk(VarInfo("stk", CURR_LOCATION));
+  std::vector<int> batch(count);
+  long long sum = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    batch[i] = (int)i;
+  }
+
+  double start = Now();
+  for (size_t repeat = 0; repeat < repeats; repeat++)
+  {
+    if (bulk)
+    {
+      stk.PushN(batch.data(), count);
+      stk.PopN(batch.data(), count);
+    }
+    else
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        stk.Push(batch[i]);
+      }
+
+      for (size_t i = count; i > 0; i--)
+      {
+        stk.Pop(&batch[i - 1]);
+      }
+    }
+    sum += batch[count - 1];
+  }
+  double time = Now() - start;
+
+  if (sum == 0)
+  {
+    printf("Unexpected sum\n");
+  }
+
+  return time / (2.0 * count * repeats) * 1e9;
+}
+
+/***
+ * Compares pushes and pops of batches one by one and by bulk operations
+ *
+ * @param size_t count - number of elements in batch
+ */
+static void RunBulkBench(size_t count)
+{
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff> FastStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic> ProtectedStackT;
+  const size_t repeats = 4096;
+
+  printf("Push and pop of batches of %zu elements of int:\n", count);
+  printf("  no protection, one by one     - %6.2f ns/elem\n", MeasureBatches<FastStackT>(count, repeats, false));
+  printf("  no protection, bulk           - %6.2f ns/elem\n", MeasureBatches<FastStackT>(count, repeats, true));
+  printf("  canaries and hash, one by one - %6.2f ns/elem\n", MeasureBatches<ProtectedStackT>(count, repeats, false));
+  printf("  canaries and hash, bulk       - %6.2f ns/elem\n", MeasureBatches<ProtectedStackT>(count, repeats, true));
+}
+
+#ifdef STACK_GUARD_PAGES
+/***
+ * Compares protection of buffer bounds by canaries checked on every operation and by guard pages
+ *
+ * @param size_t count - number of elements
+ */
+static void RunGuardBench(size_t count)
+{
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackHeapStorage> FastStackT;
+  typedef StackT<int, StackCanaryOn, StackHashOff, StackVerifyFixed<STACK_VERIFY_CHEAP>, StackHeapStorage>
+    CanaryStackT;
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff, StackGuardedStorage> GuardedStackT;
+  const size_t repeats = 64;
+
+  printf("Push and pop of %zu elements of int by buffer bounds protection:\n", count);
+  printf("  no protection              - %6.2f ns/op\n", MeasurePushPop<FastStackT>(count, repeats));
+  printf("  canaries, cheap check      - %6.2f ns/op\n", MeasurePushPop<CanaryStackT>(count, repeats));
+  printf("  guard pages, no checks     - %6.2f ns/op\n", MeasurePushPop<GuardedStackT>(count, repeats));
+}
+#endif //STACK_GUARD_PAGES
+
+/***
+ * Element which counts its copies and moves
+ */
+struct CountedElem
+{
+  static size_t copies;
+  static size_t moves;
+
+  std::string name;
+
+  CountedElem(size_t length = 0) : name(length, 'x')
+  {
+  }
+
+  CountedElem(const CountedElem &other) : name(other.name)
+  {
+    copies++;
+  }
+
+  CountedElem(CountedElem &&other) noexcept : name(std::move(other.name))
+  {
+    moves++;
+  }
+
+  CountedElem &operator=(const CountedElem &other)
+  {
+    name = other.name;
+    copies++;
+    return *this;
+  }
+
+  CountedElem &operator=(CountedElem &&other) noexcept
+  {
+    name = std::move(other.name);
+    moves++;
+    return *this;
+  }
+};
+
+size_t CountedElem::copies = 0;
+size_t CountedElem::moves = 0;
+
+std::ostream &operator<<(std::ostream &os, const CountedElem &elem)
+{
+  return os << elem.name;
+}
+
+/***
+ * Measures push of copied, moved and emplaced non-trivial elements and pop of 'count' elements
+ *
+ * @param size_t count  - number of elements
+ * @param size_t length - length of string in every element, long strings are kept in the heap
+ */
+static void RunMoveBench(size_t count, size_t length)
+{
+  const char *names[] = {"copy", "move", "emplace"};
+
+  printf("Push and pop of %zu elements with string of %zu chars:\n", count, length);
+  for (int mode = 0; mode < 3; mode++)
+  {
+    StackT<CountedElem> stk(VarInfo("stk", CURR_LOCATION));
+    CountedElem elem(length);
+    CountedElem value;
+    CountedElem::copies = 0;
+    CountedElem::moves = 0;
+
+    double start = Now();
+    for (size_t i = 0; i < count; i++)
+    {
+      if (mode == 0)
+      {
+        stk.Push(elem);
+      }
+      else if (mode == 1)
+      {
+        CountedElem tmp(length);
+        stk.Push(std::move(tmp));
+      }
+      else
+      {
+        stk.EmplacePush(length);
+      }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      stk.Pop(&value);
+    }
+    double time = Now() - start;
+
+    printf("  %-7s - %8.2f ns/op (%zu copies, %zu moves)\n", names[mode], time / (2.0 * count) * 1e9,
+           CountedElem::copies, CountedElem::moves);
+  }
+}
+
+/***
+ * Measures 'count' pushes and pops on stack 'StackType', prints mean and the worst push time
+ *
+ * @param const char *name - stack name to print
+ * @param size_t count     - number of elements
+ */
+template <typename StackType, typename ElemT>
+static void MeasureGrowth(const char *name, size_t count)
+{
+  StackType stk(VarInfo("stk", CURR_LOCATION));
+  double worst_push = 0;
+  ElemT value = ElemT();
+
+  double start = Now();
+  for (size_t i = 0; i < count; i++)
+  {
+    double push_start = Now();
+    stk.Push(value);
+    double push_time = Now() - push_start;
+
+    if (push_time > worst_push)
+    {
+      worst_push = push_time;
+    }
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    stk.Pop(&value);
+  }
+  double time = Now() - start;
+
+  printf("  %-9s - %6.2f ns/op, the worst push %8.3f ms\n", name, time / (2.0 * count) * 1e9, worst_push * 1e3);
+}
+
+/***
+ * Compares growth of stacks with doubling heap storage and segmented storage
+ *
+ * @param const char *name - element type name to print
+ * @param size_t count     - number of elements
+ */
+template <typename ElemT>
+static void RunSegmentedBench(const char *name, size_t count)
+{
+  typedef StackT<ElemT, StackCanaryOff, StackHashOff, StackVerifyOff, StackHeapStorage> HeapStackT;
+  typedef StackT<ElemT, StackCanaryOff, StackHashOff, StackVerifyOff, StackSegmentedStorage<4096>> SegmentedStackT;
+
+  printf("Push and pop of %zu elements of %s from empty stack (timer included):\n", count, name);
+  MeasureGrowth<HeapStackT, ElemT>("heap", count);
+  MeasureGrowth<SegmentedStackT, ElemT>("segmented", count);
+}
+
+int main()
+{
+  #ifdef STACK_HASH_CRC32C
+  printf("Hash kernel : CRC32C\n\n");
+  #else
+  printf("Hash kernel : multiply-mix\n\n");
+  #endif //STACK_HASH_CRC32C
+
+  RunKernelBench(64u << 20u);
+  RunVerifyBench<int>("int", 8u << 20u);
+  RunVerifyBench<double>("double", 4u << 20u);
+  RunVerifyBench<BigElem>("64-byte struct", 1u << 19u);
+  RunVerifyLevelBench(1u << 20u);
+  RunPolicyBench(1u << 16u);
+  RunSmallBench(12);
+  RunPoolBench(100);
+  RunBulkBench(4096);
+  #ifdef STACK_GUARD_PAGES
+  RunGuardBench(1u << 16u);
+  #endif //STACK_GUARD_PAGES
+  RunMoveBench(1u << 18u, 64);
+  RunSegmentedBench<int>("int", 1u << 26u);
+  RunSegmentedBench<std::string>("string", 1u << 24u);
+
+  return 0;
+}
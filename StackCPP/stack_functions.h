@@ -8,8 +8,15 @@
 #include <cstddef>
 #include <cstring>
 #include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
 #include <utility>
 
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif //__cplusplus
+
 #include "error_functions.h"
 
 /***
@@ -39,345 +46,2735 @@
  	  return code;		    \
 	}
 
+/***
+ * Stack operation check. Same as 'STACK_DUMP_CHECK', but checks stack as much as its verification level asks
+ * (see 'StackOpOK')
+ *
+ * @param ERR_CODE code - variable to receive stack error value
+ *
+ * @return ERR_CODE code - error code
+ */
+#define STACK_OP_CHECK(code)	    \
+	code = StackOpOK();	    \
+	if (code != SUCCESS)   	    \
+	{			    \
+ 	  StackDump(CURR_LOCATION); \
+ 	  return code;		    \
+	}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*********************************************************************************************************
  * Stack canary protection implementation.
  *
- * To activate stack canary protection it is necessary to place the following code before including library:
+ * Canary protection of a stack is chosen by its 'CanaryPolicy' template parameter:
+ * 'StackCanaryOn' or 'StackCanaryOff'. Default policy is 'StackCanaryOff', to make it 'StackCanaryOn'
+ * it is necessary to place the following code before including library:
  * #define STACK_CANARY_PROTECTION
  */
 
+typedef unsigned long long StkCanaryT;
+
+const StkCanaryT STACK_CANARY = 0xDEADBEEFBADF00D;
+
+/***
+ * Canary policy without canaries. Costs no memory and no instructions
+ */
+struct StackCanaryOff
+{
+  static const size_t BUF_BORDER = 0; // bytes reserved before and after stack data buffer
+
+  /***
+   * Structure canary, 'Side' 0 is placed before stack attributes and 1 after them
+   */
+  template <int Side>
+  struct Guard
+  {
+    bool CanaryOK() const
+    {
+      return true;
+    }
+
+    void DumpCanary(std::ostream &, const char *) const
+    {
+    }
+  };
+
+  static void SetBufCanaries(void *, size_t)
+  {
+  }
+
+  static ERR_CODE BufCanariesOK(const void *, size_t)
+  {
+    return SUCCESS;
+  }
+
+  static void DumpBufCanary(std::ostream &, const char *, const void *, ptrdiff_t)
+  {
+  }
+};
+
+/***
+ * Canary policy with canaries before and after stack attributes and stack data buffer
+ */
+struct StackCanaryOn
+{
+  static const size_t BUF_BORDER = sizeof(StkCanaryT); // bytes reserved before and after stack data buffer
+
+  /***
+   * Structure canary, 'Side' 0 is placed before stack attributes and 1 after them
+   */
+  template <int Side>
+  struct Guard
+  {
+    StkCanaryT canary = STACK_CANARY;
+
+    bool CanaryOK() const
+    {
+      return canary == STACK_CANARY;
+    }
+
+    void DumpCanary(std::ostream &os, const char *name) const
+    {
+      os << name << " - " << canary << std::endl;
+    }
+  };
+
+  /***
+   * Returns canary at the given address, which may be not aligned
+   */
+  static StkCanaryT ReadCanary(const void *ptr)
+  {
+    StkCanaryT value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+
+  /***
+   * Writes canaries before and after stack data buffer
+   *
+   * @param void *data      - stack data buffer
+   * @param size_t buf_size - size of buffer in bytes
+   */
+  static void SetBufCanaries(void *data, size_t buf_size)
+  {
+    memcpy((char *)data - sizeof(StkCanaryT), &STACK_CANARY, sizeof(StkCanaryT));
+    memcpy((char *)data + buf_size, &STACK_CANARY, sizeof(StkCanaryT));
+  }
+
+  /***
+   * Checks canaries before and after stack data buffer
+   *
+   * @param const void *data - stack data buffer
+   * @param size_t buf_size  - size of buffer in bytes
+   *
+   * @return ERR_CODE - error code
+   */
+  static ERR_CODE BufCanariesOK(const void *data, size_t buf_size)
+  {
+    STACK_VERIFY_CHECK(ReadCanary((const char *)data - sizeof(StkCanaryT)) != STACK_CANARY, ERR_FRONT_CANARY);
+    STACK_VERIFY_CHECK(ReadCanary((const char *)data + buf_size) != STACK_CANARY,          ERR_BACK_CANARY);
+
+    return SUCCESS;
+  }
+
+  /***
+   * Prints canary placed at 'offset' bytes from stack data buffer
+   */
+  static void DumpBufCanary(std::ostream &os, const char *name, const void *data, ptrdiff_t offset)
+  {
+    os << name << " - " << ReadCanary((const char *)data + offset) << std::endl;
+  }
+};
+
 #ifdef STACK_CANARY_PROTECTION
-#define ON_STACK_CANARY_PROTECTION(code) code
+typedef StackCanaryOn StackCanaryDefault;
 #else
-#define ON_STACK_CANARY_PROTECTION(code)
+typedef StackCanaryOff StackCanaryDefault;
 #endif //STACK_CANARY_PROTECTION
 
-typedef unsigned long long StkCanaryT;
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*********************************************************************************************************
  * Stack hash protection implementation.
  *
- * To activate stack hash protection it is necessary to place the following code before including library:
+ * Hash protection of a stack is chosen by its 'HashPolicy' template parameter:
+ * 'StackHashOn' or 'StackHashOff'. Default policy is 'StackHashOff', to make it 'StackHashOn'
+ * it is necessary to place the following code before including library:
  * #define STACK_HASH_PROTECTION
  */
 
-#ifdef STACK_HASH_PROTECTION
-#define ON_STACK_HASH_PROTECTION(code) code
-#else
-#define ON_STACK_HASH_PROTECTION(code)
-#endif //STACK_HASH_PROTECTION
-
 typedef unsigned long long HashT;
 typedef unsigned char uchar;
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/***
+ * Number of elements added to hash scrub sum by every stack operation.
+ * Corruption of stored element is detected at most after 'size / STACK_SCRUB_STEP' operations
+ */
+#ifndef STACK_SCRUB_STEP
+#define STACK_SCRUB_STEP 4
+#endif //STACK_SCRUB_STEP
 
 /***
- * Contains information about some location in the program
+ * Hash kernel selection. CRC32C instructions are used if the compiler targets CPU with SSE4.2
+ * (e.g. '-msse4.2' or '-march=native'), otherwise portable multiply-mix kernel is used.
+ * To force portable kernel it is necessary to place the following code before including library:
+ * #define STACK_HASH_PORTABLE
+ */
+#if defined(__SSE4_2__) && !defined(STACK_HASH_PORTABLE)
+#include <nmmintrin.h>
+#define STACK_HASH_CRC32C
+#endif
+
+/***
+ * Makes bitwise shift of value to the left (RotateLeft) and the leading bit goes to the end and not lost
  *
- * @attrib std::string func_name - function name, where variable was created
- * @attrib std::string file_name - file name, where variable was created
- * @attrib std::string file_line - line in the file, where variable was created
+ * @param HashT value - value to be rotated
+ *
+ * @return HashT - rotated value
  */
-struct LocationInfo
+inline HashT RoL(HashT value)
 {
-public:
-  std::string func_name;
-  std::string file_name;
-  int file_line = -1;
+  return (value << 1u) | (value >> (8u * sizeof(value) - 1u));
+}
 
-  LocationInfo()
-  = default;
+/***
+ * Calculates buffer hash one byte per step. Reference kernel, kept for comparison in benchmarks
+ *
+ * @param const void *buffer - buffer to calculate hash
+ * @param size_t buf_size    - size of buffer in bytes
+ *
+ * @return HashT - calculated hash value
+ */
+inline HashT HashBufferBytes(const void *buffer, size_t buf_size)
+{
+  auto buf_ptr = (const uchar *)buffer;
+  HashT value = 0;
 
-  LocationInfo(std::string new_func_name, std::string new_file_name, int new_file_line) :
-  	func_name(std::move(new_func_name)), file_name(std::move(new_file_name)), file_line(new_file_line)
+  for (size_t i = 0; i < buf_size; i++)
   {
+    value = RoL(value) ^ buf_ptr[i];
   }
 
-  LocationInfo(LocationInfo const &new_loc)
-  = default;
-};
+  return value;
+}
 
 /***
+ * Mixes bits of value, so that every input bit affects every output bit (splitmix64 finalizer)
  *
+ * @param HashT value - value to be mixed
+ *
+ * @return HashT - mixed value
  */
-#define CURR_LOCATION LocationInfo(__FUNCTION__, __FILE__, __LINE__)
+inline HashT HashMix(HashT value)
+{
+  value ^= value >> 30u;
+  value *= 0xBF58476D1CE4E5B9ull;
+  value ^= value >> 27u;
+  value *= 0x94D049BB133111EBull;
+  value ^= value >> 31u;
+  return value;
+}
 
+#ifdef STACK_HASH_CRC32C
+/***
+ * Adds 8 bytes to CRC32C value
+ */
+inline uint64_t HashStep(uint64_t value, const uchar *buf_ptr)
+{
+  uint64_t word;
+  memcpy(&word, buf_ptr, sizeof(word));
+  return _mm_crc32_u64(value, word);
+}
+#else
+/***
+ * Adds 8 bytes to multiply-mix hash value. Step is a bijection of value for every word,
+ * so change of one word of buffer always changes hash
+ */
+inline uint64_t HashStep(uint64_t value, const uchar *buf_ptr)
+{
+  uint64_t word;
+  memcpy(&word, buf_ptr, sizeof(word));
+  value = (value ^ word) * 0x9E3779B97F4A7C15ull;
+  return value ^ (value >> 32u);
+}
+#endif //STACK_HASH_CRC32C
 
 /***
- * Contains information about variable in the program
+ * Calculates buffer hash 8 bytes per step, buffers of 32 bytes and more are processed
+ * by four independent lanes, 32 bytes per step
  *
- * @attrib std::string var_name - variable name
- * @attribstd::string func_name	- function name, where variable was created
- * @std::string file_name	- file name, where variable was created
- * @std::string file_line	- line in the file, where variable was created
+ * @param const void *buffer - buffer to calculate hash
+ * @param size_t buf_size    - size of buffer in bytes
+ * @param HashT seed         - initial hash value
+ *
+ * @return HashT - calculated hash value
  */
-struct VarInfo : public LocationInfo
+inline HashT HashBuffer(const void *buffer, size_t buf_size, HashT seed = 0)
 {
-public:
-  std::string var_name;
+  auto buf_ptr = (const uchar *)buffer;
+  uint64_t value = (uint32_t)seed;
+  size_t i = 0;
 
-  VarInfo()
-  = default;
+  if (buf_size >= 32)
+  {
+    uint64_t lane1 = value + 1, lane2 = value + 2, lane3 = value + 3;
 
-  VarInfo(std::string new_var_name, const LocationInfo& new_var_location) :
-  	var_name(std::move(new_var_name))
+    for (; i + 32 <= buf_size; i += 32)
+    {
+      value = HashStep(value, buf_ptr + i);
+      lane1 = HashStep(lane1, buf_ptr + i + 8);
+      lane2 = HashStep(lane2, buf_ptr + i + 16);
+      lane3 = HashStep(lane3, buf_ptr + i + 24);
+    }
+
+    uchar lanes[24];
+    memcpy(lanes,      &lane1, sizeof(lane1));
+    memcpy(lanes + 8,  &lane2, sizeof(lane2));
+    memcpy(lanes + 16, &lane3, sizeof(lane3));
+    value = HashStep(HashStep(HashStep(value, lanes), lanes + 8), lanes + 16);
+  }
+
+  for (; i + 8 <= buf_size; i += 8)
   {
-    func_name = new_var_location.func_name;
-    file_name = new_var_location.file_name;
-    file_line = new_var_location.file_line;
+    value = HashStep(value, buf_ptr + i);
   }
 
-  VarInfo(std::string new_var_name, std::string new_func_name, std::string new_file_name, int new_file_line) :
-    var_name(std::move(new_var_name))
+  if (i < buf_size)
   {
-    func_name = std::move(new_func_name);
-    file_name = std::move(new_file_name);
-    file_line = new_file_line;
+    uchar tail[8] = {};
+    memcpy(tail, buf_ptr + i, buf_size - i);
+    value = HashStep(value, tail);
   }
-};
+
+  return seed ^ (value << 32u) ^ value;
+}
 
 
 /***
- * Stack template class
- *
- * @attrib size_t size     - the number of elements
- * @attrib size_t capacity - the number of elements that can be held in currently allocated storage
- * @attrib StkElem *data   - pointer to the buffer with stack data
- *
- * @attrib[D] struct VarInfo debug_info - debug information about stack
- * @attrib
+ * Hash policy without hash. Costs no memory and no instructions
  */
-template <typename StkElemT = int>
-class StackT
+struct StackHashOff
 {
-private:
-  ON_STACK_CANARY_PROTECTION(StkCanaryT canaryFront;)
+  template <typename StkElemT>
+  void AddHash(const StkElemT &, size_t)
+  {
+  }
 
-  size_t size = 0;
-  size_t capacity = 0;
+  template <typename StkElemT>
+  void RemoveHash(const StkElemT &, size_t)
+  {
+  }
 
-  StkElemT *data = nullptr;
+  template <typename StorageT>
+  void ResetHash(const StorageT &, size_t)
+  {
+  }
 
-  VarInfo debug_info;
+  template <typename StorageT>
+  ERR_CODE HashOK(const StorageT &, size_t) const
+  {
+    return SUCCESS;
+  }
+
+  template <typename StorageT>
+  ERR_CODE ScrubOK(const StorageT &, size_t)
+  {
+    return SUCCESS;
+  }
+
+  void DumpHash(std::ostream &) const
+  {
+  }
+};
+
+/***
+ * Hash policy with the sum of position-keyed element hashes.
+ * Hash is updated in O(1) when element is pushed or popped, and is verified either fully
+ * or incrementally by scrub, which sums STACK_SCRUB_STEP elements per check
+ */
+struct StackHashOn
+{
+  HashT hash = 0;        // sum of position-keyed element hashes
+  size_t scrub_pos = 0;  // elements [0, scrub_pos) are already summed by scrub
+  HashT scrub_hash = 0;  // scrub sum of elements [0, scrub_pos)
+
+  /***
+   * Calculates hash of stack element keyed by its position.
+   * Stack hash is the sum of these values, so it is updated in O(1) when element is pushed or popped,
+   * and elements swapped or moved to other positions change it too
+   *
+   * @param const StkElemT &elem - stack element
+   * @param size_t pos           - position of element in stack
+   *
+   * @return HashT - element hash
+   */
+  template <typename StkElemT>
+  static HashT ElemHash(const StkElemT &elem, size_t pos)
+  {
+    HashT key = (pos + 1) * 0x9E3779B97F4A7C15ull;
 
-  ON_STACK_HASH_PROTECTION(HashT hash = 0;)
+    // element fits into one word: 'HashMix' is a bijection, so it is enough and any change of element is detected
+    if (sizeof(StkElemT) <= sizeof(HashT))
+    {
+      HashT word = 0;
+      memcpy(&word, (const void *)&elem, sizeof(StkElemT));
+      return HashMix(word ^ key);
+    }
 
-  ON_STACK_CANARY_PROTECTION(StkCanaryT canaryBack;)
+    return HashMix(HashBuffer((const void *)&elem, sizeof(StkElemT), key));
+  }
 
   /***
-   * Allocates memory for stack data buffer
+   * Calculates stack hash from all elements. Costs O(size)
    *
-   * @param size_t Capacity - the size of buffer which is asked by user
+   * @param const StorageT &storage - stack storage
+   * @param size_t size             - the number of elements
    *
-   * @return ERR_CODE - error code
+   * @return HashT - calculated hash value
    */
-  ERR_CODE MemAlloc(size_t new_capacity)
+  template <typename StorageT>
+  HashT ReCalcHash(const StorageT &storage, size_t size) const
+  {
+    HashT value = 0;
+
+    for (size_t i = 0; i < size; i++)
+    {
+      value += ElemHash(storage[i], i);
+    }
+
+    return value;
+  }
+
+  /***
+   * Adds element on position 'pos' to stack hash
+   */
+  template <typename StkElemT>
+  void AddHash(const StkElemT &elem, size_t pos)
+  {
+    hash += ElemHash(elem, pos);
+  }
+
+  /***
+   * Removes element on position 'pos' from stack hash and from scrub sum if it is already summed there.
+   * Must be called before the element is changed
+   *
+   * @param const StkElemT &elem - element being removed, the top one
+   * @param size_t pos           - position of element
+   */
+  template <typename StkElemT>
+  void RemoveHash(const StkElemT &elem, size_t pos)
   {
-    if (capacity != 0)
+    HashT elem_hash = ElemHash(elem, pos);
+
+    hash -= elem_hash;
+    if (pos < scrub_pos)
     {
-      return ERR_EXCESS_ALLOC;
+      scrub_hash -= elem_hash;
+      scrub_pos = pos;
     }
+  }
+
+  template <typename StorageT>
+  void ResetHash(const StorageT &storage, size_t size)
+  {
+    hash = ReCalcHash(storage, size);
+    ResetScrub();
+  }
+
+  void ResetScrub( )
+  {
+    scrub_pos = 0;
+    scrub_hash = 0;
+  }
+
+  /***
+   * Compares stack hash with hash calculated from all elements
+   *
+   * @return ERR_CODE - error code
+   */
+  template <typename StorageT>
+  ERR_CODE HashOK(const StorageT &storage, size_t size) const
+  {
+    STACK_VERIFY_CHECK(ReCalcHash(storage, size) != hash, ERR_HASH_BREAK);
+
+    return SUCCESS;
+  }
 
-    // if stack protection is activated it is necessary to allocate memory for two canaries in the stack buffer
-    data = (StkElemT *)malloc(new_capacity * sizeof(StkElemT)
-			      ON_STACK_CANARY_PROTECTION(+ sizeof(StkCanaryT) * 2) );
+  /***
+   * Adds STACK_SCRUB_STEP more elements to the scrub sum and compares it with stack hash
+   * when all elements are summed. Costs O(1)
+   *
+   * @return ERR_CODE - error code
+   */
+  template <typename StorageT>
+  ERR_CODE ScrubOK(const StorageT &storage, size_t size)
+  {
+    for (size_t i = 0; i < STACK_SCRUB_STEP && scrub_pos < size; i++, scrub_pos++)
+    {
+      scrub_hash += ElemHash(storage[scrub_pos], scrub_pos);
+    }
 
-    if (data == nullptr)
+    // on mismatch scrub sum is kept, so the defect is reported again by following checks
+    if (scrub_pos >= size)
     {
-      return ERR_ALLOC;
+      STACK_VERIFY_CHECK(scrub_hash != hash, ERR_HASH_BREAK);
+      ResetScrub();
     }
-    capacity = new_capacity;
 
-    memset(data, '0', new_capacity * sizeof(StkElemT)
-		      ON_STACK_CANARY_PROTECTION(+ sizeof(StkCanaryT) * 2) );
+    return SUCCESS;
+  }
 
-    //setting canaries to the head and end of stack buffer
-    ON_STACK_CANARY_PROTECTION(
-      *((StkCanaryT *)data) = 0xDEADBEEFBADF00D;
-      *((StkCanaryT *)((char *)data + sizeof(StkCanaryT) + sizeof(StkElemT) * capacity)) = 0xDEADBEEFBAD00D;
-      data = (StkElemT *)((char *)data + sizeof(StkCanaryT));
-    )
+  void DumpHash(std::ostream &os) const
+  {
+    os << "Hash - " << hash << std::endl;
+  }
+};
+
+#ifdef STACK_HASH_PROTECTION
+typedef StackHashOn StackHashDefault;
+#else
+typedef StackHashOff StackHashDefault;
+#endif //STACK_HASH_PROTECTION
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*********************************************************************************************************
+ * Stack verification levels.
+ *
+ * Checks of a stack are chosen by its 'VerifyPolicy' template parameter. Level of 'StackVerifyFixed<level>'
+ * is fixed at compile time. Level of 'StackVerifyDynamic' (default policy) is STACK_VERIFY_LEVEL and can be
+ * changed for a stack with 'SetVerifyLevel'. To change default level it is necessary to place the following code
+ * before including library:
+ * #define STACK_VERIFY_LEVEL <level>
+ */
+
+/***
+ * Checks made before and after every stack operation
+ */
+enum STACK_VERIFY
+{
+  STACK_VERIFY_OFF,      // no checks
+  STACK_VERIFY_CHEAP,    // attributes and canaries, O(1)
+  STACK_VERIFY_SCRUB,    // attributes and canaries, hash is verified incrementally by STACK_SCRUB_STEP elements, O(1)
+  STACK_VERIFY_SAMPLED,  // attributes and canaries, full check every 'verify_period'-th time, O(size / verify_period)
+  STACK_VERIFY_PARANOID  // full check every time, O(size)
+};
+
+#ifndef STACK_VERIFY_LEVEL
+#define STACK_VERIFY_LEVEL STACK_VERIFY_SCRUB
+#endif //STACK_VERIFY_LEVEL
+
+/***
+ * Default period of full checks of STACK_VERIFY_SAMPLED level
+ */
+#ifndef STACK_VERIFY_PERIOD
+#define STACK_VERIFY_PERIOD 1024
+#endif //STACK_VERIFY_PERIOD
+
+/***
+ * Numbers of stack checks which were made
+ *
+ * @attrib size_t cheap - checks of attributes and canaries only
+ * @attrib size_t scrub - checks with incremental hash verification
+ * @attrib size_t full  - full checks, including calls of 'StackOK' by user
+ */
+struct StackCheckCounters
+{
+  size_t cheap = 0;
+  size_t scrub = 0;
+  size_t full = 0;
+};
+
+
+/***
+ * Kind of check to make
+ */
+enum STACK_CHECK
+{
+  STACK_CHECK_NONE,
+  STACK_CHECK_CHEAP, // attributes and canaries
+  STACK_CHECK_SCRUB, // attributes, canaries and incremental hash verification
+  STACK_CHECK_FULL   // attributes, canaries and hash
+};
+
+/***
+ * Returns kind of the next check of given verification level
+ *
+ * @param STACK_VERIFY level - verification level
+ * @param size_t period      - period of full checks of STACK_VERIFY_SAMPLED level
+ * @param size_t &count      - checks made since the last full one, updated
+ *
+ * @return STACK_CHECK - kind of check
+ */
+inline STACK_CHECK StackNextCheck(STACK_VERIFY level, size_t period, size_t &count)
+{
+  switch (level)
+  {
+    case STACK_VERIFY_OFF:
+      return STACK_CHECK_NONE;
+    case STACK_VERIFY_SCRUB:
+      return STACK_CHECK_SCRUB;
+    case STACK_VERIFY_SAMPLED:
+      if (++count >= period)
+      {
+        count = 0;
+        return STACK_CHECK_FULL;
+      }
+      return STACK_CHECK_CHEAP;
+    case STACK_VERIFY_PARANOID:
+      return STACK_CHECK_FULL;
+    case STACK_VERIFY_CHEAP:
+    default:
+      return STACK_CHECK_CHEAP;
+  }
+}
+
+/***
+ * Verification policy with level fixed at compile time. Checks are counted
+ */
+template <STACK_VERIFY Level, size_t Period = STACK_VERIFY_PERIOD>
+struct StackVerifyFixed
+{
+  size_t verify_count = 0; // checks made since the last full one
+  StackCheckCounters counters;
+
+  STACK_CHECK NextCheck( )
+  {
+    return StackNextCheck(Level, Period, verify_count);
+  }
+
+  void CountCheck(STACK_CHECK check)
+  {
+    counters.cheap += check == STACK_CHECK_CHEAP;
+    counters.scrub += check == STACK_CHECK_SCRUB;
+    counters.full  += check == STACK_CHECK_FULL;
+  }
+
+  const StackCheckCounters &CheckCounters( ) const
+  {
+    return counters;
+  }
+
+  void DumpVerify(std::ostream &os) const
+  {
+    os << "Verification level - " << Level << ", checks made : " << counters.cheap << " cheap, "
+       << counters.scrub << " scrub, " << counters.full << " full" << std::endl;
+  }
+};
+
+/***
+ * Verification policy without checks. Costs no memory and no instructions, 'StackOK' still can be called
+ */
+template <size_t Period>
+struct StackVerifyFixed<STACK_VERIFY_OFF, Period>
+{
+  STACK_CHECK NextCheck( )
+  {
+    return STACK_CHECK_NONE;
+  }
+
+  void CountCheck(STACK_CHECK)
+  {
+  }
+
+  const StackCheckCounters &CheckCounters( ) const
+  {
+    static const StackCheckCounters no_counters;
+    return no_counters;
+  }
+
+  void DumpVerify(std::ostream &) const
+  {
+  }
+};
+
+typedef StackVerifyFixed<STACK_VERIFY_OFF> StackVerifyOff;
+
+/***
+ * Verification policy with level which can be changed at run time with 'SetVerifyLevel'.
+ * Initial level is STACK_VERIFY_LEVEL. Checks are counted
+ */
+struct StackVerifyDynamic
+{
+  STACK_VERIFY verify_level = STACK_VERIFY_LEVEL;
+  size_t verify_period = STACK_VERIFY_PERIOD; // period of full checks of STACK_VERIFY_SAMPLED level
+  size_t verify_count = 0;                    // checks made since the last full one
+  StackCheckCounters counters;
+
+  STACK_CHECK NextCheck( )
+  {
+    return StackNextCheck(verify_level, verify_period, verify_count);
+  }
+
+  void CountCheck(STACK_CHECK check)
+  {
+    counters.cheap += check == STACK_CHECK_CHEAP;
+    counters.scrub += check == STACK_CHECK_SCRUB;
+    counters.full  += check == STACK_CHECK_FULL;
+  }
+
+  const StackCheckCounters &CheckCounters( ) const
+  {
+    return counters;
+  }
+
+  /***
+   * Sets checks made before and after every stack operation
+   *
+   * @param STACK_VERIFY level - verification level
+   * @param size_t period      - period of full checks of STACK_VERIFY_SAMPLED level, 1 makes every check full
+   */
+  void SetVerifyLevel(STACK_VERIFY level, size_t period)
+  {
+    verify_level = level;
+    verify_period = period == 0 ? 1 : period;
+    verify_count = 0;
+  }
+
+  void DumpVerify(std::ostream &os) const
+  {
+    os << "Verification level - " << verify_level << ", checks made : " << counters.cheap << " cheap, "
+       << counters.scrub << " scrub, " << counters.full << " full" << std::endl;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/***
+ * Contains information about some location in the program
+ *
+ * @attrib std::string func_name - function name, where variable was created
+ * @attrib std::string file_name - file name, where variable was created
+ * @attrib std::string file_line - line in the file, where variable was created
+ */
+struct LocationInfo
+{
+public:
+  std::string func_name;
+  std::string file_name;
+  int file_line = -1;
+
+  LocationInfo()
+  = default;
+
+  LocationInfo(std::string new_func_name, std::string new_file_name, int new_file_line) :
+  	func_name(std::move(new_func_name)), file_name(std::move(new_file_name)), file_line(new_file_line)
+  {
+  }
+
+  LocationInfo(LocationInfo const &new_loc)
+  = default;
+};
+
+/***
+ *
+ */
+#define CURR_LOCATION LocationInfo(__FUNCTION__, __FILE__, __LINE__)
+
+
+/***
+ * Contains information about variable in the program
+ *
+ * @attrib std::string var_name - variable name
+ * @attribstd::string func_name	- function name, where variable was created
+ * @std::string file_name	- file name, where variable was created
+ * @std::string file_line	- line in the file, where variable was created
+ */
+struct VarInfo : public LocationInfo
+{
+public:
+  std::string var_name;
+
+  VarInfo()
+  = default;
+
+  VarInfo(std::string new_var_name, const LocationInfo& new_var_location) :
+  	var_name(std::move(new_var_name))
+  {
+    func_name = new_var_location.func_name;
+    file_name = new_var_location.file_name;
+    file_line = new_var_location.file_line;
+  }
+
+  VarInfo(std::string new_var_name, std::string new_func_name, std::string new_file_name, int new_file_line) :
+    var_name(std::move(new_var_name))
+  {
+    func_name = std::move(new_func_name);
+    file_name = std::move(new_file_name);
+    file_line = new_file_line;
+  }
+};
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*********************************************************************************************************
+ * Stack memory allocators.
+ *
+ * Stack buffers are allocated by its 'Allocator' template parameter. Allocator is a copyable class with methods
+ *   void *Allocate(size_t bytes)                                      - nullptr if there is no memory
+ *   void *Reallocate(void *ptr, size_t old_bytes, size_t new_bytes) - nullptr if there is no memory, 'ptr' is kept
+ *   void Deallocate(void *ptr, size_t bytes)
+ * returning memory aligned as 'malloc' does. Stateful allocator is given to stack constructor,
+ * stateless one costs no memory.
+ */
+
+/***
+ * Allocator with 'malloc', 'realloc' and 'free'
+ */
+struct StackMallocAllocator
+{
+  void *Allocate(size_t bytes)
+  {
+    return malloc(bytes);
+  }
+
+  void *Reallocate(void *ptr, size_t, size_t new_bytes)
+  {
+    return realloc(ptr, new_bytes);
+  }
+
+  void Deallocate(void *ptr, size_t)
+  {
+    free(ptr);
+  }
+};
+
+#ifndef STACK_POOL_CLASSES
+#define STACK_POOL_CLASSES 12  // number of size classes of pool allocator
+#endif //STACK_POOL_CLASSES
+
+#ifndef STACK_POOL_CACHE
+#define STACK_POOL_CACHE 64    // maximal number of free blocks kept in every size class
+#endif //STACK_POOL_CACHE
+
+const size_t STACK_POOL_MIN_BLOCK = 32; // bytes for elements in blocks of the smallest class
+const size_t STACK_POOL_SLACK     = 64; // bytes added to every block for buffer borders
+
+/***
+ * Free blocks of one thread kept by 'StackPoolAllocator'. It is trivially destructible,
+ * so it stays usable while the thread is finishing
+ *
+ * @attrib void *free_lists[] - lists of free blocks of every size class, linked by their first bytes
+ * @attrib size_t free_counts[] - numbers of blocks in lists
+ * @attrib bool closed - thread is finishing, so freed blocks are not kept anymore
+ */
+struct StackPool
+{
+  void *free_lists[STACK_POOL_CLASSES];
+  size_t free_counts[STACK_POOL_CLASSES];
+  bool closed;
+};
+
+/***
+ * Allocator with thread-local pools of blocks of size classes, which fit buffers of power of two
+ * capacities made by stack growth. Blocks which do not fit any class are taken from 'malloc'
+ */
+struct StackPoolAllocator
+{
+  /***
+   * Returns size class of block which has 'bytes' bytes, or STACK_POOL_CLASSES if it is too large
+   */
+  static size_t SizeClass(size_t bytes)
+  {
+    size_t payload = bytes > STACK_POOL_SLACK ? bytes - STACK_POOL_SLACK : 0;
+    size_t size_class = 0;
+
+    while (size_class < STACK_POOL_CLASSES && (STACK_POOL_MIN_BLOCK << size_class) < payload)
+    {
+      size_class++;
+    }
+
+    return size_class;
+  }
+
+  /***
+   * Returns pool of the current thread
+   */
+  static StackPool &LocalPool()
+  {
+    // releases kept blocks when the thread finishes
+    struct PoolGuard
+    {
+      ~PoolGuard()
+      {
+        StackPool &pool = LocalPool();
+        pool.closed = true;
+
+        for (size_t size_class = 0; size_class < STACK_POOL_CLASSES; size_class++)
+        {
+          while (pool.free_lists[size_class] != nullptr)
+          {
+            void *block = pool.free_lists[size_class];
+            memcpy(&pool.free_lists[size_class], block, sizeof(void *));
+            free(block);
+          }
+          pool.free_counts[size_class] = 0;
+        }
+      }
+    };
+
+    static thread_local StackPool pool;
+    static thread_local PoolGuard guard;
+    (void)guard;
+
+    return pool;
+  }
+
+  /***
+   * Returns the number of free blocks kept by pool of the current thread
+   */
+  static size_t CachedBlocks()
+  {
+    StackPool &pool = LocalPool();
+    size_t count = 0;
+
+    for (size_t size_class = 0; size_class < STACK_POOL_CLASSES; size_class++)
+    {
+      count += pool.free_counts[size_class];
+    }
+
+    return count;
+  }
+
+  void *Allocate(size_t bytes)
+  {
+    size_t size_class = SizeClass(bytes);
+    if (size_class == STACK_POOL_CLASSES)
+    {
+      return malloc(bytes);
+    }
+
+    StackPool &pool = LocalPool();
+    void *block = pool.free_lists[size_class];
+    if (block == nullptr)
+    {
+      return malloc((STACK_POOL_MIN_BLOCK << size_class) + STACK_POOL_SLACK);
+    }
+
+    memcpy(&pool.free_lists[size_class], block, sizeof(void *));
+    pool.free_counts[size_class]--;
+
+    return block;
+  }
+
+  void *Reallocate(void *ptr, size_t old_bytes, size_t new_bytes)
+  {
+    size_t old_class = SizeClass(old_bytes);
+    size_t new_class = SizeClass(new_bytes);
+
+    if (old_class == new_class)
+    {
+      return old_class == STACK_POOL_CLASSES ? realloc(ptr, new_bytes) : ptr;
+    }
+
+    void *block = Allocate(new_bytes);
+    if (block == nullptr)
+    {
+      return nullptr;
+    }
+
+    memcpy(block, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+    Deallocate(ptr, old_bytes);
+
+    return block;
+  }
+
+  void Deallocate(void *ptr, size_t bytes)
+  {
+    size_t size_class = SizeClass(bytes);
+    StackPool &pool = LocalPool();
+
+    if (size_class == STACK_POOL_CLASSES || pool.closed || pool.free_counts[size_class] == STACK_POOL_CACHE)
+    {
+      free(ptr);
+      return;
+    }
+
+    memcpy(ptr, &pool.free_lists[size_class], sizeof(void *));
+    pool.free_lists[size_class] = ptr;
+    pool.free_counts[size_class]++;
+  }
+};
+
+#if __cplusplus >= 201703L
+/***
+ * Allocator with 'std::pmr::memory_resource', e.g. monotonic buffer or pool resource
+ */
+struct StackPmrAllocator
+{
+  std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+
+  StackPmrAllocator()
+  = default;
+
+  StackPmrAllocator(std::pmr::memory_resource *init_resource) : resource(init_resource)
+  {
+  }
+
+  void *Allocate(size_t bytes)
+  {
+    try
+    {
+      return resource->allocate(bytes, alignof(std::max_align_t));
+    }
+    catch (const std::bad_alloc &)
+    {
+      return nullptr;
+    }
+  }
+
+  void *Reallocate(void *ptr, size_t old_bytes, size_t new_bytes)
+  {
+    void *block = Allocate(new_bytes);
+    if (block == nullptr)
+    {
+      return nullptr;
+    }
+
+    memcpy(block, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+    Deallocate(ptr, old_bytes);
+
+    return block;
+  }
+
+  void Deallocate(void *ptr, size_t bytes)
+  {
+    resource->deallocate(ptr, bytes, alignof(std::max_align_t));
+  }
+};
+#endif //__cplusplus
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*********************************************************************************************************
+ * Stack storage implementation.
+ *
+ * Storage of stack elements is chosen by its 'StoragePolicy' template parameter.
+ * Policy contains class template 'Storage<StkElemT, Border, Allocator>' which owns data buffers (segments) taken
+ * from 'Allocator', where every buffer has 'Border' bytes reserved before and after it for buffer canaries. 'Border' is a multiple of element
+ * alignment. Elements are numbered through all segments, every segment but the last one is full.
+ */
+
+/***
+ * Returns number of bytes reserved before and after stack data buffer, so that buffer stays aligned
+ *
+ * @param size_t border - bytes needed for buffer canaries
+ * @param size_t align  - alignment of stack elements
+ */
+constexpr size_t StackBufBorder(size_t border, size_t align)
+{
+  return (border + align - 1) / align * align;
+}
+
+/***
+ * Checks if objects of type 'StkElemT' may be moved to another address by copying their bytes.
+ * Such elements are moved by 'realloc' and 'memcpy', others are move constructed in the new place.
+ * Specialize it for own types which have no pointers into themselves, e.g. handles of heap data
+ */
+template <typename StkElemT>
+struct StackIsTriviallyRelocatable : std::integral_constant<bool, std::is_trivially_copyable<StkElemT>::value>
+{
+};
+
+/***
+ * Moves 'count' elements from 'src' to uninitialized memory 'dest'. Elements at 'src' are destroyed
+ */
+template <typename StkElemT>
+void StackRelocate(StkElemT *dest, StkElemT *src, size_t count)
+{
+  if (StackIsTriviallyRelocatable<StkElemT>::value)
+  {
+    memcpy((void *)dest, (void *)src, count * sizeof(StkElemT));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    new (dest + i) StkElemT(std::move(src[i]));
+    src[i].~StkElemT();
+  }
+}
+
+/***
+ * Destroys 'count' elements at 'data' and clears their memory
+ */
+template <typename StkElemT>
+void StackDestroy(StkElemT *data, size_t count)
+{
+  if (!std::is_trivially_destructible<StkElemT>::value)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      data[i].~StkElemT();
+    }
+  }
+
+  memset((void *)data, '0', count * sizeof(StkElemT));
+}
+
+/***
+ * Storage policy with data buffer in the heap, reallocated on growth
+ */
+struct StackHeapStorage
+{
+  template <typename StkElemT, size_t Border, typename Allocator>
+  class Storage : private Allocator
+  {
+  private:
+    StkElemT *data = nullptr;
+    size_t capacity = 0;
+
+  public:
+    static const bool RELOCATES = true; // elements are moved by reallocation
+
+    explicit Storage(const Allocator &alloc = Allocator()) : Allocator(alloc)
+    {
+    }
+
+    Storage(const Storage &)
+    = delete;
+
+    Storage &operator=(const Storage &)
+    = delete;
+
+    StkElemT *Data() const
+    {
+      return data;
+    }
+
+    size_t Capacity() const
+    {
+      return capacity;
+    }
+
+    StkElemT &operator[](size_t pos) const
+    {
+      return data[pos];
+    }
+
+    size_t Segments() const
+    {
+      return data == nullptr ? 0 : 1;
+    }
+
+    StkElemT *Segment(size_t) const
+    {
+      return data;
+    }
+
+    size_t SegmentCapacity() const
+    {
+      return capacity;
+    }
+
+    /***
+     * Returns capacity stack grows to when it is full
+     */
+    size_t GrowCapacity() const
+    {
+      return capacity == 0 ? 1 : capacity * 2;
+    }
+
+    /***
+     * Called after pop, data buffer is shrunk only by 'Realloc'
+     */
+    void Trim(size_t)
+    {
+    }
+
+    /***
+     * Sets stack owning the storage, used only by 'StackGuardedStorage'
+     */
+    void SetOwner(const VarInfo *)
+    {
+    }
+
+    /***
+     * Allocates data buffer
+     *
+     * @param size_t new_capacity - the number of elements buffer can hold
+     *
+     * @return ERR_CODE - error code
+     */
+    ERR_CODE Alloc(size_t new_capacity)
+    {
+      if (capacity != 0)
+      {
+        return ERR_EXCESS_ALLOC;
+      }
+
+      auto buffer = (char *)this->Allocate(new_capacity * sizeof(StkElemT) + Border * 2);
+      if (buffer == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+
+      memset(buffer, '0', new_capacity * sizeof(StkElemT) + Border * 2);
+      data = (StkElemT *)(buffer + Border);
+      capacity = new_capacity;
+
+      return SUCCESS;
+    }
+
+    /***
+     * Reallocates data buffer, moving its first 'count' elements
+     *
+     * @param size_t new_capacity - the number of elements buffer can hold
+     * @param size_t count        - the number of constructed elements, not greater than 'new_capacity'
+     *
+     * @return ERR_CODE - error code. If allocation fails data buffer is kept
+     */
+    ERR_CODE Realloc(size_t new_capacity, size_t count)
+    {
+      if (data == nullptr)
+      {
+        return Alloc(new_capacity);
+      }
+
+      if (StackIsTriviallyRelocatable<StkElemT>::value)
+      {
+        auto buffer = (char *)this->Reallocate((char *)data - Border, capacity * sizeof(StkElemT) + Border * 2,
+                                                  new_capacity * sizeof(StkElemT) + Border * 2);
+        if (buffer == nullptr)
+        {
+          return ERR_ALLOC;
+        }
+
+        data = (StkElemT *)(buffer + Border);
+        capacity = new_capacity;
+
+        return SUCCESS;
+      }
+
+      auto buffer = (char *)this->Allocate(new_capacity * sizeof(StkElemT) + Border * 2);
+      if (buffer == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+
+      memset(buffer, '0', new_capacity * sizeof(StkElemT) + Border * 2);
+      StackRelocate((StkElemT *)(buffer + Border), data, count);
+      Free();
+
+      data = (StkElemT *)(buffer + Border);
+      capacity = new_capacity;
+
+      return SUCCESS;
+    }
+
+    /***
+     * Clears and frees data buffer
+     */
+    void Free( )
+    {
+      if (data == nullptr)
+      {
+        return;
+      }
+
+      char *buffer = (char *)data - Border;
+      memset(buffer, '0', capacity * sizeof(StkElemT) + Border * 2);
+      this->Deallocate(buffer, capacity * sizeof(StkElemT) + Border * 2);
+
+      data = nullptr;
+      capacity = 0;
+    }
+  };
+};
+
+/***
+ * Storage policy with data buffer of 'InlineCapacity' elements inside the stack object.
+ * Buffer is moved to the heap when stack grows over 'InlineCapacity' elements and back when
+ * it is reallocated to fit into it, so small stacks need no allocation at all
+ */
+template <size_t InlineCapacity>
+struct StackSmallStorage
+{
+  static_assert(InlineCapacity > 0, "Inline capacity of stack must be positive");
+
+  template <typename StkElemT, size_t Border, typename Allocator>
+  class Storage : private Allocator
+  {
+  private:
+    static const size_t INLINE_BUF_SIZE = InlineCapacity * sizeof(StkElemT) + Border * 2;
+
+    StkElemT *data = nullptr;
+    size_t capacity = 0;
+
+    alignas(StkElemT) uchar inline_buf[INLINE_BUF_SIZE];
+
+    StkElemT *InlineData()
+    {
+      return (StkElemT *)(inline_buf + Border);
+    }
+
+    /***
+     * Moves data buffer to the inline one, keeping its first 'count' elements
+     */
+    void MoveInline(size_t count)
+    {
+      char *buffer = (char *)data - Border;
+      size_t buf_size = capacity * sizeof(StkElemT) + Border * 2;
+
+      memset(inline_buf, '0', INLINE_BUF_SIZE);
+      StackRelocate(InlineData(), data, count);
+      memset(buffer, '0', buf_size);
+      this->Deallocate(buffer, buf_size);
+
+      data = InlineData();
+      capacity = InlineCapacity;
+    }
+
+  public:
+    static const bool RELOCATES = true; // elements are moved by reallocation
+
+    explicit Storage(const Allocator &alloc = Allocator()) : Allocator(alloc)
+    {
+    }
+
+    Storage(const Storage &)
+    = delete;
+
+    Storage &operator=(const Storage &)
+    = delete;
+
+    StkElemT *Data() const
+    {
+      return data;
+    }
+
+    size_t Capacity() const
+    {
+      return capacity;
+    }
+
+    StkElemT &operator[](size_t pos) const
+    {
+      return data[pos];
+    }
+
+    size_t Segments() const
+    {
+      return data == nullptr ? 0 : 1;
+    }
+
+    StkElemT *Segment(size_t) const
+    {
+      return data;
+    }
+
+    size_t SegmentCapacity() const
+    {
+      return capacity;
+    }
+
+    /***
+     * Returns capacity stack grows to when it is full
+     */
+    size_t GrowCapacity() const
+    {
+      return capacity == 0 ? 1 : capacity * 2;
+    }
+
+    /***
+     * Called after pop, data buffer is shrunk only by 'Realloc'
+     */
+    void Trim(size_t)
+    {
+    }
+
+    /***
+     * Sets stack owning the storage, used only by 'StackGuardedStorage'
+     */
+    void SetOwner(const VarInfo *)
+    {
+    }
+
+    /***
+     * Checks if data buffer is inside the stack object
+     */
+    bool IsInline() const
+    {
+      return data == (const StkElemT *)(inline_buf + Border);
+    }
+
+    /***
+     * Allocates data buffer. Capacity is at least 'InlineCapacity'
+     *
+     * @param size_t new_capacity - the number of elements buffer must hold
+     *
+     * @return ERR_CODE - error code
+     */
+    ERR_CODE Alloc(size_t new_capacity)
+    {
+      if (capacity != 0)
+      {
+        return ERR_EXCESS_ALLOC;
+      }
+
+      if (new_capacity <= InlineCapacity)
+      {
+        memset(inline_buf, '0', INLINE_BUF_SIZE);
+        data = InlineData();
+        capacity = InlineCapacity;
+        return SUCCESS;
+      }
+
+      auto buffer = (char *)this->Allocate(new_capacity * sizeof(StkElemT) + Border * 2);
+      if (buffer == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+
+      memset(buffer, '0', new_capacity * sizeof(StkElemT) + Border * 2);
+      data = (StkElemT *)(buffer + Border);
+      capacity = new_capacity;
+
+      return SUCCESS;
+    }
+
+    /***
+     * Reallocates data buffer, moving its first 'count' elements. Capacity is at least 'InlineCapacity'
+     *
+     * @param size_t new_capacity - the number of elements buffer must hold
+     * @param size_t count        - the number of constructed elements, not greater than 'new_capacity'
+     *
+     * @return ERR_CODE - error code. If allocation fails data buffer is kept
+     */
+    ERR_CODE Realloc(size_t new_capacity, size_t count)
+    {
+      if (data == nullptr)
+      {
+        return Alloc(new_capacity);
+      }
+
+      if (new_capacity <= InlineCapacity)
+      {
+        if (!IsInline())
+        {
+          MoveInline(count);
+        }
+        return SUCCESS;
+      }
+
+      if (IsInline() || !StackIsTriviallyRelocatable<StkElemT>::value)
+      {
+        auto buffer = (char *)this->Allocate(new_capacity * sizeof(StkElemT) + Border * 2);
+        if (buffer == nullptr)
+        {
+          return ERR_ALLOC;
+        }
+
+        memset(buffer, '0', new_capacity * sizeof(StkElemT) + Border * 2);
+        StackRelocate((StkElemT *)(buffer + Border), data, count);
+        Free();
+
+        data = (StkElemT *)(buffer + Border);
+        capacity = new_capacity;
+        return SUCCESS;
+      }
+
+      auto buffer = (char *)this->Reallocate((char *)data - Border, capacity * sizeof(StkElemT) + Border * 2,
+                                                  new_capacity * sizeof(StkElemT) + Border * 2);
+      if (buffer == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+
+      data = (StkElemT *)(buffer + Border);
+      capacity = new_capacity;
+
+      return SUCCESS;
+    }
+
+    /***
+     * Clears and frees data buffer
+     */
+    void Free( )
+    {
+      if (data == nullptr)
+      {
+        return;
+      }
+
+      if (IsInline())
+      {
+        memset(inline_buf, '0', INLINE_BUF_SIZE);
+      }
+      else
+      {
+        char *buffer = (char *)data - Border;
+        memset(buffer, '0', capacity * sizeof(StkElemT) + Border * 2);
+        this->Deallocate(buffer, capacity * sizeof(StkElemT) + Border * 2);
+      }
+
+      data = nullptr;
+      capacity = 0;
+    }
+  };
+};
+
+/***
+ * Storage policy with elements in linked chunks of 'ChunkCapacity' elements in the heap.
+ * Growth adds one chunk, so elements are never copied and their addresses are stable, push and pop cost O(1).
+ * Chunk emptied by pop is kept as a spare one and reused by the next growth
+ */
+template <size_t ChunkCapacity>
+struct StackSegmentedStorage
+{
+  static_assert(ChunkCapacity > 0, "Chunk capacity of stack must be positive");
+
+  template <typename StkElemT, size_t Border, typename Allocator>
+  class Storage : private Allocator
+  {
+  private:
+    static const size_t CHUNK_BUF_SIZE = ChunkCapacity * sizeof(StkElemT) + Border * 2;
+
+    StkElemT **chunks = nullptr; // table of chunks, only its first 'chunk_count' places are used
+    size_t table_size = 0;
+    size_t chunk_count = 0;
+    StkElemT *spare = nullptr;   // empty chunk kept for the next growth
+
+    void FreeChunk(StkElemT *chunk)
+    {
+      char *buffer = (char *)chunk - Border;
+      memset(buffer, '0', CHUNK_BUF_SIZE);
+      this->Deallocate(buffer, CHUNK_BUF_SIZE);
+    }
+
+    /***
+     * Adds chunk to the end of the table, the spare one if there is
+     *
+     * @return ERR_CODE - error code
+     */
+    ERR_CODE AddChunk()
+    {
+      if (chunk_count == table_size)
+      {
+        size_t new_table_size = table_size == 0 ? 8 : table_size * 2;
+        auto table = (StkElemT **)(chunks == nullptr ? this->Allocate(new_table_size * sizeof(StkElemT *))
+                                                     : this->Reallocate(chunks, table_size * sizeof(StkElemT *),
+                                                                        new_table_size * sizeof(StkElemT *)));
+        if (table == nullptr)
+        {
+          return ERR_ALLOC;
+        }
+
+        chunks = table;
+        table_size = new_table_size;
+      }
+
+      if (spare != nullptr)
+      {
+        chunks[chunk_count++] = spare;
+        spare = nullptr;
+        return SUCCESS;
+      }
+
+      auto buffer = (char *)this->Allocate(CHUNK_BUF_SIZE);
+      if (buffer == nullptr)
+      {
+        return ERR_ALLOC;
+      }
+
+      memset(buffer, '0', CHUNK_BUF_SIZE);
+      chunks[chunk_count++] = (StkElemT *)(buffer + Border);
+
+      return SUCCESS;
+    }
+
+  public:
+    static const bool RELOCATES = false; // elements are never moved
+
+    explicit Storage(const Allocator &alloc = Allocator()) : Allocator(alloc)
+    {
+    }
+
+    Storage(const Storage &)
+    = delete;
+
+    Storage &operator=(const Storage &)
+    = delete;
+
+    StkElemT *Data() const
+    {
+      return chunk_count == 0 ? nullptr : chunks[0];
+    }
+
+    size_t Capacity() const
+    {
+      return chunk_count * ChunkCapacity;
+    }
+
+    StkElemT &operator[](size_t pos) const
+    {
+      return chunks[pos / ChunkCapacity][pos % ChunkCapacity];
+    }
+
+    size_t Segments() const
+    {
+      return chunk_count;
+    }
+
+    StkElemT *Segment(size_t seg) const
+    {
+      return chunks[seg];
+    }
+
+    size_t SegmentCapacity() const
+    {
+      return ChunkCapacity;
+    }
+
+    /***
+     * Returns capacity stack grows to when it is full
+     */
+    size_t GrowCapacity() const
+    {
+      return Capacity() + ChunkCapacity;
+    }
+
+    /***
+     * Checks if there is a spare chunk
+     */
+    bool HasSpare() const
+    {
+      return spare != nullptr;
+    }
+
+    /***
+     * Allocates chunks for at least 'new_capacity' elements, at least one chunk
+     *
+     * @param size_t new_capacity - the number of elements chunks must hold
+     *
+     * @return ERR_CODE - error code
+     */
+    ERR_CODE Alloc(size_t new_capacity)
+    {
+      if (chunk_count != 0)
+      {
+        return ERR_EXCESS_ALLOC;
+      }
+
+      return Realloc(new_capacity, 0);
+    }
+
+    /***
+     * Adds or frees chunks, so that they hold at least 'new_capacity' elements. Elements are not moved.
+     * Shrinking frees the spare chunk too
+     *
+     * @param size_t new_capacity - the number of elements chunks must hold
+     *
+     * @return ERR_CODE - error code. If allocation fails already added chunks are kept
+     */
+    ERR_CODE Realloc(size_t new_capacity, size_t)
+    {
+      size_t new_count = new_capacity == 0 ? 1 : (new_capacity + ChunkCapacity - 1) / ChunkCapacity;
+
+      while (chunk_count < new_count)
+      {
+        ERR_CODE code = AddChunk();
+        if (code != SUCCESS)
+        {
+          return code;
+        }
+      }
+
+      if (chunk_count > new_count && spare != nullptr)
+      {
+        FreeChunk(spare);
+        spare = nullptr;
+      }
+
+      while (chunk_count > new_count)
+      {
+        FreeChunk(chunks[--chunk_count]);
+      }
+
+      return SUCCESS;
+    }
+
+    /***
+     * Called after pop, removes chunks which become empty. One of them is kept as a spare chunk,
+     * if there is no one, so pushes and pops on the chunk boundary do not allocate memory
+     *
+     * @param size_t size - the number of elements
+     */
+    void Trim(size_t size)
+    {
+      while (chunk_count > 1 && size <= (chunk_count - 1) * ChunkCapacity)
+      {
+        chunk_count--;
+        if (spare == nullptr)
+        {
+          spare = chunks[chunk_count];
+        }
+        else
+        {
+          FreeChunk(chunks[chunk_count]);
+        }
+      }
+    }
+
+    /***
+     * Sets stack owning the storage, used only by 'StackGuardedStorage'
+     */
+    void SetOwner(const VarInfo *)
+    {
+    }
+
+    /***
+     * Clears and frees all chunks
+     */
+    void Free( )
+    {
+      while (chunk_count > 0)
+      {
+        FreeChunk(chunks[--chunk_count]);
+      }
+
+      if (spare != nullptr)
+      {
+        FreeChunk(spare);
+        spare = nullptr;
+      }
+
+      if (chunks != nullptr)
+      {
+        this->Deallocate(chunks, table_size * sizeof(StkElemT *));
+        chunks = nullptr;
+      }
+      table_size = 0;
+    }
+  };
+};
+
+/***
+ * Guard page storage is available on POSIX systems with 'mmap'
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#include <atomic>
+#include <csignal>
+#include <sys/mman.h>
+#include <unistd.h>
+#define STACK_GUARD_PAGES
+#endif
+
+#ifdef STACK_GUARD_PAGES
+
+#ifndef STACK_GUARD_SLOTS
+#define STACK_GUARD_SLOTS 256 // maximal number of guarded buffers whose owners are reported on fault
+#endif //STACK_GUARD_SLOTS
+
+/***
+ * Registry of guarded buffers and SIGSEGV handler which reports stack whose guard page was hit.
+ * Registered buffers are read by the handler without locks
+ */
+class StackGuardRegistry
+{
+private:
+  struct Slot
+  {
+    std::atomic<bool> used;
+    std::atomic<const char *> begin; // beginning of mapping with guard pages, nullptr until slot is filled
+    std::atomic<const char *> end;   // fields are atomic, because handler may read them while slot is reused
+    std::atomic<const VarInfo *> owner;
+  };
+
+  static Slot *Slots()
+  {
+    static Slot slots[STACK_GUARD_SLOTS];
+    return slots;
+  }
+
+  static struct sigaction &PrevAction()
+  {
+    static struct sigaction prev_action;
+    return prev_action;
+  }
+
+  /***
+   * Writes string to the standard error stream, may be called from signal handler
+   */
+  static void WriteErr(const char *str)
+  {
+    ssize_t written = write(STDERR_FILENO, str, strlen(str));
+    (void)written;
+  }
+
+  static void WriteErr(int value)
+  {
+    char buf[16];
+    char *ptr = buf + sizeof(buf) - 1;
+    unsigned abs_value = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+
+    *ptr = '\0';
+    do
+    {
+      *--ptr = (char)('0' + abs_value % 10);
+      abs_value /= 10;
+    } while (abs_value != 0);
+
+    if (value < 0)
+    {
+      *--ptr = '-';
+    }
+    WriteErr(ptr);
+  }
+
+  static void Handler(int sig, siginfo_t *info, void *context)
+  {
+    auto addr = (const char *)info->si_addr;
+
+    for (size_t i = 0; i < STACK_GUARD_SLOTS; i++)
+    {
+      const char *begin = Slots()[i].begin.load(std::memory_order_acquire);
+      const char *end = Slots()[i].end.load(std::memory_order_acquire);
+      const VarInfo *owner = Slots()[i].owner.load(std::memory_order_acquire);
+
+      // fields read after slot was refilled by other thread may belong to different mappings
+      if (begin == nullptr || begin != Slots()[i].begin.load(std::memory_order_acquire) || addr < begin || addr >= end)
+      {
+        continue;
+      }
+
+      WriteErr("Stack guard page is hit, stack : ");
+      if (owner != nullptr)
+      {
+        WriteErr(owner->var_name.c_str());
+        WriteErr("\n	-function name : ");
+        WriteErr(owner->func_name.c_str());
+        WriteErr("\n	-file name : ");
+        WriteErr(owner->file_name.c_str());
+        WriteErr("\n	-file line : ");
+        WriteErr(owner->file_line);
+      }
+      WriteErr("\n");
+      break;
+    }
+
+    // signal is passed to the previous handler, default one kills the process when the fault repeats
+    const struct sigaction &prev = PrevAction();
+    if ((prev.sa_flags & SA_SIGINFO) != 0 && prev.sa_sigaction != nullptr)
+    {
+      prev.sa_sigaction(sig, info, context);
+    }
+    else if ((prev.sa_flags & SA_SIGINFO) == 0 && prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN)
+    {
+      prev.sa_handler(sig);
+    }
+    else
+    {
+      signal(sig, SIG_DFL);
+    }
+  }
+
+  static bool InstallHandler()
+  {
+    struct sigaction action = {};
+    action.sa_sigaction = Handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    return sigaction(SIGSEGV, &action, &PrevAction()) == 0;
+  }
+
+public:
+  /***
+   * Registers mapping from 'begin' to 'end' owned by stack 'owner' and installs handler if it is not installed
+   *
+   * @return size_t - slot number, STACK_GUARD_SLOTS if all slots are used and owner will not be reported
+   */
+  static size_t Register(const char *begin, const char *end, const VarInfo *owner)
+  {
+    static bool installed = InstallHandler();
+    (void)installed;
+
+    for (size_t i = 0; i < STACK_GUARD_SLOTS; i++)
+    {
+      if (!Slots()[i].used.exchange(true, std::memory_order_acq_rel))
+      {
+        Slots()[i].end.store(end, std::memory_order_release);
+        Slots()[i].owner.store(owner, std::memory_order_release);
+        Slots()[i].begin.store(begin, std::memory_order_release);
+        return i;
+      }
+    }
+
+    return STACK_GUARD_SLOTS;
+  }
+
+  static void Unregister(size_t slot)
+  {
+    if (slot >= STACK_GUARD_SLOTS)
+    {
+      return;
+    }
+
+    Slots()[slot].begin.store(nullptr, std::memory_order_release);
+    Slots()[slot].used.store(false, std::memory_order_release);
+  }
+};
+
+/***
+ * Storage policy with data buffer mapped by 'mmap' between two inaccessible guard pages, so writes out of buffer
+ * fault with no checks. Back border is placed right before the back guard page: without canaries it is empty and
+ * the first write past the buffer faults, with canaries the first 'Border' bytes of overflow hit the back canary
+ * and are found by 'StackOK', writes past it fault. Writes before buffer hit the front guard page after less than
+ * one element and the front border. Buffer takes at least one page, so the storage is meant for large stacks.
+ * 'Allocator' is not used
+ */
+struct StackGuardedStorage
+{
+  template <typename StkElemT, size_t Border, typename Allocator>
+  class Storage
+  {
+  private:
+    StkElemT *data = nullptr;
+    size_t capacity = 0;
+
+    char *map_begin = nullptr;
+    size_t map_size = 0;
+    size_t slot = STACK_GUARD_SLOTS;
+    const VarInfo *owner = nullptr;
+
+    static size_t PageSize()
+    {
+      static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+      return page_size;
+    }
+
+    /***
+     * Maps buffer for at least 'new_capacity' elements, capacity fills all its pages
+     *
+     * @return ERR_CODE - error code. If 'mmap' fails nothing is changed
+     */
+    ERR_CODE Map(size_t new_capacity, char **new_begin, size_t *new_size, StkElemT **new_data, size_t *new_cap)
+    {
+      size_t page = PageSize();
+      size_t bytes = new_capacity * sizeof(StkElemT) + Border * 2;
+      size_t data_pages = bytes == 0 ? 1 : (bytes + page - 1) / page;
+      size_t size = (data_pages + 2) * page;
+
+      auto begin = (char *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (begin == MAP_FAILED)
+      {
+        return ERR_ALLOC;
+      }
+
+      if (mprotect(begin, page, PROT_NONE) != 0 || mprotect(begin + size - page, page, PROT_NONE) != 0)
+      {
+        munmap(begin, size);
+        return ERR_ALLOC;
+      }
+
+      *new_cap = (data_pages * page - Border * 2) / sizeof(StkElemT);
+      *new_data = (StkElemT *)(begin + size - page - Border - *new_cap * sizeof(StkElemT));
+      *new_begin = begin;
+      *new_size = size;
+
+      return SUCCESS;
+    }
+
+    // unmapped pages are discarded by the system, so buffer is not cleared
+    void Unmap()
+    {
+      StackGuardRegistry::Unregister(slot);
+      munmap(map_begin, map_size);
+
+      slot = STACK_GUARD_SLOTS;
+      map_begin = nullptr;
+      map_size = 0;
+    }
+
+  public:
+    static const bool RELOCATES = true; // elements are moved by reallocation
+
+    explicit Storage(const Allocator & = Allocator())
+    {
+    }
+
+    Storage(const Storage &)
+    = delete;
+
+    Storage &operator=(const Storage &)
+    = delete;
+
+    StkElemT *Data() const
+    {
+      return data;
+    }
+
+    size_t Capacity() const
+    {
+      return capacity;
+    }
+
+    StkElemT &operator[](size_t pos) const
+    {
+      return data[pos];
+    }
+
+    size_t Segments() const
+    {
+      return data == nullptr ? 0 : 1;
+    }
+
+    StkElemT *Segment(size_t) const
+    {
+      return data;
+    }
+
+    size_t SegmentCapacity() const
+    {
+      return capacity;
+    }
+
+    /***
+     * Returns capacity stack grows to when it is full
+     */
+    size_t GrowCapacity() const
+    {
+      return capacity == 0 ? 1 : capacity * 2;
+    }
+
+    /***
+     * Called after pop, data buffer is shrunk only by 'Realloc'
+     */
+    void Trim(size_t)
+    {
+    }
+
+    /***
+     * Sets stack which is reported when its guard page is hit
+     */
+    void SetOwner(const VarInfo *new_owner)
+    {
+      owner = new_owner;
+    }
+
+    /***
+     * Maps data buffer. Capacity fills all pages of buffer
+     *
+     * @param size_t new_capacity - the number of elements buffer must hold
+     *
+     * @return ERR_CODE - error code
+     */
+    ERR_CODE Alloc(size_t new_capacity)
+    {
+      if (capacity != 0)
+      {
+        return ERR_EXCESS_ALLOC;
+      }
+
+      ERR_CODE code = Map(new_capacity, &map_begin, &map_size, &data, &capacity);
+      if (code != SUCCESS)
+      {
+        return code;
+      }
+
+      slot = StackGuardRegistry::Register(map_begin, map_begin + map_size, owner);
+      return SUCCESS;
+    }
+
+    /***
+     * Maps new data buffer and moves its first 'count' elements there
+     *
+     * @param size_t new_capacity - the number of elements buffer must hold
+     * @param size_t count        - the number of constructed elements, not greater than 'new_capacity'
+     *
+     * @return ERR_CODE - error code. If 'mmap' fails data buffer is kept
+     */
+    ERR_CODE Realloc(size_t new_capacity, size_t count)
+    {
+      if (data == nullptr)
+      {
+        return Alloc(new_capacity);
+      }
+
+      char *new_begin = nullptr;
+      size_t new_size = 0;
+      StkElemT *new_data = nullptr;
+      size_t new_cap = 0;
+
+      ERR_CODE code = Map(new_capacity, &new_begin, &new_size, &new_data, &new_cap);
+      if (code != SUCCESS)
+      {
+        return code;
+      }
+
+      StackRelocate(new_data, data, count);
+      Unmap();
+
+      map_begin = new_begin;
+      map_size = new_size;
+      data = new_data;
+      capacity = new_cap;
+      slot = StackGuardRegistry::Register(map_begin, map_begin + map_size, owner);
+
+      return SUCCESS;
+    }
+
+    /***
+     * Unmaps data buffer
+     */
+    void Free( )
+    {
+      if (data == nullptr)
+      {
+        return;
+      }
+
+      Unmap();
+      data = nullptr;
+      capacity = 0;
+    }
+  };
+};
+
+#endif //STACK_GUARD_PAGES
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/***
+ * Stack attributes
+ *
+ * @attrib Storage storage - storage of stack elements
+ * @attrib size_t size     - the number of elements
+ *
+ * @attrib[D] struct VarInfo debug_info - debug information about stack
+ */
+template <typename StkElemT, typename StoragePolicy, size_t Border, typename Allocator = StackMallocAllocator>
+struct StackCore
+{
+  typedef typename StoragePolicy::template Storage<StkElemT, Border, Allocator> StorageT;
+
+  StorageT storage;
+
+  size_t size = 0;
+
+  VarInfo debug_info;
+
+  explicit StackCore(const Allocator &alloc = Allocator()) : storage(alloc)
+  {
+  }
+};
+
+/***
+ * Stack template class
+ *
+ * @tparam StkElemT      - type of elements, any move constructible type
+ * @tparam CanaryPolicy  - canary protection: 'StackCanaryOn' or 'StackCanaryOff'
+ * @tparam HashPolicy    - hash protection: 'StackHashOn' or 'StackHashOff'
+ * @tparam VerifyPolicy  - checks made before and after every operation: 'StackVerifyDynamic',
+ *                         'StackVerifyFixed<level>' or 'StackVerifyOff'
+ * @tparam StoragePolicy - storage of elements: 'StackHeapStorage', 'StackSmallStorage<capacity>' or
+ *                         'StackSegmentedStorage<chunk capacity>' or 'StackGuardedStorage'
+ * @tparam Allocator     - allocator of data buffers: 'StackMallocAllocator', 'StackPoolAllocator' or
+ *                         'StackPmrAllocator' (C++17)
+ *
+ * Policies are base classes, so disabled ones are empty bases and cost no memory.
+ * Attributes are placed between front and back structure canaries.
+ */
+template <typename StkElemT = int, typename CanaryPolicy = StackCanaryDefault, typename HashPolicy = StackHashDefault,
+          typename VerifyPolicy = StackVerifyDynamic, typename StoragePolicy = StackHeapStorage,
+          typename Allocator = StackMallocAllocator>
+class StackT : private CanaryPolicy::template Guard<0>,
+               private StackCore<StkElemT, StoragePolicy,
+                                 StackBufBorder(CanaryPolicy::BUF_BORDER, alignof(StkElemT)), Allocator>,
+               private HashPolicy,
+               private VerifyPolicy,
+               private CanaryPolicy::template Guard<1>
+{
+private:
+  typedef typename CanaryPolicy::template Guard<0> FrontGuard;
+  typedef typename CanaryPolicy::template Guard<1> BackGuard;
+  typedef StackCore<StkElemT, StoragePolicy, StackBufBorder(CanaryPolicy::BUF_BORDER, alignof(StkElemT)),
+                    Allocator> Core;
+
+  using Core::storage;
+  using Core::size;
+  using Core::debug_info;
+
+  /***
+   * Returns size of stack data buffer (segment) in bytes
+   */
+  size_t BufSize() const
+  {
+    return storage.SegmentCapacity() * sizeof(StkElemT);
+  }
+
+  /***
+   * Writes canaries around data buffers starting from segment 'first_seg'
+   */
+  void SetBufCanaries(size_t first_seg)
+  {
+    for (size_t seg = first_seg; seg < storage.Segments(); seg++)
+    {
+      CanaryPolicy::SetBufCanaries(storage.Segment(seg), BufSize());
+    }
+  }
+
+  /***
+   * Checks canaries around data buffers from segment 'first_seg' to 'last_seg' inclusive
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE BufCanariesOK(size_t first_seg, size_t last_seg) const
+  {
+    for (size_t seg = first_seg; seg <= last_seg && seg < storage.Segments(); seg++)
+    {
+      ERR_CODE code = CanaryPolicy::BufCanariesOK(storage.Segment(seg), BufSize());
+      if (code != SUCCESS)
+      {
+        return code;
+      }
+    }
+
+    return SUCCESS;
+  }
+
+  /***
+   * Calls 'func(run, count, pos)' for every run of elements placed one after another in one data buffer,
+   * which together take positions from 'from' to 'to' exclusive. 'run' is the first element of run,
+   * 'pos' is its position
+   */
+  template <typename Func>
+  void ForEachRun(size_t from, size_t to, Func func)
+  {
+    while (from < to)
+    {
+      size_t offset = from % storage.SegmentCapacity();
+      size_t count = storage.SegmentCapacity() - offset < to - from ? storage.SegmentCapacity() - offset : to - from;
+
+      func(&storage[from], count, from);
+      from += count;
+    }
+  }
+
+  /***
+   * Destroys elements on positions from 'from' to 'to' exclusive
+   */
+  void DestroyElems(size_t from, size_t to)
+  {
+    ForEachRun(from, to, [](StkElemT *run, size_t count, size_t)
+    {
+      StackDestroy(run, count);
+    });
+  }
+
+  /***
+   * Allocates memory for stack data buffer
+   *
+   * @param size_t Capacity - the size of buffer which is asked by user
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE MemAlloc(size_t new_capacity)
+  {
+    // if stack protection is activated buffer has place for two canaries
+    ERR_CODE code = storage.Alloc(new_capacity);
+    if (code != SUCCESS)
+    {
+      return code;
+    }
+
+    //setting canaries to the head and end of stack buffer
+    SetBufCanaries(0);
+
+    //calculating hash function
+    HashPolicy::ResetHash(storage, size);
+
+    return SUCCESS;
+  }
+
+public:
+  /***
+   * Default stack constructor
+   *
+   * @param const Allocator &alloc - allocator of data buffer
+   */
+  StackT(VarInfo var_info = {}, const Allocator &alloc = Allocator()) : Core(alloc)
+  {
+    debug_info = std::move(var_info);
+    storage.SetOwner(&debug_info);
+
+    enum ERR_CODE code = MemAlloc(1);
+    if (code != SUCCESS)
+    {
+      ADD_LOG(code, 3);
+    }
+  }
+
+  /***
+   * Stack constructor with given capacity
+   *
+   * @param size_t new_capacity   - capacity of stack
+   * @param const Allocator &alloc - allocator of data buffer
+   */
+  StackT(size_t new_capacity, VarInfo var_info = {}, const Allocator &alloc = Allocator()) : Core(alloc)
+  {
+    debug_info = std::move(var_info);
+    storage.SetOwner(&debug_info);
+
+    enum ERR_CODE code = MemAlloc(new_capacity);
+    if (code != SUCCESS)
+    {
+      ADD_LOG(code, 3);
+    }
+  }
+
+  /***
+   * Reallocates memory for stack data buffer and clears the cut part of stack if new capacity is less than current
+   *
+   * @param size_t new_capacity  - new stack data buffer capacity
+   *
+   * @return ERR_CODE - error code.
+   *
+   * @note If 'new_capacity' is less than 'size', then 'size - new_capacity' elements are destroyed and set to zero.
+   *       Even if reallocation fails data will be available and elements will be destroyed.
+   */
+  ERR_CODE MemRealloc(size_t new_capacity)
+  {
+    ERR_CODE code;
+    STACK_OP_CHECK(code)
+
+    if (new_capacity < size)
+    {
+      // removing cut elements from hash
+      for (size_t pos = size; pos > new_capacity; pos--)
+      {
+        HashPolicy::RemoveHash(storage[pos - 1], pos - 1);
+      }
+      DestroyElems(new_capacity, size);
+      size = new_capacity;
+    }
+
+    // moved elements may have other bytes than the old ones, so their hash is verified before move
+    // and calculated again after it
+    bool rehash = Core::StorageT::RELOCATES && !StackIsTriviallyRelocatable<StkElemT>::value;
+    if (rehash)
+    {
+      code = HashPolicy::HashOK(storage, size);
+      if (code != SUCCESS)
+      {
+        StackDump(CURR_LOCATION);
+        return code;
+      }
+    }
+
+    size_t old_segments = storage.Segments();
+    code = storage.Realloc(new_capacity, size);
+    if (code != SUCCESS)
+    {
+      ADD_LOG_WITH_RETURN(code, 3);
+    }
+
+    //setting canaries to the head and end of stack buffer, segments which are not moved keep them
+    SetBufCanaries(Core::StorageT::RELOCATES ? 0 : old_segments);
+
+    if (rehash)
+    {
+      HashPolicy::ResetHash(storage, size);
+    }
+
+    STACK_OP_CHECK(code)
+
+    return SUCCESS;
+  }
+
+  /***
+   * Checks if all stack parameters have correct value and stack protection is not harmed
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE StackOK( )
+  {
+    VerifyPolicy::CountCheck(STACK_CHECK_FULL);
+
+    ERR_CODE code = StackStructOK();
+    if (code != SUCCESS)
+    {
+      return code;
+    }
+
+    code = BufCanariesOK(0, storage.Segments());
+    if (code != SUCCESS)
+    {
+      return code;
+    }
+
+    return HashPolicy::HashOK(storage, size);
+  }
+
+  /***
+   * Checks stack the same way as 'StackOK', but verifies hash incrementally by scrub. Costs O(1)
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE StackStepOK( )
+  {
+    VerifyPolicy::CountCheck(STACK_CHECK_SCRUB);
+
+    ERR_CODE code = StackStructOK();
+    if (code != SUCCESS)
+    {
+      return code;
+    }
+
+    return HashPolicy::ScrubOK(storage, size);
+  }
+
+  /***
+   * Checks stack as much as its verification policy asks. Called before and after every stack operation
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE StackOpOK( )
+  {
+    switch (VerifyPolicy::NextCheck())
+    {
+      case STACK_CHECK_NONE:
+        return SUCCESS;
+      case STACK_CHECK_SCRUB:
+        return StackStepOK();
+      case STACK_CHECK_FULL:
+        return StackOK();
+      case STACK_CHECK_CHEAP:
+      default:
+        VerifyPolicy::CountCheck(STACK_CHECK_CHEAP);
+        return StackStructOK();
+    }
+  }
+
+  /***
+   * Sets checks made before and after every stack operation. Only for 'StackVerifyDynamic' policy
+   *
+   * @param STACK_VERIFY level - verification level
+   * @param size_t period      - period of full checks of STACK_VERIFY_SAMPLED level, 1 makes every check full
+   */
+  void SetVerifyLevel(STACK_VERIFY level, size_t period = STACK_VERIFY_PERIOD)
+  {
+    VerifyPolicy::SetVerifyLevel(level, period);
+  }
+
+  /***
+   * Returns numbers of stack checks which were made
+   */
+  const StackCheckCounters &GetCheckCounters() const
+  {
+    return VerifyPolicy::CheckCounters();
+  }
+
+private:
+  /***
+   * Checks stack attributes and canaries, but not the hash. Only canaries of the data buffer with the top element
+   * are checked, as other segments may be changed only by writes out of it
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE StackStructOK( )
+  {
+    STACK_VERIFY_CHECK(storage.Data() == nullptr,    ERR_NULL_ATTRIB);
+    STACK_VERIFY_CHECK(size > storage.Capacity(),    ERR_OVERFLOW);
+    STACK_VERIFY_CHECK(!FrontGuard::CanaryOK(),      ERR_FRONT_CANARY);
+    STACK_VERIFY_CHECK(!BackGuard::CanaryOK(),       ERR_BACK_CANARY);
+
+    size_t top_seg = size == 0 ? 0 : (size - 1) / storage.SegmentCapacity();
+    return BufCanariesOK(top_seg, top_seg);
+  }
+
+public:
+
+  /***
+   * Adds element to the stack
+   *
+   * @param StkElemT value - adding element, it is moved into the stack
+   *
+   * @return ERR_CODE - error code
+   */
+  ERR_CODE Push(StkElemT value)
+  {
+    return EmplacePush(std::move(value));
+  }
+
+  /***
+   * Constructs element on the top of the stack
+   *
+   * @param Args &&...args - arguments of element constructor
+   *
+   * @return ERR_CODE - error code
+   *
+   * @note Arguments must not refer to stack elements, as they may be moved by reallocation before construction
+   */
+  template <typename... Args>
+  ERR_CODE EmplacePush(Args &&...args)
+  {
+    ERR_CODE code;
+
+    STACK_OP_CHECK(code)
+
+    if (size == storage.Capacity())
+    {
+      code = MemRealloc(storage.GrowCapacity());
+      if (code != SUCCESS)
+      {
+        ADD_LOG_WITH_RETURN(code, 3);
+      }
+    }
+
+    new (&storage[size]) StkElemT(std::forward<Args>(args)...);
+    HashPolicy::AddHash(storage[size], size);
+    size++;
 
-    //calculating hash function
-    ON_STACK_HASH_PROTECTION(
-      ReCalcHash();
-      )
+    STACK_OP_CHECK(code)
 
     return SUCCESS;
   }
 
-public:
   /***
-   * Default stack constructor
+   * Deletes element from the stack and moves it to the pointer given as a parameter
+   *
+   * @param StkElemT *receiver - pointer to the variable to receive the getting stack element
+   *
+   * @return ERR_CODE - error code
    */
-  StackT(VarInfo var_info = {})
+  ERR_CODE Pop(StkElemT *receiver)
   {
-    debug_info = std::move(var_info);
+    ERR_CODE code;
 
-    enum ERR_CODE code = MemAlloc(1);
-    if (code != SUCCESS)
+    STACK_OP_CHECK(code)
+
+    if (size == 0)
     {
-      ADD_LOG(code, 3);
+      return FAILURE;
     }
 
-    ON_STACK_CANARY_PROTECTION(canaryFront = 0xDEADBEEFBADF00D;)
-    ON_STACK_CANARY_PROTECTION(canaryBack = 0xDEADBEEFBADF00D;)
+    // hash is removed before move, which changes the element
+    HashPolicy::RemoveHash(storage[size - 1], size - 1);
+    *receiver = std::move(storage[size - 1]);
+    StackDestroy(&storage[size - 1], 1);
+    size--;
+    storage.Trim(size);
+
+    STACK_OP_CHECK(code)
+
+    return SUCCESS;
   }
 
   /***
-   * Stack constructor with given capacity
+   * Deletes element from the stack and returns it
    *
-   * @param size_t new_capacity - capacity of stack
+   * @return std::pair<StkElemT, ERR_CODE> - moved element and error code. Element is default constructed on error
    */
-  StackT(size_t new_capacity, VarInfo var_info = {}) : debug_info(std::move(var_info))
+  std::pair<StkElemT, ERR_CODE> Pop()
   {
-    enum ERR_CODE code = MemAlloc(new_capacity);
-    if (code != SUCCESS)
-    {
-      ADD_LOG(code, 3);
-    }
+    std::pair<StkElemT, ERR_CODE> result;
+    result.second = Pop(&result.first);
 
-    ON_STACK_CANARY_PROTECTION(canaryFront = 0xDEADBEEFBADF00D;)
-    ON_STACK_CANARY_PROTECTION(canaryBack = 0xDEADBEEFBADF00D;)
+    return result;
   }
 
   /***
-   * Reallocates memory for stack data buffer and clears the cut part of stack if new capacity is less than current
-   *
-   * @param size_t new_capacity  - new stack data buffer capacity
+   * Adds 'count' elements to the stack, 'values[count - 1]' becomes the top one.
+   * Stack is checked and reallocated once for all elements
    *
-   * @return ERR_CODE - error code.
+   * @param const StkElemT *values - adding elements, they must not be stack elements
+   * @param size_t count           - the number of elements
    *
-   * @note If 'new_capacity' is less than 'size', then 'size - new_capacity' elements are set to zero.
-   *       Even if 'realloc' fails data will be available and elements will be set to zero.
+   * @return ERR_CODE - error code
    */
-  ERR_CODE MemRealloc(size_t new_capacity)
+  ERR_CODE PushN(const StkElemT *values, size_t count)
   {
     ERR_CODE code;
-    STACK_DUMP_CHECK(code)
 
-    if (new_capacity < size)
+    STACK_OP_CHECK(code)
+
+    if (count > storage.Capacity() - size)
     {
-      memset(&(this->data[new_capacity]), '0', sizeof(StkElemT) * (this->size - new_capacity));
-      this->size = new_capacity;
+      size_t new_capacity = storage.GrowCapacity();
+      code = MemRealloc(new_capacity - size < count ? size + count : new_capacity);
+      if (code != SUCCESS)
+      {
+        ADD_LOG_WITH_RETURN(code, 3);
+      }
     }
 
-    ON_STACK_CANARY_PROTECTION(data = (StkElemT *)((char *)data - sizeof(StkCanaryT));)
-
-    auto ptr = (StkElemT *)realloc((void *)this->data, new_capacity * sizeof(StkElemT)
-                                                            ON_STACK_CANARY_PROTECTION(+ sizeof(StkCanaryT) * 2) );
-
-    if (ptr == nullptr)
+    ForEachRun(size, size + count, [this, values](StkElemT *run, size_t run_count, size_t pos)
     {
-      ADD_LOG_WITH_RETURN(ERR_ALLOC, 3);
-    }
-    this->data = ptr;
-    this->capacity = new_capacity;
+      const StkElemT *src = values + (pos - size);
 
-    //setting canaries to the head and end of stack buffer
-    ON_STACK_CANARY_PROTECTION(
-      *((StkCanaryT *)data) = 0xDEADBEEFBADF00D;
-      *((StkCanaryT *)((char *)data + sizeof(StkCanaryT) + sizeof(StkElemT) * capacity)) = 0xDEADBEEFBADF00D;
-      data = (StkElemT *)((char *)data + sizeof(StkCanaryT));
-    )
+      if (std::is_trivially_copyable<StkElemT>::value)
+      {
+        memcpy((void *)run, (const void *)src, run_count * sizeof(StkElemT));
+      }
+      else
+      {
+        for (size_t i = 0; i < run_count; i++)
+        {
+          new (run + i) StkElemT(src[i]);
+        }
+      }
 
-    //calculating hash function
-    ON_STACK_HASH_PROTECTION(
-      ReCalcHash();
-    )
+      for (size_t i = 0; i < run_count; i++)
+      {
+        HashPolicy::AddHash(run[i], pos + i);
+      }
+    });
+    size += count;
 
-    STACK_DUMP_CHECK(code)
+    STACK_OP_CHECK(code)
 
     return SUCCESS;
   }
 
   /***
-   * Checks if all stack parameters have correct value and stack protection is not harmed
+   * Deletes 'count' elements from the stack and moves them to 'receiver' in the stack order,
+   * so the former top element is 'receiver[count - 1]' and 'PushN' with the same array restores the stack.
+   * Stack is checked once for all elements
    *
-   * @param StackT *stk - pointer to the stack to check
+   * @param StkElemT *receiver - array of at least 'count' elements to receive the getting stack elements
+   * @param size_t count       - the number of elements
    *
-   * @return ERR_CODE - error code
+   * @return ERR_CODE - error code. If stack has less than 'count' elements, nothing is deleted
    */
-  ERR_CODE StackOK( )
+  ERR_CODE PopN(StkElemT *receiver, size_t count)
   {
-    STACK_VERIFY_CHECK(data == nullptr, ERR_NULL_ATTRIB);
-    STACK_VERIFY_CHECK(size > capacity, ERR_OVERFLOW);
-    STACK_VERIFY_CHECK(size < 0,        ERR_UNDERFLOW);
-    ON_STACK_CANARY_PROTECTION(
-      STACK_VERIFY_CHECK(canaryFront != 0xDEADBEEFBADF00D, ERR_FRONT_CANARY);
-      STACK_VERIFY_CHECK(canaryBack != 0xDEADBEEFBADF00D,  ERR_FRONT_CANARY);
-      STACK_VERIFY_CHECK(*((StkCanaryT *)((char *)data - sizeof(StkCanaryT))) != 0xDEADBEEFBADF00D, ERR_FRONT_CANARY);
-      STACK_VERIFY_CHECK(*((StkCanaryT *)((char *)data - sizeof(StkCanaryT))) != 0xDEADBEEFBADF00D, ERR_FRONT_CANARY);
-    )
-    ON_STACK_HASH_PROTECTION(
-      STACK_VERIFY_CHECK(ReCalcHash() != hash, ERR_HASH_BREAK);
-    )
+    ERR_CODE code;
+
+    STACK_OP_CHECK(code)
+
+    if (count > size)
+    {
+      return FAILURE;
+    }
+
+    // hash is removed before move, which changes the elements
+    for (size_t pos = size; pos > size - count; pos--)
+    {
+      HashPolicy::RemoveHash(storage[pos - 1], pos - 1);
+    }
+
+    size_t first = size - count;
+    ForEachRun(first, size, [receiver, first](StkElemT *run, size_t run_count, size_t pos)
+    {
+      StkElemT *dest = receiver + (pos - first);
+
+      if (std::is_trivially_copyable<StkElemT>::value)
+      {
+        memcpy((void *)dest, (const void *)run, run_count * sizeof(StkElemT));
+      }
+      else
+      {
+        for (size_t i = 0; i < run_count; i++)
+        {
+          dest[i] = std::move(run[i]);
+        }
+      }
+
+      StackDestroy(run, run_count);
+    });
+    size = first;
+    storage.Trim(size);
+
+    STACK_OP_CHECK(code)
 
     return SUCCESS;
   }
 
   /***
-   * Adds element to the stack
-   *
-   * @param StkElemT value - adding element
-   *
-   * @return ERR_CODE - error code
+   * Read-only view of stack elements, valid until the stack is changed.
+   * Elements may not be changed through it, as that breaks stack hash
    */
-  ERR_CODE Push(StkElemT value)
+  class Range
   {
-    ERR_CODE code;
-
-    STACK_DUMP_CHECK(code)
+  private:
+    const typename Core::StorageT *storage = nullptr;
+    size_t first = 0;
+    size_t count = 0;
 
-    if (size == capacity)
+  public:
+    class Iterator
     {
-      code = MemRealloc(capacity * 2);
-      if (code != SUCCESS)
+    private:
+      const Range *range;
+      size_t index;
+
+    public:
+      Iterator(const Range *init_range, size_t init_index) : range(init_range), index(init_index)
       {
-        ADD_LOG_WITH_RETURN(code, 3);
       }
+
+      const StkElemT &operator*() const
+      {
+        return (*range)[index];
+      }
+
+      Iterator &operator++()
+      {
+        index++;
+        return *this;
+      }
+
+      bool operator!=(const Iterator &other) const
+      {
+        return index != other.index;
+      }
+    };
+
+    Range()
+    = default;
+
+    Range(const typename Core::StorageT *init_storage, size_t init_first, size_t init_count) :
+      storage(init_storage), first(init_first), count(init_count)
+    {
     }
 
-    data[size] = value;
-    size++;
+    /***
+     * Returns 'index'-th element of view, the last one is the top element
+     */
+    const StkElemT &operator[](size_t index) const
+    {
+      return (*storage)[first + index];
+    }
 
-    ON_STACK_HASH_PROTECTION(ResetHash();)
+    size_t Size() const
+    {
+      return count;
+    }
 
-    STACK_DUMP_CHECK(code)
+    Iterator begin() const
+    {
+      return Iterator(this, 0);
+    }
 
-    return SUCCESS;
-  }
+    Iterator end() const
+    {
+      return Iterator(this, count);
+    }
+  };
 
   /***
-   * Deletes element from the stack and returns it to the pointer given as a parameter
+   * Gives view of 'count' top elements of the stack in the stack order, the top one is the last
    *
-   * @param StkElemT *receiver - pointer to the variable to receive the getting stack element
+   * @param size_t count - the number of elements
+   * @param Range *range - pointer to the variable to receive the view
    *
-   * @return ERR_CODE - error code
+   * @return ERR_CODE - error code. If stack has less than 'count' elements, view is not changed
    */
-  ERR_CODE Pop(StkElemT *receiver)
+  ERR_CODE PeekRange(size_t count, Range *range)
   {
     ERR_CODE code;
 
-    STACK_DUMP_CHECK(code)
+    STACK_OP_CHECK(code)
 
-    if (size == 0)
+    if (count > size)
     {
       return FAILURE;
     }
 
-    *receiver = data[size - 1];
-    data[size - 1] = 0;
-    size--;
-
-    ON_STACK_HASH_PROTECTION(ResetHash();)
-
-    STACK_DUMP_CHECK(code)
+    *range = Range(&storage, size - count, count);
 
     return SUCCESS;
   }
@@ -388,14 +2785,14 @@ public:
   ERR_CODE Clear()
   {
     ERR_CODE code;
-    STACK_DUMP_CHECK(code)
+    STACK_OP_CHECK(code)
 
-    memset(&(data[0]), '0', sizeof(StkElemT) * size);
+    DestroyElems(0, size);
     size = 0;
 
-    ON_STACK_HASH_PROTECTION(ResetHash();)
+    HashPolicy::ResetHash(storage, size);
 
-    STACK_DUMP_CHECK(code)
+    STACK_OP_CHECK(code)
 
     return SUCCESS;
   }
@@ -405,19 +2802,17 @@ public:
    */
   ~StackT()
   {
-    if (!StackOK())
+    if (StackOpOK() != SUCCESS)
     {
       StackDump(CURR_LOCATION, "stack_destr_dump.txt");
     }
 
-    ON_STACK_CANARY_PROTECTION(
-    data = (StkElemT *)((char *)data - sizeof(StkCanaryT));
-    )
-    memset(&(data[0]), '0', sizeof(StkElemT) * capacity
-    			     ON_STACK_CANARY_PROTECTION(+ 2 * sizeof(StkCanaryT)) );
-    free(data);
+    if (storage.Data() != nullptr)
+    {
+      DestroyElems(0, size <= storage.Capacity() ? size : storage.Capacity());
+    }
+    storage.Free();
     size = 0;
-    capacity = 0;
   }
 
   /***
@@ -430,9 +2825,9 @@ public:
     ERR_CODE code;
     STACK_DUMP_CHECK(code)
 
-    for (int i = 0; i < size; i++)
+    for (size_t i = 0; i < size; i++)
     {
-      os << "[" << i << "]" << " : " << data[i] << std::endl;
+      os << "[" << i << "]" << " : " << storage[i] << std::endl;
     }
 
     return SUCCESS;
@@ -475,85 +2870,62 @@ public:
     "{\n", debug_info.var_name.c_str());
     os << buf;
 
-    ON_STACK_CANARY_PROTECTION(os << "canaryFront - " << canaryFront << std::endl;)
-    ON_STACK_HASH_PROTECTION(os << "Hash - " << hash << std::endl;)
+    FrontGuard::DumpCanary(os, "canaryFront");
+    HashPolicy::DumpHash(os);
+    VerifyPolicy::DumpVerify(os);
 
     sprintf(buf,
     "  size - %zu\n"
     "  capacity - %zu\n"
     "  data[%p]\n"
-    "    {\n", size, capacity, data);
+    "    {\n", size, storage.Capacity(), (void *)storage.Data());
     os << buf;
 
-    ON_STACK_CANARY_PROTECTION(os << "Buffer canaryFront - " << *(StkCanaryT *)((char *)data - sizeof(StkCanaryT)) << std::endl;)
-
-    for (int i = 0; i < size; i++)
+    for (size_t seg = 0; seg < storage.Segments(); seg++)
     {
-      os << "      *[" << i << "] = " << data[i] << std::endl;
-    }
+      StkElemT *data = storage.Segment(seg);
+      size_t first = seg * storage.SegmentCapacity();
 
-    for (int i = size; i < capacity; i++)
-    {
-      os << "      [" << i << "] = " << data[i] << std::endl;
-    }
+      if (seg != 0)
+      {
+        os << "      segment " << seg << " [" << (void *)data << "]" << std::endl;
+      }
+      CanaryPolicy::DumpBufCanary(os, "Buffer canaryFront", data, -(ptrdiff_t)CanaryPolicy::BUF_BORDER);
+
+      for (size_t i = first; i < first + storage.SegmentCapacity(); i++)
+      {
+        if (i < size)
+        {
+          os << "      *[" << i << "] = " << storage[i] << std::endl;
+          continue;
+        }
+
+        // free places hold no objects, so only bytes of trivial elements may be printed
+        os << "      [" << i << "] = ";
+        DumpFreeElem(os, storage[i], std::is_trivially_copyable<StkElemT>());
+        os << std::endl;
+      }
 
-    ON_STACK_CANARY_PROTECTION(os << "Buffer canaryBack - " << *(StkCanaryT *)((char *)data + sizeof(StkElemT) * capacity) << std::endl;)
+      CanaryPolicy::DumpBufCanary(os, "Buffer canaryBack", data, (ptrdiff_t)BufSize());
+    }
 
     os << "    }\n";
-    ON_STACK_CANARY_PROTECTION(os << "canaryBack - " << canaryBack << std::endl;)
+    BackGuard::DumpCanary(os, "canaryBack");
     os << "}\n";
   }
 
-  #ifdef STACK_HASH_PROTECTION
-  /***
-   * Calculates hash for stack buffer
-   */
 private:
-
-  /***
- * Makes bitwise shift of value to the left (RotateLeft) and the leading bit goes to the end and not lost
- *
- * @param HashT value - value to be rotated
- *
- * @return HashT - rotated value
- */
-  static HashT RoL(HashT value)
-  {
-    return (value << 1u) | (value >> (8u * sizeof(value) - 1u));
-  }
-
-  /***
- * Calculates buffer hash
- *
- * @param void *buffer - buffer to calculate hash
- * @param size_t size  - size of buffer
- *
- * @return HashT - calculated hash value
- */
-  static HashT Hash(void *buffer, const size_t &buf_size)
-  {
-    auto buf_ptr = (uchar *)buffer;
-    HashT value = 0;
-
-    for (size_t i = 0; i < buf_size * sizeof(StkElemT); i++)
-    {
-      value = RoL(value) ^ buf_ptr[i];
-    }
-
-    return value;
-  }
-
-  HashT ReCalcHash( )
+  static void DumpFreeElem(std::ostream &os, const StkElemT &elem, std::true_type)
   {
-    return Hash((void *)data, size);
+    os << elem;
   }
 
-  void ResetHash( )
+  static void DumpFreeElem(std::ostream &os, const StkElemT &, std::false_type)
   {
-    hash = ReCalcHash();
+    os << "<free>";
   }
-  #endif // STACK_HASH_PROTECTION
 
+public:
   /************************
    * List of friend functions.
    * Used to get the private attributes of stack while testing
@@ -561,6 +2933,16 @@ private:
   friend void StackTester();
 };
 
+/***
+ * Stack with all protections, checks are chosen at run time
+ */
+template <typename StkElemT>
+using ProtectedStackT = StackT<StkElemT, StackCanaryOn, StackHashOn, StackVerifyDynamic>;
+
+#ifdef STACK_GUARD_PAGES
+#include <sys/wait.h> // guard page faults are tested in child processes
+#endif //STACK_GUARD_PAGES
+
 /***
    * Tests 'text_functions.h' file functions.
    */
@@ -571,18 +2953,18 @@ void StackTester( )
 
   std::cout << "Stack tester\n";
   std::cout << "Note: estimated values will be print in the braces after the real value\n\n";
-  std::cout << "Stack list:\n" << "StackT<int> stk1 = { }\n" << "StackT<double> stk2(200)\n" << std::endl;
+  std::cout << "Stack list:\n" << "ProtectedStackT<int> stk1 = { }\n" << "ProtectedStackT<double> stk2(200)\n" << std::endl;
 
   std::cout << "///////////////////// Constructor and memory allocation/reallocation /////////////////////\n";
 
-  StackT<int> stk1 = {VarInfo("stk1", CURR_LOCATION)};
-  StackT<double> stk2(200, VarInfo("stk2", CURR_LOCATION));
+  ProtectedStackT<int> stk1 = {VarInfo("stk1", CURR_LOCATION)};
+  ProtectedStackT<double> stk2(200, VarInfo("stk2", CURR_LOCATION));
 
   std::cout << "Stack variables creation :" << std::endl;
   std::cout << "stk1.size = " << stk1.size << " (0)" << std::endl;
   std::cout << "stk2.size = " << stk2.size << " (0)" << std::endl;
-  std::cout << "stk1.capacity = " << stk1.capacity << " (1)" << std::endl;
-  std::cout << "stk2.capacity = " << stk2.capacity << " (200)" << std::endl;
+  std::cout << "stk1.capacity = " << stk1.storage.Capacity() << " (1)" << std::endl;
+  std::cout << "stk2.capacity = " << stk2.storage.Capacity() << " (200)" << std::endl;
   std::cout << std::endl;
 
   std::cout << "Reallocation :" << std::endl;
@@ -590,8 +2972,8 @@ void StackTester( )
   stk2.MemRealloc(5);
   std::cout << "stk1.size = " << stk1.size << " (0)" << std::endl;
   std::cout << "stk2.size = " << stk2.size << " (0)" << std::endl;
-  std::cout << "stk1.capacity = " << stk1.capacity << " (1000)" << std::endl;
-  std::cout << "stk2.capacity = " << stk2.capacity << " (5)" << std::endl;
+  std::cout << "stk1.capacity = " << stk1.storage.Capacity() << " (1000)" << std::endl;
+  std::cout << "stk2.capacity = " << stk2.storage.Capacity() << " (5)" << std::endl;
   std::cout << std::endl;
 
   code1 = stk1.StackOK();
@@ -616,14 +2998,14 @@ void StackTester( )
 
   std::cout << "stk1 : " << std::endl;
   std::cout << "size - " << stk1.size << " (10) " << std::endl;
-  std::cout << "capacity - " << stk1.capacity << " (1000) " << std::endl;
+  std::cout << "capacity - " << stk1.storage.Capacity() << " (1000) " << std::endl;
   std:: cout << "data - numbers from 0 to 9:" << std::endl;
   stk1.StackPrint(std::cout);
   std::cout << std::endl;
 
   std::cout << "stk2 : " << std::endl;
   std::cout << "size - " << stk2.size << " (15) " << std::endl;
-  std::cout << "capacity - " << stk2.capacity << " (20) " << std::endl;
+  std::cout << "capacity - " << stk2.storage.Capacity() << " (20) " << std::endl;
   std:: cout << "data - numbers from 0 to 14:" << std::endl;
   stk2.StackPrint(std::cout);
   std::cout << std::endl;
@@ -649,18 +3031,15 @@ void StackTester( )
   std::cout << std::endl;
 
   std::cout << "///////////////////// Hash protection check /////////////////////\n";
-  #ifndef STACK_HASH_PROTECTION
-  #define STACK_HASH_PROTECTION
-  #endif //STACK_HASH_PROTECTION
 
-  std::cout << "Hash of 'stk1' - " << stk1.hash << " (39093746760)" << std::endl;
-  std::cout << "Hash of 'stk2' - " << stk2.hash << " (8647433863363066984)" << std::endl;
+  std::cout << "Hash of 'stk1' - " << stk1.hash << " (7798498088350665076)" << std::endl;
+  std::cout << "Hash of 'stk2' - " << stk2.hash << " (17560212900362892045)" << std::endl;
 
-  stk1.data[stk1.size / 2] = 0;
-  stk2.data[stk2.size / 2] = 0;
+  stk1.storage[stk1.size / 2] = 0;
+  stk2.storage[stk2.size / 2] = 0;
 
-  std::cout << "Hash after changing one element of 'stk1' - " << stk1.ReCalcHash() << " (39093746760)" << std::endl;
-  std::cout << "Hash after changing one element of 'stk2' - " << stk2.ReCalcHash() << " (8647433863363066984)" << std::endl;
+  std::cout << "Hash after changing one element of 'stk1' - " << stk1.ReCalcHash(stk1.storage, stk1.size) << " (7798498088350665076)" << std::endl;
+  std::cout << "Hash after changing one element of 'stk2' - " << stk2.ReCalcHash(stk2.storage, stk2.size) << " (17560212900362892045)" << std::endl;
 
   code1 = stk1.StackOK();
   code2 = stk2.StackOK();
@@ -698,14 +3077,14 @@ void StackTester( )
 
   std::cout << "stk1 : " << std::endl;
   std::cout << "size - " << stk1.size << " (4) " << std::endl;
-  std::cout << "capacity - " << stk1.capacity << " (1000) " << std::endl;
+  std::cout << "capacity - " << stk1.storage.Capacity() << " (1000) " << std::endl;
   std:: cout << "data - numbers from 0 to 3:" << std::endl;
   stk1.StackPrint(std::cout);
   std::cout << std::endl;
 
   std::cout << "stk2 : " << std::endl;
   std::cout << "size - " << stk2.size << " (0) " << std::endl;
-  std::cout << "capacity - " << stk2.capacity << " (20) " << std::endl;
+  std::cout << "capacity - " << stk2.storage.Capacity() << " (20) " << std::endl;
   std:: cout << "data - none:" << std::endl;
   stk2.StackPrint(std::cout);
   std::cout << std::endl;
@@ -724,7 +3103,7 @@ void StackTester( )
 
   std::cout << "stk1 : " << std::endl;
   std::cout << "size - " << stk1.size << " (0) " << std::endl;
-  std::cout << "capacity - " << stk1.capacity << " (1000) " << std::endl;
+  std::cout << "capacity - " << stk1.storage.Capacity() << " (1000) " << std::endl;
   std:: cout << "data - none:" << std::endl;
   stk1.StackPrint(std::cout);
   std::cout << std::endl;
@@ -735,13 +3114,318 @@ void StackTester( )
   print_err(std::cout, code1);
   std::cout << std::endl;
 
+  std::cout << "///////////////////// Verification levels /////////////////////\n";
+  ProtectedStackT<int> stk3(VarInfo("stk3", CURR_LOCATION));
+  int tmp3;
+
+  stk3.SetVerifyLevel(STACK_VERIFY_SAMPLED, 10);
+  for (int i = 0; i < 100; i++)
+  {
+    stk3.Push(i);
+  }
+
+  std::cout << "stk3 : 100 pushes with sampled verification, full check every 10-th time (7 reallocations) :" << std::endl;
+  std::cout << "cheap checks - " << stk3.GetCheckCounters().cheap << " (193)" << std::endl;
+  std::cout << "full checks - " << stk3.GetCheckCounters().full << " (21)" << std::endl;
+
+  stk3.SetVerifyLevel(STACK_VERIFY_OFF);
+  for (int i = 0; i < 50; i++)
+  {
+    stk3.Pop(&tmp3);
+  }
+
+  stk3.SetVerifyLevel(STACK_VERIFY_PARANOID);
+  for (int i = 0; i < 10; i++)
+  {
+    stk3.Push(i);
+  }
+
+  std::cout << "stk3 : 50 pops without verification, 10 pushes with paranoid verification :" << std::endl;
+  std::cout << "cheap checks - " << stk3.GetCheckCounters().cheap << " (193)" << std::endl;
+  std::cout << "full checks - " << stk3.GetCheckCounters().full << " (41)" << std::endl;
+
+  code1 = stk3.StackOK();
+
+  std::cout << "Error code for stk3 : ";
+  print_err(std::cout, code1);
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Policies /////////////////////\n";
+  typedef StackT<int, StackCanaryOff, StackHashOff, StackVerifyOff> FastStackT;
+
+  std::cout << "sizeof(FastStackT<int>) - " << sizeof(FastStackT)
+            << " (" << sizeof(StackCore<int, StackHeapStorage, 0>) << ")" << std::endl;
+  std::cout << "sizeof(ProtectedStackT<int>) - " << sizeof(ProtectedStackT<int>)
+            << " (" << sizeof(StackCore<int, StackHeapStorage, 0>) + 2 * sizeof(StkCanaryT) + sizeof(StackHashOn)
+                       + sizeof(StackVerifyDynamic) << ")" << std::endl;
+
+  FastStackT stk4(VarInfo("stk4", CURR_LOCATION));
+  int tmp4 = 0;
+  for (int i = 0; i < 10; i++)
+  {
+    stk4.Push(i);
+  }
+  stk4.Pop(&tmp4);
+
+  std::cout << "stk4 : " << std::endl;
+  std::cout << "size - " << stk4.size << " (9) " << std::endl;
+  std::cout << "top - " << tmp4 << " (9) " << std::endl;
+  std::cout << "checks made - " << stk4.GetCheckCounters().cheap + stk4.GetCheckCounters().full << " (0) " << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Small buffer /////////////////////\n";
+  StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackSmallStorage<8>> stk5(VarInfo("stk5", CURR_LOCATION));
+  int tmp5 = 0;
+
+  for (int i = 0; i < 8; i++)
+  {
+    stk5.Push(i);
+  }
+
+  std::cout << "stk5 : 8 pushes into inline buffer of 8 elements :" << std::endl;
+  std::cout << "inline - " << stk5.storage.IsInline() << " (1) " << std::endl;
+  std::cout << "capacity - " << stk5.storage.Capacity() << " (8) " << std::endl;
+  std::cout << "Error code for stk5 : ";
+  print_err(std::cout, stk5.StackOK());
+
+  stk5.Push(8);
+
+  std::cout << "stk5 : one more push moves buffer to the heap :" << std::endl;
+  std::cout << "inline - " << stk5.storage.IsInline() << " (0) " << std::endl;
+  std::cout << "capacity - " << stk5.storage.Capacity() << " (16) " << std::endl;
+  std::cout << "Error code for stk5 : ";
+  print_err(std::cout, stk5.StackOK());
+
+  for (int i = 0; i < 5; i++)
+  {
+    stk5.Pop(&tmp5);
+  }
+  stk5.MemRealloc(4);
+
+  std::cout << "stk5 : 5 pops and reallocation to 4 elements move buffer back :" << std::endl;
+  std::cout << "inline - " << stk5.storage.IsInline() << " (1) " << std::endl;
+  std::cout << "capacity - " << stk5.storage.Capacity() << " (8) " << std::endl;
+  std::cout << "data - numbers from 0 to 3:" << std::endl;
+  stk5.StackPrint(std::cout);
+
+  stk5.storage[1] = 100;
+  std::cout << "Error code for stk5 after changing one element : ";
+  print_err(std::cout, stk5.StackOK());
+
+  stk5.storage[1] = 1;
+  stk5.storage[stk5.storage.Capacity()] = 100;
+  std::cout << "Error code for stk5 after writing past the inline buffer : ";
+  print_err(std::cout, stk5.StackOK());
+  StackCanaryOn::SetBufCanaries(stk5.storage.Data(), stk5.storage.Capacity() * sizeof(int));
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Non-trivial elements /////////////////////\n";
+  ProtectedStackT<std::string> stk6(VarInfo("stk6", CURR_LOCATION));
+  std::string long_str(40, 'a');
+
+  stk6.Push("short");
+  stk6.Push(std::move(long_str));
+  stk6.EmplacePush(3, 'b');
+  for (int i = 0; i < 6; i++)
+  {
+    stk6.EmplacePush(20 + i, 'c');
+  }
+
+  std::cout << "stk6 : 9 pushes of strings with 4 reallocations :" << std::endl;
+  std::cout << "moved string size - " << long_str.size() << " (0) " << std::endl;
+  std::cout << "capacity - " << stk6.storage.Capacity() << " (16) " << std::endl;
+  std::cout << "Error code for stk6 : ";
+  print_err(std::cout, stk6.StackOK());
+
+  for (int i = 0; i < 6; i++)
+  {
+    stk6.Pop();
+  }
+  std::pair<std::string, ERR_CODE> top6 = stk6.Pop();
+
+  std::cout << "stk6 : 7 pops, the last one returns :" << std::endl;
+  std::cout << "string - " << top6.first << " (bbb) " << std::endl;
+  std::cout << "Error code for pop : ";
+  print_err(std::cout, top6.second);
+
+  stk6.MemRealloc(1);
+  std::cout << "stk6 : reallocation to 1 element :" << std::endl;
+  std::cout << "data - \"short\":" << std::endl;
+  stk6.StackPrint(std::cout);
+  std::cout << "Error code for stk6 : ";
+  print_err(std::cout, stk6.StackOK());
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Segmented storage /////////////////////\n";
+  StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackSegmentedStorage<4>> stk7(VarInfo("stk7",
+                                                                                                     CURR_LOCATION));
+  int tmp7 = 0;
+
+  stk7.Push(0);
+  int *first7 = &stk7.storage[0];
+  for (int i = 1; i < 10; i++)
+  {
+    stk7.Push(i);
+  }
+
+  std::cout << "stk7 : 10 pushes into chunks of 4 elements :" << std::endl;
+  std::cout << "chunks - " << stk7.storage.Segments() << " (3) " << std::endl;
+  std::cout << "capacity - " << stk7.storage.Capacity() << " (12) " << std::endl;
+  std::cout << "first element is not moved - " << (first7 == &stk7.storage[0]) << " (1) " << std::endl;
+  std::cout << "Error code for stk7 : ";
+  print_err(std::cout, stk7.StackOK());
+
+  for (int i = 0; i < 2; i++)
+  {
+    stk7.Pop(&tmp7);
+  }
+
+  std::cout << "stk7 : 2 pops empty the last chunk, it is kept as spare :" << std::endl;
+  std::cout << "chunks - " << stk7.storage.Segments() << " (2) " << std::endl;
+  std::cout << "spare - " << stk7.storage.HasSpare() << " (1) " << std::endl;
+
+  stk7.Push(8);
+  std::cout << "stk7 : push takes the spare chunk :" << std::endl;
+  std::cout << "chunks - " << stk7.storage.Segments() << " (3) " << std::endl;
+  std::cout << "spare - " << stk7.storage.HasSpare() << " (0) " << std::endl;
+  std::cout << "data - numbers from 0 to 8:" << std::endl;
+  stk7.StackPrint(std::cout);
+
+  stk7.storage.Segment(0)[4] = 100;
+  std::cout << "Error code for stk7 after writing past the first chunk : ";
+  print_err(std::cout, stk7.StackOK());
+  StackCanaryOn::SetBufCanaries(stk7.storage.Segment(0), 4 * sizeof(int));
+  std::cout << "Error code for stk7 after restoring the canary : ";
+  print_err(std::cout, stk7.StackOK());
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Pool allocator /////////////////////\n";
+  typedef StackT<int, StackCanaryOn, StackHashOn, StackVerifyDynamic, StackHeapStorage, StackPoolAllocator> PoolStackT;
+  int *data8 = nullptr;
+  {
+    PoolStackT stk8(VarInfo("stk8", CURR_LOCATION));
+    for (int i = 0; i < 100; i++)
+    {
+      stk8.Push(i);
+    }
+    data8 = stk8.storage.Data();
+
+    std::cout << "stk8 : 100 pushes, capacities up to 16 share one block, blocks of 3 size classes are freed :"
+              << std::endl;
+    std::cout << "cached blocks - " << StackPoolAllocator::CachedBlocks() << " (3) " << std::endl;
+    std::cout << "Error code for stk8 : ";
+    print_err(std::cout, stk8.StackOK());
+  }
+  std::cout << "stk8 is destroyed :" << std::endl;
+  std::cout << "cached blocks - " << StackPoolAllocator::CachedBlocks() << " (4) " << std::endl;
+
+  PoolStackT stk9(VarInfo("stk9", CURR_LOCATION));
+  for (int i = 0; i < 100; i++)
+  {
+    stk9.Push(i);
+  }
+
+  std::cout << "stk9 : 100 pushes take all blocks from pool and free 3 ones again :" << std::endl;
+  std::cout << "cached blocks - " << StackPoolAllocator::CachedBlocks() << " (3) " << std::endl;
+  std::cout << "buffer of stk8 is reused - " << (data8 == stk9.storage.Data()) << " (1) " << std::endl;
+  std::cout << "Error code for stk9 : ";
+  print_err(std::cout, stk9.StackOK());
+  std::cout << std::endl;
+
+  std::cout << "///////////////////// Bulk operations /////////////////////\n";
+  ProtectedStackT<int> stk10(VarInfo("stk10", CURR_LOCATION));
+  int values10[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  ProtectedStackT<int>::Range range10;
+
+  stk10.PushN(values10, 10);
+  stk10.PeekRange(3, &range10);
+
+  std::cout << "stk10 : push of 10 elements with one reallocation :" << std::endl;
+  std::cout << "capacity - " << stk10.storage.Capacity() << " (10) " << std::endl;
+  std::cout << "top elements -";
+  for (int elem : range10)
+  {
+    std::cout << " " << elem;
+  }
+  std::cout << " (7 8 9) " << std::endl;
+  std::cout << "Error code for stk10 : ";
+  print_err(std::cout, stk10.StackOK());
+
+  stk10.PopN(values10, 4);
+  std::cout << "stk10 : pop of 4 elements :" << std::endl;
+  std::cout << "popped elements - " << values10[0] << " " << values10[3] << " (6 9) " << std::endl;
+  std::cout << "size - " << stk10.size << " (6) " << std::endl;
+  std::cout << "Error code for stk10 : ";
+  print_err(std::cout, stk10.StackOK());
+  std::cout << "Error code for pop of 7 elements : ";
+  print_err(std::cout, stk10.PopN(values10, 7));
+  std::cout << std::endl;
+
+  #ifdef STACK_GUARD_PAGES
+  std::cout << "///////////////////// Guard pages /////////////////////\n";
+  StackT<int, StackCanaryOff, StackHashOn, StackVerifyDynamic, StackGuardedStorage> stk11(100, VarInfo("stk11",
+                                                                                                      CURR_LOCATION));
+  for (int i = 0; i < 100; i++)
+  {
+    stk11.Push(i);
+  }
+
+  std::cout << "stk11 : 100 pushes into buffer between guard pages :" << std::endl;
+  std::cout << "buffer fills one page - " << (stk11.storage.Capacity() * sizeof(int) == (size_t)sysconf(_SC_PAGESIZE))
+            << " (1) " << std::endl;
+  std::cout << "Error code for stk11 : ";
+  print_err(std::cout, stk11.StackOK());
+  std::cout.flush();
+
+  pid_t child = fork();
+  if (child == 0)
+  {
+    stk11.storage[stk11.storage.Capacity()] = 100;
+    _exit(0);
+  }
+
+  int child_status = 0;
+  waitpid(child, &child_status, 0);
+  std::cout << "stk11 : writing past the buffer in child process kills it by SIGSEGV - "
+            << (WIFSIGNALED(child_status) && WTERMSIG(child_status) == SIGSEGV) << " (1) " << std::endl;
+
+  StackT<int, StackCanaryOn, StackHashOff, StackVerifyDynamic, StackGuardedStorage> stk12(100, VarInfo("stk12",
+                                                                                                      CURR_LOCATION));
+  const size_t border12 = StackCanaryOn::BUF_BORDER / sizeof(int);
+  for (int i = 0; i < 100; i++)
+  {
+    stk12.Push(i);
+  }
+  std::cout.flush();
+
+  child = fork();
+  if (child == 0)
+  {
+    stk12.storage[stk12.storage.Capacity()] = 100;
+    _exit(stk12.StackOK() == SUCCESS ? 0 : 1);
+  }
+
+  waitpid(child, &child_status, 0);
+  std::cout << "stk12 : with canaries writing past the buffer hits the back canary, found by StackOK - "
+            << (WIFEXITED(child_status) && WEXITSTATUS(child_status) == 1) << " (1) " << std::endl;
+
+  child = fork();
+  if (child == 0)
+  {
+    stk12.storage[stk12.storage.Capacity() + border12] = 100;
+    _exit(0);
+  }
+
+  waitpid(child, &child_status, 0);
+  std::cout << "stk12 : writing past the back canary kills child process by SIGSEGV - "
+            << (WIFSIGNALED(child_status) && WTERMSIG(child_status) == SIGSEGV) << " (1) " << std::endl;
+  std::cout << std::endl;
+  #endif //STACK_GUARD_PAGES
+
   std::cout << "///////////////////// Canary protection check /////////////////////\n";
-  #ifndef STACK_CANARY_PROTECTION
-  #define STACK_CANARY_PROTECTION
-  #endif //STACK_CANARY_PROTECTION
 
-  auto canaryFront_buf = (StkCanaryT *)((char *)stk1.data - sizeof(StkCanaryT));
-  auto canaryBack_buf  = (StkCanaryT *)((char *)stk1.data + sizeof(int) * stk1.capacity);
+  auto canaryFront_buf = (StkCanaryT *)((char *)stk1.storage.Data() - sizeof(StkCanaryT));
+  auto canaryBack_buf  = (StkCanaryT *)((char *)stk1.storage.Data() + sizeof(int) * stk1.storage.Capacity());
 
   std::cout << std::hex << std::uppercase;
   std::cout << "Front buffer canary value : " << *canaryFront_buf << " (0xDEADBEEFBADF00D)" << std::endl;